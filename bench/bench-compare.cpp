@@ -0,0 +1,636 @@
+// 같은 workload trace 를 rbtree, std::multiset, std::map, B-tree, skip list 에 흘려 나란히 비교
+//
+// 사용법 : bench-compare [-n ops] [-w] [trace 파일 ...]
+//   trace 파일 (src/rbtree_trace.h 형식) 을 주면 그것을, 없으면 기본 trace 셋을 n 개 (기본 1M) 연산으로 만들어 돌린다.
+//     mixed      : insert 50% / find 30% / erase 20%, key 는 [0, n / 4) 에서 무작위 (중복 포함)
+//     read-heavy : n / 10 개 insert 뒤 find 90% / insert 5% / erase 5%
+//     sequential : 증가하는 key 로 n / 2 개 insert, 같은 순서로 find 와 erase
+//   -w 를 주면 기본 trace 를 <이름>.trace 로 저장한다. (운영 key 흐름도 같은 형식으로 만들어 넣으면 됨)
+//
+//   자료구조마다 두 번 돌린다.
+//   1) 시계 없이 전체 처리량 (Mops/s) 과 끝났을 때 malloc 이 쥔 byte / key (중복 포함 key 수로 나눔)
+//   2) op 마다 시계를 읽어 (읽는 비용은 빼고) p50 / p99 / p99.9 지연
+//   rbtree 와 std::multiset 은 같은 key 를 node 로 따로 두고, std::map / B-tree / skip list 는 key 마다 개수를 센다.
+//   find / erase 가 성공한 수 (hits) 는 모두 같아야 하며 다르면 실패로 끝난다.
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <rbtree.h>
+#include <rbtree_trace.h>
+}
+
+typedef rbtree_trace_rec_t rec_t;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static long held_bytes(void) {
+  const struct mallinfo2 mi = mallinfo2();
+  return (long)(mi.uordblks + mi.hblkhd);
+}
+
+// 시계를 연달아 읽을 때의 간격 (중앙값)
+static uint64_t timer_overhead(void) {
+  std::vector<uint64_t> gaps(1001);
+  uint64_t prev = now_ns();
+  for (auto &gap : gaps) {
+    const uint64_t cur = now_ns();
+    gap = cur - prev;
+    prev = cur;
+  }
+  std::sort(gaps.begin(), gaps.end());
+  return gaps[500];
+}
+
+// --- 비교 대상 : insert / find / erase (key 하나) / size (중복 포함 key 수) ---
+
+struct RbtreeSet {
+  rbtree *t = new_rbtree();
+  ~RbtreeSet() { delete_rbtree(t); }
+  void insert(key_t key) { rbtree_insert(t, key); }
+  bool find(key_t key) { return rbtree_find(t, key) != NULL; }
+  bool erase(key_t key) {
+    node_t *p = rbtree_find(t, key);
+    if (p == NULL) {
+      return false;
+    }
+    rbtree_erase(t, p);
+    return true;
+  }
+  size_t size() const { return rbtree_size(t); }
+};
+
+struct StdMultiset {
+  std::multiset<key_t> s;
+  void insert(key_t key) { s.insert(key); }
+  bool find(key_t key) { return s.find(key) != s.end(); }
+  bool erase(key_t key) {
+    auto it = s.find(key);
+    if (it == s.end()) {
+      return false;
+    }
+    s.erase(it);
+    return true;
+  }
+  size_t size() const { return s.size(); }
+};
+
+struct StdMap {
+  std::map<key_t, uint32_t> m;
+  size_t count = 0;
+  void insert(key_t key) {
+    m[key]++;
+    count++;
+  }
+  bool find(key_t key) { return m.find(key) != m.end(); }
+  bool erase(key_t key) {
+    auto it = m.find(key);
+    if (it == m.end()) {
+      return false;
+    }
+    if (--it->second == 0) {
+      m.erase(it);
+    }
+    count--;
+    return true;
+  }
+  size_t size() const { return count; }
+};
+
+// B-tree (CLRS) : node 하나에 key 를 2T - 1 개까지, 같은 key 는 개수로
+// 내려가며 미리 split / 채우므로 insert 와 erase 모두 한 번 내려가면 끝난다.
+// leaf 는 child 배열 없이 할당한다. (leaf 는 끝까지 leaf)
+class BTree {
+  static const int T = 16;
+  struct Node {
+    int n;
+    bool leaf;
+    key_t keys[2 * T - 1];
+    uint32_t counts[2 * T - 1];
+    Node *child[2 * T];
+  };
+  Node *root;
+  size_t count = 0;
+
+  static Node *new_node(bool leaf) {
+    Node *x = (Node *)malloc(leaf ? offsetof(Node, child) : sizeof(Node));
+    x->n = 0;
+    x->leaf = leaf;
+    return x;
+  }
+
+  static void free_node(Node *x) {
+    if (!x->leaf) {
+      for (int i = 0; i <= x->n; i++) {
+        free_node(x->child[i]);
+      }
+    }
+    free(x);
+  }
+
+  // x 에서 key 이상인 첫 자리
+  static int lower(const Node *x, key_t key) {
+    int i = 0;
+    while (i < x->n && x->keys[i] < key) {
+      i++;
+    }
+    return i;
+  }
+
+  // 가득 찬 x->child[i] 를 둘로 나누고 가운데 key 를 x 로 올림
+  static void split_child(Node *x, int i) {
+    Node *y = x->child[i];
+    Node *z = new_node(y->leaf);
+    z->n = T - 1;
+    memcpy(z->keys, y->keys + T, (T - 1) * sizeof(key_t));
+    memcpy(z->counts, y->counts + T, (T - 1) * sizeof(uint32_t));
+    if (!y->leaf) {
+      memcpy(z->child, y->child + T, T * sizeof(Node *));
+    }
+    y->n = T - 1;
+    memmove(x->child + i + 2, x->child + i + 1, (x->n - i) * sizeof(Node *));
+    x->child[i + 1] = z;
+    memmove(x->keys + i + 1, x->keys + i, (x->n - i) * sizeof(key_t));
+    memmove(x->counts + i + 1, x->counts + i, (x->n - i) * sizeof(uint32_t));
+    x->keys[i] = y->keys[T - 1];
+    x->counts[i] = y->counts[T - 1];
+    x->n++;
+  }
+
+  // x->child[i], 가운데 key, x->child[i + 1] 을 하나로 (두 child 모두 T - 1 개)
+  static void merge(Node *x, int i) {
+    Node *y = x->child[i], *z = x->child[i + 1];
+    y->keys[T - 1] = x->keys[i];
+    y->counts[T - 1] = x->counts[i];
+    memcpy(y->keys + T, z->keys, z->n * sizeof(key_t));
+    memcpy(y->counts + T, z->counts, z->n * sizeof(uint32_t));
+    if (!y->leaf) {
+      memcpy(y->child + T, z->child, (z->n + 1) * sizeof(Node *));
+    }
+    y->n += z->n + 1;
+    memmove(x->keys + i, x->keys + i + 1, (x->n - i - 1) * sizeof(key_t));
+    memmove(x->counts + i, x->counts + i + 1, (x->n - i - 1) * sizeof(uint32_t));
+    memmove(x->child + i + 1, x->child + i + 2, (x->n - i - 1) * sizeof(Node *));
+    x->n--;
+    free(z);
+  }
+
+  // T - 1 개뿐인 x->child[i] 를 형제에게서 빌리거나 합쳐 T 개 이상으로. 내려갈 child 의 자리를 돌려줌
+  static int fill(Node *x, int i) {
+    Node *c = x->child[i];
+    if (i > 0 && x->child[i - 1]->n >= T) {
+      Node *s = x->child[i - 1];
+      memmove(c->keys + 1, c->keys, c->n * sizeof(key_t));
+      memmove(c->counts + 1, c->counts, c->n * sizeof(uint32_t));
+      if (!c->leaf) {
+        memmove(c->child + 1, c->child, (c->n + 1) * sizeof(Node *));
+        c->child[0] = s->child[s->n];
+      }
+      c->keys[0] = x->keys[i - 1];
+      c->counts[0] = x->counts[i - 1];
+      x->keys[i - 1] = s->keys[s->n - 1];
+      x->counts[i - 1] = s->counts[s->n - 1];
+      c->n++;
+      s->n--;
+      return i;
+    }
+    if (i < x->n && x->child[i + 1]->n >= T) {
+      Node *s = x->child[i + 1];
+      c->keys[c->n] = x->keys[i];
+      c->counts[c->n] = x->counts[i];
+      if (!c->leaf) {
+        c->child[c->n + 1] = s->child[0];
+        memmove(s->child, s->child + 1, s->n * sizeof(Node *));
+      }
+      x->keys[i] = s->keys[0];
+      x->counts[i] = s->counts[0];
+      memmove(s->keys, s->keys + 1, (s->n - 1) * sizeof(key_t));
+      memmove(s->counts, s->counts + 1, (s->n - 1) * sizeof(uint32_t));
+      c->n++;
+      s->n--;
+      return i;
+    }
+    if (i < x->n) {
+      merge(x, i);
+      return i;
+    }
+    merge(x, i - 1);
+    return i - 1;
+  }
+
+  // x 아래에서 key 를 통째로 지움 (있는 것이 확실함). x 는 루트거나 T 개 이상
+  static void remove(Node *x, key_t key) {
+    while (true) {
+      int i = lower(x, key);
+      if (i < x->n && x->keys[i] == key) {
+        if (x->leaf) {
+          memmove(x->keys + i, x->keys + i + 1, (x->n - i - 1) * sizeof(key_t));
+          memmove(x->counts + i, x->counts + i + 1, (x->n - i - 1) * sizeof(uint32_t));
+          x->n--;
+          return;
+        }
+        // predecessor / successor 를 끌어올리고 그 key 를 아래에서 지움
+        if (x->child[i]->n >= T) {
+          Node *p = x->child[i];
+          while (!p->leaf) {
+            p = p->child[p->n];
+          }
+          x->keys[i] = p->keys[p->n - 1];
+          x->counts[i] = p->counts[p->n - 1];
+          key = x->keys[i];
+          x = x->child[i];
+        } else if (x->child[i + 1]->n >= T) {
+          Node *p = x->child[i + 1];
+          while (!p->leaf) {
+            p = p->child[0];
+          }
+          x->keys[i] = p->keys[0];
+          x->counts[i] = p->counts[0];
+          key = x->keys[i];
+          x = x->child[i + 1];
+        } else {
+          merge(x, i);
+          x = x->child[i];
+        }
+        continue;
+      }
+      if (x->child[i]->n < T) {
+        i = fill(x, i);
+      }
+      x = x->child[i];
+    }
+  }
+
+ public:
+  BTree() : root(new_node(true)) {}
+  ~BTree() { free_node(root); }
+
+  uint32_t *lookup(key_t key) {
+    Node *x = root;
+    while (true) {
+      const int i = lower(x, key);
+      if (i < x->n && x->keys[i] == key) {
+        return &x->counts[i];
+      }
+      if (x->leaf) {
+        return NULL;
+      }
+      x = x->child[i];
+    }
+  }
+
+  void insert(key_t key) {
+    count++;
+    uint32_t *c = lookup(key);
+    if (c != NULL) {
+      (*c)++;
+      return;
+    }
+    if (root->n == 2 * T - 1) {
+      Node *s = new_node(false);
+      s->child[0] = root;
+      root = s;
+      split_child(s, 0);
+    }
+    Node *x = root;
+    while (!x->leaf) {
+      int i = lower(x, key);
+      if (x->child[i]->n == 2 * T - 1) {
+        split_child(x, i);
+        if (key > x->keys[i]) {
+          i++;
+        }
+      }
+      x = x->child[i];
+    }
+    const int i = lower(x, key);
+    memmove(x->keys + i + 1, x->keys + i, (x->n - i) * sizeof(key_t));
+    memmove(x->counts + i + 1, x->counts + i, (x->n - i) * sizeof(uint32_t));
+    x->keys[i] = key;
+    x->counts[i] = 1;
+    x->n++;
+  }
+
+  bool find(key_t key) { return lookup(key) != NULL; }
+
+  bool erase(key_t key) {
+    uint32_t *c = lookup(key);
+    if (c == NULL) {
+      return false;
+    }
+    count--;
+    if (--*c > 0) {
+      return true;
+    }
+    remove(root, key);
+    if (root->n == 0 && !root->leaf) {
+      Node *old = root;
+      root = root->child[0];
+      free(old);
+    }
+    return true;
+  }
+
+  size_t size() const { return count; }
+};
+
+// skip list : 단계가 하나 오를 확률 1/4, 같은 key 는 개수로
+class SkipList {
+  static const int MAX_LEVEL = 16;
+  struct Node {
+    key_t key;
+    uint32_t count;
+    Node *next[];
+  };
+  Node *head;
+  int level = 1;
+  uint64_t seed = 88172645463325252ull;
+  size_t count = 0;
+
+  static Node *new_node(int level) { return (Node *)calloc(1, sizeof(Node) + level * sizeof(Node *)); }
+
+  int random_level() {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    int lv = 1;
+    for (uint64_t r = seed; lv < MAX_LEVEL && (r & 3) == 0; r >>= 2) {
+      lv++;
+    }
+    return lv;
+  }
+
+  // 단계마다 key 보다 작은 마지막 node 를 update 에 (key 이상인 첫 node 를 돌려줌)
+  Node *search(key_t key, Node **update) {
+    Node *x = head;
+    for (int lv = level - 1; lv >= 0; lv--) {
+      while (x->next[lv] != NULL && x->next[lv]->key < key) {
+        x = x->next[lv];
+      }
+      if (update != NULL) {
+        update[lv] = x;
+      }
+    }
+    return x->next[0];
+  }
+
+ public:
+  SkipList() : head(new_node(MAX_LEVEL)) {}
+  ~SkipList() {
+    for (Node *x = head; x != NULL;) {
+      Node *next = x->next[0];
+      free(x);
+      x = next;
+    }
+  }
+
+  void insert(key_t key) {
+    count++;
+    Node *update[MAX_LEVEL];
+    Node *x = search(key, update);
+    if (x != NULL && x->key == key) {
+      x->count++;
+      return;
+    }
+    const int lv = random_level();
+    for (; level < lv; level++) {
+      update[level] = head;
+    }
+    x = new_node(lv);
+    x->key = key;
+    x->count = 1;
+    for (int i = 0; i < lv; i++) {
+      x->next[i] = update[i]->next[i];
+      update[i]->next[i] = x;
+    }
+  }
+
+  bool find(key_t key) {
+    Node *x = search(key, NULL);
+    return x != NULL && x->key == key;
+  }
+
+  bool erase(key_t key) {
+    Node *update[MAX_LEVEL];
+    Node *x = search(key, update);
+    if (x == NULL || x->key != key) {
+      return false;
+    }
+    count--;
+    if (--x->count > 0) {
+      return true;
+    }
+    for (int i = 0; i < level && update[i]->next[i] == x; i++) {
+      update[i]->next[i] = x->next[i];
+    }
+    free(x);
+    while (level > 1 && head->next[level - 1] == NULL) {
+      level--;
+    }
+    return true;
+  }
+
+  size_t size() const { return count; }
+};
+
+// --- trace 재생 ---
+
+template <class Set>
+static inline bool apply(Set &s, const rec_t &r) {
+  switch (r.op) {
+    case RBTREE_TRACE_INSERT:
+      s.insert(r.key);
+      return false;
+    case RBTREE_TRACE_FIND:
+      return s.find(r.key);
+    default:
+      return s.erase(r.key);
+  }
+}
+
+struct result_t {
+  double mops, p50, p99, p999, bytes_per_key;
+  size_t hits;
+};
+
+template <class Set>
+static __attribute__((noinline)) result_t replay(const std::vector<rec_t> &trace, uint64_t overhead) {
+  result_t res;
+  const size_t n = trace.size();
+  {
+    const long before = held_bytes();
+    Set s;
+    size_t hits = 0;
+    const uint64_t start = now_ns();
+    for (const rec_t &r : trace) {
+      hits += apply(s, r);
+    }
+    const uint64_t elapsed = now_ns() - start;
+    res.mops = elapsed > 0 ? n * 1e3 / elapsed : 0;
+    res.hits = hits;
+    res.bytes_per_key = s.size() > 0 ? (double)(held_bytes() - before) / s.size() : 0;
+  }
+  std::vector<uint64_t> lat(n);
+  {
+    Set s;
+    // 결과를 버리면 inline 된 std::multiset / BTree 의 find 가 통째로 지워지므로 sink 에 모아 살려 둠
+    size_t sink = 0;
+    uint64_t prev = now_ns();
+    for (size_t i = 0; i < n; i++) {
+      sink += apply(s, trace[i]);
+      asm volatile("" : : "r"(sink));
+      const uint64_t cur = now_ns();
+      lat[i] = cur - prev > overhead ? cur - prev - overhead : 0;
+      prev = cur;
+    }
+  }
+  std::sort(lat.begin(), lat.end());
+  res.p50 = lat[n / 2];
+  res.p99 = lat[n * 99 / 100];
+  res.p999 = lat[n * 999 / 1000];
+  return res;
+}
+
+struct trace_t {
+  std::string name;
+  std::vector<rec_t> recs;
+};
+
+static rec_t make_rec(rbtree_trace_op_t op, key_t key) {
+  rec_t r;
+  r.op = (uint8_t)op;
+  r.key = key;
+  return r;
+}
+
+static std::vector<trace_t> builtin_traces(size_t n) {
+  std::vector<trace_t> traces(3);
+  const key_t span = (key_t)(n / 4 + 1);
+
+  traces[0].name = "mixed";
+  for (size_t i = 0; i < n; i++) {
+    const int dice = rand() % 10;
+    const rbtree_trace_op_t op = dice < 5 ? RBTREE_TRACE_INSERT : dice < 8 ? RBTREE_TRACE_FIND : RBTREE_TRACE_ERASE;
+    traces[0].recs.push_back(make_rec(op, rand() % span));
+  }
+
+  traces[1].name = "read-heavy";
+  for (size_t i = 0; i < n; i++) {
+    const int dice = rand() % 20;
+    const rbtree_trace_op_t op = i < n / 10 || dice == 0 ? RBTREE_TRACE_INSERT
+                                 : dice == 1             ? RBTREE_TRACE_ERASE
+                                                         : RBTREE_TRACE_FIND;
+    traces[1].recs.push_back(make_rec(op, rand()));
+  }
+  // key 가 무작위라 그대로면 find 가 다 빗나가므로 처음 넣은 key 중에서 다시 고름
+  const size_t base = n / 10;
+  for (size_t i = base; base > 0 && i < n; i++) {
+    if (traces[1].recs[i].op != RBTREE_TRACE_INSERT) {
+      traces[1].recs[i].key = traces[1].recs[rand() % base].key;
+    }
+  }
+
+  traces[2].name = "sequential";
+  const size_t half = n / 2;
+  for (size_t i = 0; i < half; i++) {
+    traces[2].recs.push_back(make_rec(RBTREE_TRACE_INSERT, (key_t)i));
+  }
+  for (size_t i = 0; i < n - half; i++) {
+    traces[2].recs.push_back(make_rec(i % 2 ? RBTREE_TRACE_ERASE : RBTREE_TRACE_FIND, (key_t)(i / 2)));
+  }
+  return traces;
+}
+
+static bool run_trace(const trace_t &trace, uint64_t overhead) {
+  size_t ops[RBTREE_TRACE_OPS] = {0};
+  for (const rec_t &r : trace.recs) {
+    ops[r.op]++;
+  }
+  printf("\n%s : %zu ops (insert %zu / find %zu / erase %zu)\n", trace.name.c_str(), trace.recs.size(),
+         ops[RBTREE_TRACE_INSERT], ops[RBTREE_TRACE_FIND], ops[RBTREE_TRACE_ERASE]);
+  if (trace.recs.empty()) {
+    return true;
+  }
+  printf("%-14s %8s %8s %8s %8s %10s %10s\n", "structure", "Mops/s", "p50", "p99", "p99.9", "bytes/key", "hits");
+
+  const char *names[] = {"rbtree", "std::multiset", "std::map", "btree", "skiplist"};
+  result_t res[5];
+  res[0] = replay<RbtreeSet>(trace.recs, overhead);
+  res[1] = replay<StdMultiset>(trace.recs, overhead);
+  res[2] = replay<StdMap>(trace.recs, overhead);
+  res[3] = replay<BTree>(trace.recs, overhead);
+  res[4] = replay<SkipList>(trace.recs, overhead);
+  bool ok = true;
+  for (int i = 0; i < 5; i++) {
+    printf("%-14s %8.2f %8.0f %8.0f %8.0f %10.1f %10zu\n", names[i], res[i].mops, res[i].p50, res[i].p99, res[i].p999,
+           res[i].bytes_per_key, res[i].hits);
+    if (res[i].hits != res[0].hits) {
+      fprintf(stderr, "%s : hits %zu != rbtree %zu\n", names[i], res[i].hits, res[0].hits);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  size_t n = 1000000;
+  bool write = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:w")) != -1) {
+    if (opt == 'n') {
+      n = strtoul(optarg, NULL, 10);
+    } else if (opt == 'w') {
+      write = true;
+    } else {
+      fprintf(stderr, "usage: %s [-n ops] [-w] [trace ...]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<trace_t> traces;
+  if (optind < argc) {
+    for (int i = optind; i < argc; i++) {
+      size_t count;
+      rec_t *recs = rbtree_trace_load(argv[i], &count);
+      if (recs == NULL) {
+        fprintf(stderr, "%s : not a trace file\n", argv[i]);
+        return 1;
+      }
+      traces.push_back(trace_t{argv[i], std::vector<rec_t>(recs, recs + count)});
+      free(recs);
+    }
+  } else {
+    srand(42);
+    traces = builtin_traces(n);
+    for (const trace_t &trace : traces) {
+      const std::string path = trace.name + ".trace";
+      if (write && rbtree_trace_save(path.c_str(), trace.recs.data(), trace.recs.size()) != 0) {
+        perror(path.c_str());
+        return 1;
+      }
+    }
+  }
+
+  const uint64_t overhead = timer_overhead();
+  printf("timer overhead %llu ns\n", (unsigned long long)overhead);
+  bool ok = true;
+  for (const trace_t &trace : traces) {
+    ok = run_trace(trace, overhead) && ok;
+  }
+  return ok ? 0 : 1;
+}
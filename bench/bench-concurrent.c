@@ -0,0 +1,114 @@
+// concurrent_rbtree 의 thread 수별 처리량 (read 95% / 50%)
+// bench-concurrent (seqlock reader) 과 bench-concurrent-locked (-DRBTREE_CONCURRENT_LOCKED, 항상 read lock)
+// 이 같은 코드로 빌드된다.
+//
+// 사용법 : bench-concurrent [max_threads] [ms]
+//   1 부터 2 배씩 max_threads (기본 64) 까지, 조합마다 ms (기본 200) 동안 돌린다.
+//   짝수 key 는 미리 넣어 두고 지우지 않으므로 reader 는 항상 찾아야 한다. (못 찾으면 실패로 끝냄)
+//   writer 는 홀수 key 를 넣었다가 다음 write 에서 지운다.
+#include <pthread.h>
+#include <rbtree_concurrent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PRELOAD (1 << 20)
+
+typedef struct {
+  concurrent_rbtree *ct;
+  unsigned int seed;
+  int read_pct;
+  size_t reads, writes, misses;
+  char pad[64];  // 이웃 thread 의 카운터와 cache line 을 나누지 않도록
+} worker_t;
+
+static volatile int stop;
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *worker(void *arg) {
+  worker_t *w = arg;
+  key_t pending = -1;  // 넣어 두고 아직 안 지운 홀수 key
+  while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+    if ((int)(rand_r(&w->seed) % 100) < w->read_pct) {
+      const key_t key = (key_t)(rand_r(&w->seed) % PRELOAD) * 2;
+      if (!concurrent_rbtree_find(w->ct, key)) {
+        w->misses++;
+      }
+      w->reads++;
+    } else if (pending < 0) {
+      pending = (key_t)(rand_r(&w->seed) % PRELOAD) * 2 + 1;
+      concurrent_rbtree_insert(w->ct, pending);
+      w->writes++;
+    } else {
+      concurrent_rbtree_erase(w->ct, pending);
+      pending = -1;
+      w->writes++;
+    }
+  }
+  if (pending >= 0) {
+    concurrent_rbtree_erase(w->ct, pending);
+  }
+  return NULL;
+}
+
+int main(int argc, char *argv[]) {
+  const int max_threads = argc > 1 ? atoi(argv[1]) : 64;
+  const int ms = argc > 2 ? atoi(argv[2]) : 200;
+  const char *name = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 : argv[0];
+  const int mixes[] = {95, 50};
+
+  concurrent_rbtree *ct = new_concurrent_rbtree();
+  for (key_t i = 0; i < PRELOAD; i++) {
+    concurrent_rbtree_insert(ct, i * 2);
+  }
+
+  worker_t *workers = calloc(max_threads, sizeof(worker_t));
+  pthread_t *threads = calloc(max_threads, sizeof(pthread_t));
+  printf("%s (%ld cpu)\n", name, sysconf(_SC_NPROCESSORS_ONLN));
+  printf("%6s %8s %14s %14s\n", "read%", "threads", "read Mops/s", "write Mops/s");
+  for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); m++) {
+    for (int n = 1; n <= max_threads; n *= 2) {
+      stop = 0;
+      for (int i = 0; i < n; i++) {
+        workers[i] = (worker_t){.ct = ct, .seed = 42 + i, .read_pct = mixes[m]};
+        pthread_create(&threads[i], NULL, worker, &workers[i]);
+      }
+      const double start = now_sec();
+      usleep(ms * 1000);
+      __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+      size_t reads = 0, writes = 0, misses = 0;
+      for (int i = 0; i < n; i++) {
+        pthread_join(threads[i], NULL);
+        reads += workers[i].reads;
+        writes += workers[i].writes;
+        misses += workers[i].misses;
+      }
+      const double elapsed = now_sec() - start;
+      if (misses != 0) {
+        fprintf(stderr, "%zu reads missed a key that is always present\n", misses);
+        return 1;
+      }
+      printf("%6d %8d %14.2f %14.2f\n", mixes[m], n, reads / elapsed * 1e-6, writes / elapsed * 1e-6);
+    }
+  }
+
+  // 짝수 key 만 남아 있어야 함
+  key_t lo, hi;
+  if (concurrent_rbtree_min(ct, &lo) != 0 || lo != 0 || concurrent_rbtree_max(ct, &hi) != 0 ||
+      hi != (PRELOAD - 1) * 2 || rbtree_size(ct->tree) != PRELOAD) {
+    fprintf(stderr, "tree changed after the run\n");
+    return 1;
+  }
+
+  free(threads);
+  free(workers);
+  delete_concurrent_rbtree(ct);
+  return 0;
+}
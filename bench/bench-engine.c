@@ -0,0 +1,104 @@
+// engine 별 기본 연산 비교
+// bench-engine (rbtree.c), bench-engine-index (-DRBTREE_INDEX), bench-engine-btree (-DRBTREE_BTREE)
+// 이 같은 코드로 빌드된다. B+ tree 의 node 안 비교는 기본 SSE2 이고, CFLAGS 에 -mavx2 를 더하면 AVX2 로 바뀐다.
+//
+// 사용법 : bench-engine [n]
+//   무작위 짝수 key n 개 (기본 1M) 를 넣고 find (있는 key / 없는 홀수 key), lower_bound, 처음부터 끝까지 순회,
+//   넣은 순서대로 find + erase 를 op 당 ns 로, 늘어난 RSS 를 key 당 byte 로 보여줌
+#include <rbtree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long rss_kb(void) {
+  long pages = 0, resident = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f == NULL) {
+    return -1;
+  }
+  if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+    resident = -1;
+  }
+  fclose(f);
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void report(const char *name, const char *op, double elapsed, size_t n, size_t check) {
+  printf("%-20s %-12s %8.1f ns/op  (%zu)\n", name, op, elapsed * 1e9 / n, check);
+}
+
+int main(int argc, char *argv[]) {
+  const size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  const char *name = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 : argv[0];
+  if (n == 0) {
+    return 0;
+  }
+  key_t *keys = malloc(n * sizeof(key_t));
+  key_t *probe = malloc(n * sizeof(key_t));
+  srand(42);
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = (key_t)(rand() % (1 << 30)) * 2;
+  }
+  for (size_t i = 0; i < n; i++) {
+    probe[i] = keys[rand() % n];
+  }
+
+  const long base = rss_kb();
+  rbtree *t = new_rbtree();
+  double start = now_sec();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, keys[i]);
+  }
+  report(name, "insert", now_sec() - start, n, rbtree_size(t));
+  const long used = rss_kb() - base;
+
+  size_t found = 0;
+  start = now_sec();
+  for (size_t i = 0; i < n; i++) {
+    found += rbtree_find(t, probe[i]) != NULL;
+  }
+  report(name, "find hit", now_sec() - start, n, found);
+
+  found = 0;
+  start = now_sec();
+  for (size_t i = 0; i < n; i++) {
+    found += rbtree_find(t, probe[i] + 1) != NULL;
+  }
+  report(name, "find miss", now_sec() - start, n, found);
+
+  size_t sum = 0;
+  start = now_sec();
+  for (size_t i = 0; i < n; i++) {
+    const node_t *p = rbtree_lower_bound(t, probe[i] + 1);
+    sum += p != NULL ? (size_t)p->key : 0;
+  }
+  report(name, "lower_bound", now_sec() - start, n, sum % 1000);
+
+  sum = 0;
+  start = now_sec();
+  for (node_t *p = rbtree_min(t); p != NULL; p = rbtree_next(t, p)) {
+    sum += (size_t)p->key;
+  }
+  report(name, "iterate", now_sec() - start, n, sum % 1000);
+
+  // node_t * 를 들고 있지 않고 매번 찾아서 지움 (B+ tree engine 은 erase 마다 포인터가 무효가 됨)
+  start = now_sec();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_erase(t, rbtree_find(t, keys[i]));
+  }
+  report(name, "find + erase", now_sec() - start, n, rbtree_size(t));
+  printf("%-20s memory       %8.1f B/key (sizeof(node_t)=%zu)\n", name, used * 1024.0 / n, sizeof(node_t));
+
+  delete_rbtree(t);
+  free(probe);
+  free(keys);
+  return 0;
+}
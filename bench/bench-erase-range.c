@@ -0,0 +1,71 @@
+// rbtree_erase_range 와 범위 안의 node 를 하나씩 rbtree_erase 하는 loop 비교
+//
+// 사용법 : bench-erase-range [n]
+//   무작위 key n 개 (기본 10M) 의 tree 에서 앞쪽 (TTL sweep) 과 가운데 범위의 key 를 1% / 10% / 50% 지운다.
+//   tree 는 매번 rbtree_insert_batch 로 새로 만든다. node 가 key 순서대로 놓이므로 loop 쪽에 가장 유리한 배치다.
+#include <limits.h>
+#include <rbtree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static __attribute__((noinline)) size_t erase_loop(rbtree *t, key_t lo, key_t hi) {
+  size_t count = 0;
+  node_t *p = rbtree_lower_bound(t, lo);
+  while (p != NULL && p->key < hi) {
+    node_t *next = rbtree_next(t, p);
+    rbtree_erase(t, p);
+    p = next;
+    count++;
+  }
+  return count;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+  const int percents[] = {1, 10, 50};
+  srand(42);
+  key_t *keys = malloc(n * sizeof(key_t));
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = rand();
+  }
+
+  printf("n = %zu\n", n);
+  printf("%-8s %8s %10s %12s %12s %9s\n", "range", "percent", "erased", "loop ms", "range ms", "speedup");
+  for (int middle = 0; middle < 2; middle++) {
+    for (size_t i = 0; i < sizeof(percents) / sizeof(percents[0]); i++) {
+      // rand() 는 [0, RAND_MAX] 에 고르게 퍼져 있으므로 key 범위의 비율 ≈ 지우는 비율
+      const key_t width = (key_t)((double)RAND_MAX * percents[i] / 100);
+      const key_t lo = middle ? (RAND_MAX - width) / 2 : INT_MIN, hi = middle ? lo + width : width;
+
+      rbtree *t = new_rbtree();
+      rbtree_insert_batch(t, keys, n);
+      double start = now_sec();
+      const size_t loopCount = erase_loop(t, lo, hi);
+      const double loop = now_sec() - start;
+      delete_rbtree(t);
+
+      t = new_rbtree();
+      rbtree_insert_batch(t, keys, n);
+      start = now_sec();
+      const size_t rangeCount = rbtree_erase_range(t, lo, hi);
+      const double range = now_sec() - start;
+      if (rangeCount != loopCount || rbtree_size(t) != n - rangeCount) {
+        fprintf(stderr, "erased %zu, expected %zu\n", rangeCount, loopCount);
+        return 1;
+      }
+      delete_rbtree(t);
+
+      printf("%-8s %7d%% %10zu %12.1f %12.1f %8.2fx\n", middle ? "middle" : "prefix", percents[i],
+             rangeCount, loop * 1e3, range * 1e3, loop / range);
+    }
+  }
+  free(keys);
+  return 0;
+}
@@ -0,0 +1,79 @@
+// tree 전체를 파일로 내보내기 : rbtree_to_array 로 한 번에 꺼내 쓰기 와 rbtree_export 로 chunk 마다 쓰기
+//
+// 사용법 : bench-export [n] [path]
+//   n 개 (기본 10M) 의 무작위 key tree 를 path (기본 bench-export.out) 에 쓴다.
+//   to_array 는 n 개짜리 버퍼가, export 는 chunk 하나만 필요하다. (추가 메모리 열)
+#include <rbtree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int write_chunk(const key_t *keys, size_t n, void *f) {
+  return fwrite(keys, sizeof(key_t), n, f) == n ? 0 : -1;
+}
+
+static __attribute__((noinline)) int dump_to_array(const rbtree *t, FILE *f) {
+  const size_t n = rbtree_size(t);
+  key_t *keys = malloc((n + 1) * sizeof(key_t));
+  int res = rbtree_to_array(t, keys, n);
+  res = res != 0 || fwrite(keys, sizeof(key_t), n, f) != n;
+  free(keys);
+  return res;
+}
+
+static __attribute__((noinline)) int dump_export(const rbtree *t, FILE *f, size_t cap) {
+  key_t *buf = malloc(cap * sizeof(key_t));
+  const int res = rbtree_export(t, buf, cap, write_chunk, f);
+  free(buf);
+  return res;
+}
+
+static void report(const char *label, double elapsed, size_t n, size_t extra) {
+  printf("%-22s %10.1f %10.1f %12.1f\n", label, elapsed * 1e3, elapsed * 1e9 / n, extra / 1024.0);
+}
+
+int main(int argc, char *argv[]) {
+  const size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+  const char *path = argc > 2 ? argv[2] : "bench-export.out";
+  srand(42);
+  rbtree *t = new_rbtree();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, rand());
+  }
+
+  printf("n = %zu\n", n);
+  printf("%-22s %10s %10s %12s\n", "", "ms", "ns/key", "extra KB");
+  FILE *f = fopen(path, "wb");
+  if (f == NULL) {
+    perror(path);
+    return 1;
+  }
+  double start = now_sec();
+  if (dump_to_array(t, f) != 0) {
+    return 1;
+  }
+  report("to_array + fwrite", now_sec() - start, n, n * sizeof(key_t));
+
+  const size_t caps[] = {1024, 65536, 1048576};
+  for (size_t k = 0; k < sizeof(caps) / sizeof(caps[0]); k++) {
+    rewind(f);
+    start = now_sec();
+    if (dump_export(t, f, caps[k]) != 0) {
+      return 1;
+    }
+    char label[32];
+    snprintf(label, sizeof(label), "export, chunk %zu", caps[k]);
+    report(label, now_sec() - start, n, caps[k] * sizeof(key_t));
+  }
+  fclose(f);
+  unlink(path);
+  delete_rbtree(t);
+  return 0;
+}
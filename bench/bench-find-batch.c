@@ -0,0 +1,71 @@
+// rbtree_find_batch 와 key 마다 rbtree_find 를 부르는 loop 비교 (ns/key)
+//
+// 사용법 : bench-find-batch [max_n] [queries]
+//   tree 크기 max_n/100 / max_n/10 / max_n 에서 무작위 key queries 개 (기본 1M) 를 찾는다. (기본 max_n = 30M)
+//   30M node 는 1GB 가량이라 LLC 보다 훨씬 크다 : 한 번의 find 가 거의 매 단계 cache miss 를 기다림.
+//   찾는 key 의 절반은 tree 에 있는 key, 절반은 무작위 key (대부분 없음)
+#include <rbtree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static __attribute__((noinline)) size_t find_loop(const rbtree *t, const key_t *keys, size_t n) {
+  size_t found = 0;
+  for (size_t i = 0; i < n; i++) {
+    found += rbtree_find(t, keys[i]) != NULL;
+  }
+  return found;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t max_n = argc > 1 ? strtoul(argv[1], NULL, 10) : 30000000;
+  const size_t queries = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+  const size_t sizes[] = {max_n / 100, max_n / 10, max_n};
+  srand(42);
+
+  key_t *keys = malloc(max_n * sizeof(key_t));
+  key_t *query = malloc(queries * sizeof(key_t));
+  node_t **out = malloc(queries * sizeof(node_t *));
+
+  printf("%10s %10s %14s %14s %9s\n", "tree", "queries", "loop ns/key", "batch ns/key", "speedup");
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    const size_t n = sizes[s];
+    if (n == 0) {
+      continue;
+    }
+    for (size_t i = 0; i < n; i++) {
+      keys[i] = rand();
+    }
+    rbtree *t = new_rbtree();
+    rbtree_insert_batch(t, keys, n);
+    for (size_t i = 0; i < queries; i++) {
+      query[i] = i % 2 ? keys[(size_t)rand() % n] : rand();
+    }
+
+    double start = now_sec();
+    const size_t loopFound = find_loop(t, query, queries);
+    const double loop = now_sec() - start;
+
+    start = now_sec();
+    const size_t batchFound = rbtree_find_batch(t, query, queries, out);
+    const double batch = now_sec() - start;
+    if (loopFound != batchFound) {
+      fprintf(stderr, "found %zu, expected %zu\n", batchFound, loopFound);
+      return 1;
+    }
+    delete_rbtree(t);
+
+    printf("%10zu %10zu %14.1f %14.1f %8.2fx\n", n, queries, loop * 1e9 / queries,
+           batch * 1e9 / queries, loop / batch);
+  }
+  free(out);
+  free(query);
+  free(keys);
+  return 0;
+}
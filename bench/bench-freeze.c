@@ -0,0 +1,81 @@
+// rbtree_freeze 전후의 find 시간 (ns/find)
+//
+// 사용법 : bench-freeze [n] [lookups]
+//   n 개 (기본 10M) 의 무작위 key 로 두 가지 tree 를 만든다.
+//   random insert : 무작위 순서로 insert (node 가 insert 순서대로 흩어짐)
+//   from sorted   : rbtree_from_sorted_array (node 가 key 순서대로 놓임)
+//   각 tree 에서 있는 key lookups 개 (기본 2M) 를 무작위 순서로 찾은 뒤 freeze 하고 다시 잰다.
+#include <rbtree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int comp(const void *p1, const void *p2) {
+  const key_t e1 = *(const key_t *)p1;
+  const key_t e2 = *(const key_t *)p2;
+  return (e1 > e2) - (e1 < e2);
+}
+
+static __attribute__((noinline)) double bench_find(const rbtree *t, const key_t *queries, size_t m) {
+  size_t found = 0;
+  const double start = now_sec();
+  for (size_t i = 0; i < m; i++) {
+    found += rbtree_find(t, queries[i]) != NULL;
+  }
+  const double elapsed = now_sec() - start;
+  if (found != m) {
+    fprintf(stderr, "found %zu of %zu\n", found, m);
+    exit(1);
+  }
+  return elapsed * 1e9 / m;
+}
+
+static void run(const char *label, rbtree *t, const key_t *queries, size_t m) {
+  const double before = bench_find(t, queries, m);
+  const double start = now_sec();
+  if (rbtree_freeze(t) != 0) {
+    fprintf(stderr, "freeze failed\n");
+    exit(1);
+  }
+  const double freeze = now_sec() - start;
+  const double after = bench_find(t, queries, m);
+  printf("%-16s %12.1f %12.1f %9.2fx %12.1f\n", label, before, after, before / after, freeze * 1e3);
+}
+
+int main(int argc, char *argv[]) {
+  const size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+  const size_t m = argc > 2 ? strtoul(argv[2], NULL, 10) : 2000000;
+  srand(42);
+  key_t *keys = malloc(n * sizeof(key_t));
+  key_t *queries = malloc(m * sizeof(key_t));
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = rand();
+  }
+  for (size_t i = 0; i < m; i++) {
+    queries[i] = keys[(size_t)rand() % n];
+  }
+
+  printf("n = %zu, %zu lookups\n", n, m);
+  printf("%-16s %12s %12s %10s %12s\n", "", "before ns", "frozen ns", "speedup", "freeze ms");
+  rbtree *t = new_rbtree();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, keys[i]);
+  }
+  run("random insert", t, queries, m);
+  delete_rbtree(t);
+
+  qsort(keys, n, sizeof(key_t), comp);
+  t = rbtree_from_sorted_array(keys, n);
+  run("from sorted", t, queries, m);
+  delete_rbtree(t);
+
+  free(queries);
+  free(keys);
+  return 0;
+}
@@ -0,0 +1,164 @@
+// rbtree_generic.h 의 비교 비용 : RBT_CMP 를 inline 한 tree 와 함수 포인터 (qsort 식 callback) 로 부른 tree
+// key 는 64bit 정수, 문자열, 두 필드 struct. 기준으로 rbtree.h (int key) 도 같이 잰다.
+//
+// 사용법 : bench-generic [n]
+//   n 개 (기본 1M) 의 무작위 key 를 insert 한 뒤 n 번 find 한다.
+#include <rbtree.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef int (*cmp_fn)(const void *, const void *);
+typedef const char *str_t;
+
+typedef struct {
+  int32_t year, id;
+} pair_t;
+
+static int cmp_i64(const void *p1, const void *p2) {
+  const int64_t e1 = *(const int64_t *)p1;
+  const int64_t e2 = *(const int64_t *)p2;
+  return (e1 > e2) - (e1 < e2);
+}
+
+static int cmp_str(const void *p1, const void *p2) {
+  return strcmp(*(const char *const *)p1, *(const char *const *)p2);
+}
+
+static int cmp_pair(const void *p1, const void *p2) {
+  const pair_t *a = p1, *b = p2;
+  if (a->year != b->year) {
+    return a->year < b->year ? -1 : 1;
+  }
+  return (a->id > b->id) - (a->id < b->id);
+}
+
+// volatile 이라 컴파일러가 어떤 함수인지 알 수 없음 → 매번 간접 호출
+static cmp_fn volatile cb_i64 = cmp_i64, cb_str = cmp_str, cb_pair = cmp_pair;
+
+#define RBT_NAME i64
+#define RBT_KEY int64_t
+#include <rbtree_generic.h>
+
+#define RBT_NAME i64cb
+#define RBT_KEY int64_t
+#define RBT_CMP(a, b) cb_i64(&(a), &(b))
+#include <rbtree_generic.h>
+
+#define RBT_NAME str
+#define RBT_KEY str_t
+#define RBT_CMP(a, b) strcmp((a), (b))
+#include <rbtree_generic.h>
+
+#define RBT_NAME strcb
+#define RBT_KEY str_t
+#define RBT_CMP(a, b) cb_str(&(a), &(b))
+#include <rbtree_generic.h>
+
+#define RBT_NAME pair
+#define RBT_KEY pair_t
+// 두 필드를 64bit 하나로 합쳐 비교 : || / && 로 나누면 분기가 생겨 예측 실패가 잦음
+#define PAIR_ORDER(p) ((int64_t)(p).year << 32 | ((uint32_t)(p).id ^ 0x80000000u))
+#define RBT_LESS(a, b) (PAIR_ORDER(a) < PAIR_ORDER(b))
+#define RBT_EQ(a, b) (PAIR_ORDER(a) == PAIR_ORDER(b))
+#include <rbtree_generic.h>
+
+#define RBT_NAME paircb
+#define RBT_KEY pair_t
+#define RBT_CMP(a, b) cb_pair(&(a), &(b))
+#include <rbtree_generic.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *label, size_t n, double insert, double find, size_t found) {
+  if (found != n) {
+    fprintf(stderr, "%s : found %zu of %zu\n", label, found, n);
+    exit(1);
+  }
+  printf("%-24s %14.1f %14.1f\n", label, insert * 1e9 / n, find * 1e9 / n);
+}
+
+// 같은 순서로 insert 하고, 섞인 순서 ((i * 7919) % n) 로 find
+// 인스턴스마다 따로 함수로 찍어냄 (noinline) : main 하나에 다 inline 되면 레지스터 배치가 나빠져 결과가 흔들림
+#define DEFINE_BENCH(NAME, KEY)                                          \
+  static __attribute__((noinline)) void bench_##NAME(const char *label, const KEY *keys, size_t n) { \
+    NAME##_tree *t = NAME##_new();                                       \
+    double start = now_sec();                                            \
+    for (size_t i = 0; i < n; i++) {                                     \
+      NAME##_insert(t, keys[i], NULL);                                   \
+    }                                                                    \
+    const double insert = now_sec() - start;                             \
+    size_t found = 0;                                                    \
+    start = now_sec();                                                   \
+    for (size_t i = 0; i < n; i++) {                                     \
+      found += NAME##_find(t, keys[i * 7919 % n]) != NULL;               \
+    }                                                                    \
+    report(label, n, insert, now_sec() - start, found);                  \
+    NAME##_delete(t);                                                    \
+  }
+
+static __attribute__((noinline)) void bench_rbtree(const char *label, const key_t *keys, size_t n) {
+  rbtree *t = new_rbtree();
+  double start = now_sec();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, keys[i]);
+  }
+  const double insert = now_sec() - start;
+  size_t found = 0;
+  start = now_sec();
+  for (size_t i = 0; i < n; i++) {
+    found += rbtree_find(t, keys[i * 7919 % n]) != NULL;
+  }
+  report(label, n, insert, now_sec() - start, found);
+  delete_rbtree(t);
+}
+
+DEFINE_BENCH(i64, int64_t)
+DEFINE_BENCH(i64cb, int64_t)
+DEFINE_BENCH(str, str_t)
+DEFINE_BENCH(strcb, str_t)
+DEFINE_BENCH(pair, pair_t)
+DEFINE_BENCH(paircb, pair_t)
+
+int main(int argc, char *argv[]) {
+  const size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  srand(42);
+
+  key_t *ints = malloc(n * sizeof(key_t));
+  int64_t *i64s = malloc(n * sizeof(int64_t));
+  pair_t *pairs = malloc(n * sizeof(pair_t));
+  str_t *strs = malloc(n * sizeof(char *));
+  char *str_buf = malloc(n * 16);
+  for (size_t i = 0; i < n; i++) {
+    ints[i] = rand();
+    i64s[i] = (int64_t)rand() << 31 | rand();
+    pairs[i] = (pair_t){rand() % 64, rand()};
+    // 앞부분이 겹치는 문자열 : strcmp 가 몇 글자는 읽어야 갈림
+    snprintf(str_buf + i * 16, 16, "key-%010d", rand());
+    strs[i] = str_buf + i * 16;
+  }
+
+  printf("n = %zu\n", n);
+  printf("%-24s %14s %14s\n", "", "insert ns/op", "find ns/op");
+
+  bench_rbtree("rbtree.h (int)", ints, n);
+  bench_i64("int64 inline", i64s, n);
+  bench_i64cb("int64 callback", i64s, n);
+  bench_str("string inline", strs, n);
+  bench_strcb("string callback", strs, n);
+  bench_pair("pair inline", pairs, n);
+  bench_paircb("pair callback", pairs, n);
+
+  free(str_buf);
+  free(strs);
+  free(pairs);
+  free(i64s);
+  free(ints);
+  return 0;
+}
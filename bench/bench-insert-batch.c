@@ -0,0 +1,73 @@
+// rbtree_insert_batch 와 key 마다 rbtree_insert 를 부르는 loop 비교 (ns/key)
+//
+// 사용법 : bench-insert-batch [max_n]
+//   tree 크기 0 / max_n/10 / max_n 에 무작위 key 배치 max_n/100 / max_n/10 / max_n 개를 넣는다. (기본 max_n = 1M)
+//   기존 tree 는 매번 무작위 순서 insert 로 새로 만든다. (node 주소와 key 순서가 무관한 상태)
+//   배치가 tree 의 2 배 이상이면 (빈 tree 포함) 재구성, 아니면 finger insert 로 들어간다.
+#include <rbtree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static rbtree *build_random(size_t n) {
+  rbtree *t = new_rbtree();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, rand());
+  }
+  return t;
+}
+
+static key_t *random_keys(size_t n) {
+  key_t *keys = malloc(n * sizeof(key_t));
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = rand();
+  }
+  return keys;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t max_n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  const size_t bases[] = {0, max_n / 10, max_n};
+  const size_t batches[] = {max_n / 100, max_n / 10, max_n};
+  srand(42);
+
+  printf("%10s %10s %14s %14s %9s\n", "tree", "batch", "loop ns/key", "batch ns/key", "speedup");
+  for (size_t b = 0; b < sizeof(bases) / sizeof(bases[0]); b++) {
+    for (size_t k = 0; k < sizeof(batches) / sizeof(batches[0]); k++) {
+      const size_t base = bases[b], n = batches[k];
+      if (n == 0) {
+        continue;
+      }
+      key_t *keys = random_keys(n);
+
+      rbtree *t = build_random(base);
+      double start = now_sec();
+      for (size_t i = 0; i < n; i++) {
+        rbtree_insert(t, keys[i]);
+      }
+      const double loop = now_sec() - start;
+      delete_rbtree(t);
+
+      t = build_random(base);
+      start = now_sec();
+      rbtree_insert_batch(t, keys, n);
+      const double batch = now_sec() - start;
+      if (rbtree_size(t) != base + n) {
+        fprintf(stderr, "size %zu, expected %zu\n", rbtree_size(t), base + n);
+        return 1;
+      }
+      delete_rbtree(t);
+
+      printf("%10zu %10zu %14.1f %14.1f %8.2fx\n", base, n, loop * 1e9 / n, batch * 1e9 / n,
+             loop / batch);
+      free(keys);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,56 @@
+// node 배치별 메모리 사용량 (byte/key)
+// bench-memory (기본), bench-memory-compact (-DRBTREE_COMPACT), bench-memory-malloc (-DRBTREE_NO_POOL)
+// 이 같은 코드로 빌드된다.
+//
+// 사용법 : bench-memory [n]
+//   n 개 (기본 10M) 의 무작위 key 를 insert 한 뒤 늘어난 RSS 를 key 수로 나눈다.
+//   100M 도 재려면 n 을 100000000 으로 준다 (기본 배치 기준 3GB 이상 필요).
+#include <rbtree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long rss_kb(void) {
+  long pages = 0, resident = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f == NULL) {
+    return -1;
+  }
+  if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+    resident = -1;
+  }
+  fclose(f);
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+int main(int argc, char *argv[]) {
+  const size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+  const char *name = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 : argv[0];
+  srand(42);
+
+  const long base = rss_kb();
+  rbtree *t = new_rbtree();
+  const double start = now_sec();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, rand());
+  }
+  const double elapsed = now_sec() - start;
+  const long used = rss_kb() - base;
+
+  // 최적화로 insert 가 사라지지 않도록 결과를 한 번 읽음
+  const node_t *min = rbtree_min(t);
+  printf("%-22s n=%-10zu sizeof(node_t)=%zu  rss=%ld KB  %.1f B/key  insert %.0f ns/op  (min %d)\n",
+         name, n, sizeof(node_t), used, used * 1024.0 / n, elapsed * 1e9 / n,
+         min != NULL ? min->key : 0);
+
+  delete_rbtree(t);
+  return 0;
+}
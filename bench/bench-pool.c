@@ -0,0 +1,83 @@
+// node 할당 경로 비교용 벤치마크
+// bench-pool (slab pool) 과 bench-pool-malloc (-DRBTREE_NO_POOL) 이 같은 코드로 빌드된다.
+//
+// 사용법 : bench-pool [n] [churn]
+//   n     : 처음 채워 넣을 key 수 (기본 1,000,000)
+//   churn : erase + insert 를 반복할 횟수 (기본 n)
+#include <rbtree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// 현재 RSS (KB)
+static long rss_kb(void) {
+  long pages = 0, resident = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f == NULL) {
+    return -1;
+  }
+  if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+    resident = -1;
+  }
+  fclose(f);
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static long peak_rss_kb(void) {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  const size_t churn = argc > 2 ? strtoul(argv[2], NULL, 10) : n;
+  const char *name = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 : argv[0];
+
+  node_t **live = malloc(n * sizeof(node_t *));
+  srand(42);
+  const long base_rss = rss_kb();
+
+  rbtree *t = new_rbtree();
+  double start = now_sec();
+  for (size_t i = 0; i < n; i++) {
+    live[i] = rbtree_insert(t, rand());
+  }
+  const double fill = now_sec() - start;
+  const long fill_rss = rss_kb();
+
+  // 임의의 node 를 지우고 바로 새 key 를 넣는 churn
+  start = now_sec();
+  for (size_t i = 0; i < churn; i++) {
+    const size_t j = (size_t)rand() % n;
+    rbtree_erase(t, live[j]);
+    live[j] = rbtree_insert(t, rand());
+  }
+  const double mix = now_sec() - start;
+  const long churn_rss = rss_kb();
+
+  start = now_sec();
+  delete_rbtree(t);
+  const double teardown = now_sec() - start;
+
+  printf("%-18s n=%zu\n", name, n);
+  printf("  insert      %10.0f ops/s\n", n / fill);
+  printf("  erase+insert%10.0f ops/s\n", 2.0 * churn / mix);
+  printf("  delete      %10.3f ms\n", teardown * 1e3);
+  printf("  rss fill    %10ld KB (%.1f B/key)\n", fill_rss - base_rss,
+         (fill_rss - base_rss) * 1024.0 / n);
+  printf("  rss churn   %10ld KB\n", churn_rss - base_rss);
+  printf("  peak rss    %10ld KB\n", peak_rss_kb());
+
+  free(live);
+  return 0;
+}
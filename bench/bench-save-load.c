@@ -0,0 +1,82 @@
+// rbtree_save / rbtree_load 와 key 를 하나씩 rbtree_insert 로 다시 넣는 재시작 비교
+//
+// 사용법 : bench-save-load [n] [path]
+//   n 개 (기본 10M) 의 무작위 key tree 를 path (기본 bench-save-load.img) 에 저장하고 다시 읽는다.
+//   replay 는 같은 파일을 read 로 읽어 key 마다 insert 한다. (파일에는 정렬된 순서로 있음)
+//   방금 쓴 파일이라 page cache 에 있으므로 디스크가 아닌 메모리 대역폭 기준이다.
+//   50M 은 tree 와 파일을 합쳐 2GB 남짓 필요하다.
+#include <rbtree.h>
+#include <rbtree_io.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// rbtree_io.c 의 header 크기
+#define HEADER_SIZE 24
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static __attribute__((noinline)) rbtree *replay(const char *path, size_t n) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL || fseek(f, HEADER_SIZE, SEEK_SET) != 0) {
+    return NULL;
+  }
+  rbtree *t = new_rbtree();
+  key_t buf[4096];
+  size_t got;
+  while (n > 0 && (got = fread(buf, sizeof(key_t), sizeof(buf) / sizeof(buf[0]), f)) > 0) {
+    for (size_t i = 0; i < got; i++) {
+      rbtree_insert(t, buf[i]);
+    }
+    n -= got;
+  }
+  fclose(f);
+  return t;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+  const char *path = argc > 2 ? argv[2] : "bench-save-load.img";
+  srand(42);
+  rbtree *t = new_rbtree();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, rand());
+  }
+  const double mb = (HEADER_SIZE + n * sizeof(key_t)) / 1e6;
+
+  double start = now_sec();
+  if (rbtree_save(t, path) != 0) {
+    perror(path);
+    return 1;
+  }
+  const double save = now_sec() - start;
+
+  start = now_sec();
+  rbtree *loaded = rbtree_load(path);
+  const double load = now_sec() - start;
+
+  start = now_sec();
+  rbtree *replayed = replay(path, n);
+  const double insert = now_sec() - start;
+  if (loaded == NULL || replayed == NULL || rbtree_size(loaded) != n || rbtree_size(replayed) != n) {
+    fprintf(stderr, "load failed\n");
+    return 1;
+  }
+
+  printf("n = %zu, image %.1f MB\n", n, mb);
+  printf("%-24s %10s %10s %10s\n", "", "ms", "ns/key", "MB/s");
+  printf("%-24s %10.1f %10.1f %10.0f\n", "save (with fsync)", save * 1e3, save * 1e9 / n, mb / save);
+  printf("%-24s %10.1f %10.1f %10.0f\n", "load (mmap)", load * 1e3, load * 1e9 / n, mb / load);
+  printf("%-24s %10.1f %10.1f %10.0f\n", "replay insert", insert * 1e3, insert * 1e9 / n, mb / insert);
+
+  unlink(path);
+  delete_rbtree(replayed);
+  delete_rbtree(loaded);
+  delete_rbtree(t);
+  return 0;
+}
@@ -0,0 +1,95 @@
+// rbtree_union / intersection / difference 와 배열로 꺼내 병합한 뒤 다시 만드는 방법 비교 (ms)
+//
+// 사용법 : bench-set-ops [n]
+//   크기 n 인 tree 와 크기 n / 1000, n / 10, n 인 tree 로 세 연산을 잰다. (기본 n = 1M)
+//   key 는 [0, 2n) 의 무작위 값이라 두 tree 가 반쯤 겹친다.
+//   비교 대상 : rbtree_to_array 로 둘 다 꺼내 병합 → rbtree_from_sorted_array (항상 O(n + m))
+//   thread 수는 CPU 수로 정해진다. (-DRBTREE_SETOP_THREADS=N 으로 빌드하면 고정)
+#include <rbtree.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static rbtree *build_random(size_t n, size_t span) {
+  rbtree *t = new_rbtree();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, rand() % span);
+  }
+  return t;
+}
+
+// 0 합집합, 1 교집합, 2 차집합 (a - b) : 같은 key 는 하나만
+static __attribute__((noinline)) rbtree *merge_baseline(const rbtree *a, const rbtree *b, int mode) {
+  const size_t n = rbtree_size(a), m = rbtree_size(b);
+  key_t *ka = malloc((n + 1) * sizeof(key_t)), *kb = malloc((m + 1) * sizeof(key_t));
+  key_t *out = malloc((n + m + 1) * sizeof(key_t));
+  rbtree_to_array(a, ka, n);
+  rbtree_to_array(b, kb, m);
+  size_t i = 0, j = 0, count = 0;
+  while (i < n || j < m) {
+    const bool fromA = j == m || (i < n && ka[i] <= kb[j]);
+    const key_t key = fromA ? ka[i] : kb[j];
+    const bool inA = i < n && ka[i] == key, inB = j < m && kb[j] == key;
+    while (i < n && ka[i] == key) {
+      i++;
+    }
+    while (j < m && kb[j] == key) {
+      j++;
+    }
+    const bool keep = mode == 0 || (mode == 1 ? inA && inB : inA && !inB);
+    if (keep) {
+      out[count++] = key;
+    }
+  }
+  rbtree *t = rbtree_from_sorted_array(out, count);
+  free(out);
+  free(kb);
+  free(ka);
+  return t;
+}
+
+static __attribute__((noinline)) rbtree *set_op(const rbtree *a, const rbtree *b, int mode) {
+  return mode == 0 ? rbtree_union(a, b) : mode == 1 ? rbtree_intersection(a, b) : rbtree_difference(a, b);
+}
+
+int main(int argc, char *argv[]) {
+  const size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  const size_t others[] = {n / 1000, n / 10, n};
+  const char *names[] = {"union", "intersection", "difference"};
+  srand(42);
+
+  rbtree *a = build_random(n, 2 * n);
+  printf("%10s %10s %-13s %12s %12s %9s %10s\n", "a", "b", "op", "merge ms", "set-op ms", "speedup",
+         "result");
+  for (size_t k = 0; k < sizeof(others) / sizeof(others[0]); k++) {
+    rbtree *b = build_random(others[k], 2 * n);
+    for (int mode = 0; mode < 3; mode++) {
+      double start = now_sec();
+      rbtree *r = merge_baseline(a, b, mode);
+      const double merge = now_sec() - start;
+      const size_t expected = rbtree_size(r);
+      delete_rbtree(r);
+
+      start = now_sec();
+      r = set_op(a, b, mode);
+      const double op = now_sec() - start;
+      if (rbtree_size(r) != expected) {
+        fprintf(stderr, "%s : size %zu, expected %zu\n", names[mode], rbtree_size(r), expected);
+        return 1;
+      }
+      delete_rbtree(r);
+      printf("%10zu %10zu %-13s %12.2f %12.2f %8.2fx %10zu\n", n, others[k], names[mode], merge * 1e3,
+             op * 1e3, merge / op, expected);
+    }
+    delete_rbtree(b);
+  }
+  delete_rbtree(a);
+  return 0;
+}
@@ -0,0 +1,150 @@
+// persistent_rbtree 의 snapshot 비용과 path copying 의 update / 메모리 비용
+//
+// 사용법 : bench-snapshot [n]
+//   n 개 (기본 1M) 의 무작위 key 로 tree 를 만든 뒤
+//   1) snapshot 하나를 뜨는 시간 : persistent_rbtree_snapshot 과 rbtree 를 통째로 복사 (to_array → from_sorted)
+//   2) insert + erase 한 쌍의 시간 : rbtree, snapshot 없는 persistent,
+//      update k 번마다 snapshot 을 뜨고 최근 LIVE_SNAPSHOTS 개만 남기는 persistent
+//      남은 snapshot 들이 붙잡고 있는 메모리 (공유되지 않는 node) 는 malloc 이 쥔 byte 로 잰다.
+//      (놓은 node 는 RSS 로 돌아가지 않으므로 RSS 로는 잴 수 없음)
+#include <malloc.h>
+#include <rbtree.h>
+#include <rbtree_persistent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LIVE_SNAPSHOTS 8
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long rss_kb(void) {
+  long pages = 0, resident = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f == NULL) {
+    return -1;
+  }
+  if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+    resident = -1;
+  }
+  fclose(f);
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static __attribute__((noinline)) rbtree *copy_rbtree(const rbtree *t) {
+  const size_t n = rbtree_size(t);
+  key_t *keys = malloc((n + 1) * sizeof(key_t));
+  rbtree_to_array(t, keys, n);
+  rbtree *copy = rbtree_from_sorted_array(keys, n);
+  free(keys);
+  return copy;
+}
+
+// 무작위 key 하나를 넣고 하나를 지움 (크기 유지)
+static __attribute__((noinline)) void update_rbtree(rbtree *t, size_t ops) {
+  for (size_t i = 0; i < ops; i++) {
+    rbtree_insert(t, rand());
+    node_t *p = rbtree_lower_bound(t, rand());
+    if (p == NULL) {
+      p = rbtree_min(t);
+    }
+    rbtree_erase(t, p);
+  }
+}
+
+// every 번마다 snapshot (0 이면 뜨지 않음). 끝났을 때 남은 snapshot 이 더 쥐고 있는 byte 를 돌려줌
+static __attribute__((noinline)) long update_persistent(persistent_rbtree *t, size_t ops, size_t every) {
+  const long before = (long)mallinfo2().uordblks;
+  persistent_rbtree *snaps[LIVE_SNAPSHOTS] = {NULL};
+  size_t next = 0;
+  for (size_t i = 0; i < ops; i++) {
+    persistent_rbtree_insert(t, rand());
+    // 지울 key 는 rbtree 쪽과 같은 방식으로 고름 : 없으면 가장 작은 key
+    key_t key = rand();
+    if (!persistent_rbtree_find(t, key)) {
+      persistent_rbtree_min(t, &key);
+    }
+    persistent_rbtree_erase(t, key);
+    if (every > 0 && i % every == 0) {
+      if (snaps[next] != NULL) {
+        delete_persistent_rbtree(snaps[next]);
+      }
+      snaps[next] = persistent_rbtree_snapshot(t);
+      next = (next + 1) % LIVE_SNAPSHOTS;
+    }
+  }
+  const long held = (long)mallinfo2().uordblks - before;
+  for (size_t s = 0; s < LIVE_SNAPSHOTS; s++) {
+    if (snaps[s] != NULL) {
+      delete_persistent_rbtree(snaps[s]);
+    }
+  }
+  return held;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  const size_t ops = n / 4;
+  srand(42);
+
+  // 1) snapshot 한 번
+  long base = rss_kb();
+  rbtree *t = new_rbtree();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, rand());
+  }
+  const long rbtreeKb = rss_kb() - base;
+  base = rss_kb();
+  persistent_rbtree *pt = new_persistent_rbtree();
+  for (size_t i = 0; i < n; i++) {
+    persistent_rbtree_insert(pt, rand());
+  }
+  const long persistentKb = rss_kb() - base;
+  printf("n = %zu : rbtree %.1f B/key, persistent %.1f B/key\n", n, rbtreeKb * 1024.0 / n,
+         persistentKb * 1024.0 / n);
+
+  double start = now_sec();
+  rbtree *copy = copy_rbtree(t);
+  const double copyTime = now_sec() - start;
+  start = now_sec();
+  persistent_rbtree *snap = persistent_rbtree_snapshot(pt);
+  const double snapTime = now_sec() - start;
+  printf("%-28s %14.1f us\n", "rbtree copy", copyTime * 1e6);
+  printf("%-28s %14.3f us\n", "persistent snapshot", snapTime * 1e6);
+  delete_rbtree(copy);
+  delete_persistent_rbtree(snap);
+
+  // 2) update 비용 : 같은 key 순서로
+  printf("\n%-28s %14s %14s\n", "update (insert + erase)", "ns/op", "held KB");
+  srand(7);
+  start = now_sec();
+  update_rbtree(t, ops);
+  printf("%-28s %14.1f %14s\n", "rbtree", (now_sec() - start) * 1e9 / ops, "-");
+
+  const size_t everies[] = {0, 10000, 100, 1};
+  for (size_t e = 0; e < sizeof(everies) / sizeof(everies[0]); e++) {
+    srand(7);
+    start = now_sec();
+    const long held = update_persistent(pt, ops, everies[e]);
+    const double elapsed = now_sec() - start;
+    char label[64];
+    if (everies[e] == 0) {
+      snprintf(label, sizeof(label), "persistent, no snapshot");
+    } else {
+      snprintf(label, sizeof(label), "persistent, snapshot/%zu", everies[e]);
+    }
+    printf("%-28s %14.1f %14ld\n", label, elapsed * 1e9 / ops, held / 1024);
+  }
+  if (persistent_rbtree_size(pt) != n || rbtree_size(t) != n) {
+    fprintf(stderr, "size %zu / %zu, expected %zu\n", persistent_rbtree_size(pt), rbtree_size(t), n);
+    return 1;
+  }
+  delete_persistent_rbtree(pt);
+  delete_rbtree(t);
+  return 0;
+}
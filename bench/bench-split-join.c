@@ -0,0 +1,83 @@
+// rbtree_split / rbtree_join 과 배열로 꺼내서 두 tree 를 다시 만드는 방법 비교 (us/op)
+//
+// 사용법 : bench-split-join [n] [rounds]
+//   무작위 key n 개 (기본 10M) 의 tree 를 무작위 key 에서 나눴다가 다시 합치기를 rounds 번 (기본 100)
+//   비교 대상은 rbtree_to_array 로 꺼내 rbtree_from_sorted_array 로 두 tree 를 만들고, 합칠 때 다시 한 번 만드는 것.
+#include <rbtree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+  const int rounds = argc > 2 ? atoi(argv[2]) : 100;
+  srand(42);
+  key_t *keys = malloc(n * sizeof(key_t));
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = rand();
+  }
+  rbtree *t = new_rbtree();
+  rbtree_insert_batch(t, keys, n);
+
+  // split + join : pivot 은 오른쪽 조각의 최소 key (합친 뒤 그 key 를 하나 지워 크기를 유지)
+  double split = 0, join = 0;
+  for (int r = 0; r < rounds; r++) {
+    rbtree *left, *right;
+    double start = now_sec();
+    rbtree_split(t, rand(), &left, &right);
+    split += now_sec() - start;
+    if (rbtree_size(right) == 0) {
+      t = rbtree_join(left, RAND_MAX, right);
+      rbtree_erase(t, rbtree_max(t));
+      continue;
+    }
+    const key_t pivot = rbtree_min(right)->key;
+    start = now_sec();
+    t = rbtree_join(left, pivot, right);
+    join += now_sec() - start;
+    rbtree_erase(t, rbtree_find(t, pivot));
+  }
+  if (rbtree_size(t) != n) {
+    fprintf(stderr, "size %zu, expected %zu\n", rbtree_size(t), n);
+    return 1;
+  }
+
+  // 배열로 꺼내서 다시 만들기 (몇 번만 : 한 번이 n 에 비례)
+  const int copyRounds = rounds < 3 ? rounds : 3;
+  double copySplit = 0, copyJoin = 0;
+  key_t *arr = malloc(n * sizeof(key_t));
+  for (int r = 0; r < copyRounds; r++) {
+    double start = now_sec();
+    rbtree_to_array(t, arr, n);
+    const size_t cut = (size_t)rand() % n;
+    rbtree *left = rbtree_from_sorted_array(arr, cut);
+    rbtree *right = rbtree_from_sorted_array(arr + cut, n - cut);
+    copySplit += now_sec() - start;
+    start = now_sec();
+    rbtree_to_array(left, arr, cut);
+    rbtree_to_array(right, arr + cut, n - cut);
+    rbtree *joined = rbtree_from_sorted_array(arr, n);
+    copyJoin += now_sec() - start;
+    delete_rbtree(left);
+    delete_rbtree(right);
+    delete_rbtree(joined);
+  }
+
+  printf("n = %zu\n", n);
+  printf("%-20s %14s %14s\n", "", "split us/op", "join us/op");
+  printf("%-20s %14.1f %14.1f\n", "split / join", split * 1e6 / rounds, join * 1e6 / rounds);
+  if (copyRounds > 0) {
+    printf("%-20s %14.1f %14.1f\n", "copy via array", copySplit * 1e6 / copyRounds,
+           copyJoin * 1e6 / copyRounds);
+  }
+  free(arr);
+  free(keys);
+  delete_rbtree(t);
+  return 0;
+}
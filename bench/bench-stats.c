@@ -0,0 +1,81 @@
+// -DRBTREE_STATS counter 로 본 insert / erase 의 재균형 비용
+//
+// 사용법 : bench-stats [n]
+//   key 순서 (증가, 감소, 무작위) 별로 n 개 (기본 1M) 를 넣고, 무작위로 찾은 뒤 전부 지우며
+//   op 하나당 fixup 반복 / 회전 수, erase 의 CASE 1 ~ 4 비율, find 의 비교 수와 끝난 tree 의 모양을 보여줌
+//   (counter 를 세는 비용이 궁금하면 같은 n 으로 bench-suite 와 비교)
+#include <rbtree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static __attribute__((noinline)) void run(const char *name, const key_t *keys, size_t n) {
+  rbtree *t = new_rbtree();
+  const double t0 = now_sec();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, keys[i]);
+  }
+  const double t1 = now_sec();
+  rbtree_stats_t built;
+  rbtree_stats(t, &built);
+
+  size_t found = 0;
+  for (size_t i = 0; i < n; i++) {
+    found += rbtree_find(t, keys[rand() % n]) != NULL;
+  }
+  rbtree_stats_t searched;
+  rbtree_stats(t, &searched);
+
+  // 넣은 순서대로 지움
+  const double t2 = now_sec();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_erase(t, rbtree_find(t, keys[i]));
+  }
+  const double t3 = now_sec();
+  rbtree_stats_t end;
+  rbtree_stats(t, &end);
+  const rbtree_counters_t *c = &end.ops;
+  const double erases = c->erases > 0 ? (double)c->erases : 1;
+
+  printf("%-10s insert %6.1f ns  fixups %.3f  rotations %.3f  | height %d (bh %d, avg depth %.2f)\n", name,
+         (t1 - t0) * 1e9 / n, (double)c->insert_fixups / n, (double)c->insert_rotations / n, built.height,
+         built.black_height, built.avg_depth);
+  printf("%-10s find   comparisons %.2f (found %zu)\n", "", (double)searched.ops.comparisons / searched.ops.searches,
+         found);
+  printf("%-10s erase  %6.1f ns  fixups %.3f  rotations %.3f  CASE 1 %.3f  2 %.3f  3 %.3f  4 %.3f\n", "",
+         (t3 - t2) * 1e9 / n, c->erase_fixups / erases, c->erase_rotations / erases, c->erase_cases[0] / erases,
+         c->erase_cases[1] / erases, c->erase_cases[2] / erases, c->erase_cases[3] / erases);
+  printf("%-10s alloc  nodes %llu  frees %llu  slabs %llu\n", "", (unsigned long long)c->node_allocs,
+         (unsigned long long)c->node_frees, (unsigned long long)c->slab_allocs);
+  delete_rbtree(t);
+}
+
+int main(int argc, char *argv[]) {
+  const size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  if (n == 0) {
+    return 0;
+  }
+  key_t *keys = malloc(n * sizeof(key_t));
+  srand(1);
+
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = (key_t)i;
+  }
+  run("ascending", keys, n);
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = (key_t)(n - i);
+  }
+  run("descending", keys, n);
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = rand();
+  }
+  run("random", keys, n);
+  free(keys);
+  return 0;
+}
@@ -0,0 +1,327 @@
+// rbtree 기본 API 의 분포별 / 크기별 측정 : ns/op, 지연 백분위, cache miss (perf_event_open)
+//
+// 사용법 : bench-suite [-s 1000,100000,1000000] [-c out.csv] [-j out.json]
+//   분포 : sequential (0, 1, 2, ...), random, zipf (s = 0.99, 인기 key 가 반복), dup (n / 100 가지 key)
+//   분포마다 n 개 insert → 같은 분포에서 뽑은 n 개 find → min / max 를 번갈아 n 번 → to_array → 전부 erase
+//   지연은 op 마다 시계를 읽어 재고 (시계 한 번 읽는 비용은 빼서) 백분위를 낸다.
+//   cache miss 는 perf_event_open 으로 세며, 쓸 수 없는 환경 (VM, perf_event_paranoid) 이면 -1 로 적는다.
+//   -c / -j 를 주면 같은 결과를 CSV / JSON 으로도 쓴다. (make bench 에서는 out/ 아래에 씀)
+#include <linux/perf_event.h>
+#include <math.h>
+#include <rbtree.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_SIZES 16
+#define ZIPF_S 0.99
+
+typedef enum { DIST_SEQUENTIAL, DIST_RANDOM, DIST_ZIPF, DIST_DUP, DIST_COUNT } dist_t;
+static const char *dist_names[DIST_COUNT] = {"sequential", "random", "zipf", "dup"};
+
+typedef struct {
+  const char *dist, *op;
+  size_t size, ops;
+  double ns_per_op, p50, p90, p99, p999, max;
+  double misses_per_op;  // 못 세면 -1
+} result_t;
+
+static result_t *results;
+static size_t result_count, result_cap;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// 시계를 연달아 읽을 때의 간격 (중앙값) : op 마다의 지연에서 뺀다
+static uint64_t timer_overhead;
+
+static int comp_u64(const void *p1, const void *p2) {
+  const uint64_t e1 = *(const uint64_t *)p1;
+  const uint64_t e2 = *(const uint64_t *)p2;
+  return (e1 > e2) - (e1 < e2);
+}
+
+static void calibrate_timer(void) {
+  uint64_t gaps[1001];
+  uint64_t prev = now_ns();
+  for (int i = 0; i < 1001; i++) {
+    const uint64_t cur = now_ns();
+    gaps[i] = cur - prev;
+    prev = cur;
+  }
+  qsort(gaps, 1001, sizeof(uint64_t), comp_u64);
+  timer_overhead = gaps[500];
+}
+
+// cache miss counter : 열지 못하면 -1
+static int perf_open(void) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static int perf_fd = -1;
+
+static void perf_start(void) {
+  if (perf_fd >= 0) {
+    ioctl(perf_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+static long long perf_stop(void) {
+  long long count = -1;
+  if (perf_fd >= 0) {
+    ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(perf_fd, &count, sizeof(count)) != sizeof(count)) {
+      count = -1;
+    }
+  }
+  return count;
+}
+
+// 한 구간 측정 : lat[0, ops) 는 op 마다 잰 시각 차 (정렬해서 씀), elapsed 는 구간 전체
+static void record(const char *dist, const char *op, size_t size, uint64_t *lat, size_t ops, uint64_t elapsed,
+                   long long misses) {
+  if (result_count == result_cap) {
+    result_cap = result_cap == 0 ? 64 : result_cap * 2;
+    results = realloc(results, result_cap * sizeof(result_t));
+  }
+  for (size_t i = 0; i < ops; i++) {
+    lat[i] = lat[i] > timer_overhead ? lat[i] - timer_overhead : 0;
+  }
+  qsort(lat, ops, sizeof(uint64_t), comp_u64);
+  const double per_op = (double)elapsed / ops - (double)timer_overhead;
+  result_t r = {dist, op, size, ops, per_op > 0 ? per_op : 0, lat[ops / 2], lat[ops * 9 / 10], lat[ops * 99 / 100],
+                lat[ops * 999 / 1000], lat[ops - 1], misses < 0 ? -1 : (double)misses / ops};
+  results[result_count++] = r;
+  printf("%-11s %9zu %-9s %9.1f %8.0f %8.0f %8.0f %8.0f %10.0f", dist, size, op, r.ns_per_op, r.p50, r.p90, r.p99,
+         r.p999, r.max);
+  if (r.misses_per_op < 0) {
+    printf(" %12s\n", "-");
+  } else {
+    printf(" %12.2f\n", r.misses_per_op);
+  }
+}
+
+// 측정 구간 : 시계를 op 마다 한 번 읽고, 앞 op 의 끝을 다음 op 의 시작으로 씀
+#define MEASURE(DIST, OP, SIZE, OPS, LAT, BODY)                   \
+  do {                                                            \
+    perf_start();                                                 \
+    const uint64_t start_ = now_ns();                             \
+    uint64_t prev_ = start_;                                      \
+    for (size_t i = 0; i < (OPS); i++) {                          \
+      BODY;                                                       \
+      const uint64_t cur_ = now_ns();                             \
+      (LAT)[i] = cur_ - prev_;                                    \
+      prev_ = cur_;                                               \
+    }                                                             \
+    const long long misses_ = perf_stop();                        \
+    record(DIST, OP, SIZE, LAT, OPS, prev_ - start_, misses_);    \
+  } while (0)
+
+// zipf 순위 (0 이 가장 인기) 를 누적 분포에서 뽑음
+static size_t zipf_rank(const double *cdf, size_t n) {
+  const double u = (double)rand() / ((double)RAND_MAX + 1);
+  size_t lo = 0, hi = n - 1;
+  while (lo < hi) {
+    const size_t mid = (lo + hi) / 2;
+    if (cdf[mid] < u) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// 분포에서 n 개. zipf 는 순위를 곱셈 해시로 흩어 인기 key 가 key 공간에 몰리지 않게 한다
+static void fill_keys(dist_t dist, key_t *keys, size_t n, const double *cdf) {
+  for (size_t i = 0; i < n; i++) {
+    switch (dist) {
+      case DIST_SEQUENTIAL:
+        keys[i] = (key_t)i;
+        break;
+      case DIST_RANDOM:
+        keys[i] = rand();
+        break;
+      case DIST_ZIPF:
+        keys[i] = (key_t)((uint32_t)zipf_rank(cdf, n) * 2654435761u >> 1);
+        break;
+      default:
+        keys[i] = rand() % (key_t)(n / 100 + 1);
+        break;
+    }
+  }
+}
+
+static __attribute__((noinline)) double *zipf_cdf(size_t n) {
+  double *cdf = malloc(n * sizeof(double));
+  double sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    sum += 1.0 / pow((double)(i + 1), ZIPF_S);
+    cdf[i] = sum;
+  }
+  for (size_t i = 0; i < n; i++) {
+    cdf[i] /= sum;
+  }
+  return cdf;
+}
+
+static __attribute__((noinline)) void bench_dist(dist_t dist, size_t n) {
+  const char *name = dist_names[dist];
+  double *cdf = dist == DIST_ZIPF ? zipf_cdf(n) : NULL;
+  key_t *keys = malloc(n * sizeof(key_t)), *queries = malloc(n * sizeof(key_t));
+  fill_keys(dist, keys, n, cdf);
+  fill_keys(dist, queries, n, cdf);
+  if (dist == DIST_SEQUENTIAL) {
+    // 찾는 순서는 무작위로
+    for (size_t i = 0; i < n; i++) {
+      queries[i] = rand() % (key_t)n;
+    }
+  }
+  uint64_t *lat = malloc(n * sizeof(uint64_t));
+  node_t **nodes = malloc(n * sizeof(node_t *));
+  size_t sink = 0;
+
+  rbtree *t = new_rbtree();
+  MEASURE(name, "insert", n, n, lat, nodes[i] = rbtree_insert(t, keys[i]));
+  MEASURE(name, "find", n, n, lat, sink += rbtree_find(t, queries[i]) != NULL);
+  MEASURE(name, "min/max", n, n, lat, sink += (size_t)((i & 1) ? rbtree_max(t) : rbtree_min(t)));
+
+  // to_array 는 호출 한 번이 n 개를 쓰므로 key 당으로 나눔 (백분위는 의미 없어 모두 평균)
+  key_t *arr = malloc(n * sizeof(key_t));
+  perf_start();
+  const uint64_t start = now_ns();
+  sink += rbtree_to_array(t, arr, n) == 0;
+  const uint64_t whole = now_ns() - start + timer_overhead * (n - 1);
+  const long long misses = perf_stop();
+  for (size_t i = 0; i < n; i++) {
+    lat[i] = whole / n;
+  }
+  record(name, "to_array", n, lat, n, whole, misses);
+  free(arr);
+
+  // insert 가 돌려준 node 를 insert 순서대로 지움 (erase 는 다른 node 를 옮기지 않음)
+  MEASURE(name, "erase", n, n, lat, rbtree_erase(t, nodes[i]));
+  if (rbtree_size(t) != 0 || sink == 0) {
+    fprintf(stderr, "%s : %zu left\n", name, rbtree_size(t));
+    exit(1);
+  }
+  delete_rbtree(t);
+  free(nodes);
+  free(lat);
+  free(queries);
+  free(keys);
+  free(cdf);
+}
+
+static void write_csv(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (f == NULL) {
+    perror(path);
+    return;
+  }
+  fprintf(f, "dist,size,op,ops,ns_per_op,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,cache_misses_per_op\n");
+  for (size_t i = 0; i < result_count; i++) {
+    const result_t *r = &results[i];
+    fprintf(f, "%s,%zu,%s,%zu,%.2f,%.0f,%.0f,%.0f,%.0f,%.0f,", r->dist, r->size, r->op, r->ops, r->ns_per_op, r->p50,
+            r->p90, r->p99, r->p999, r->max);
+    // 못 센 cache miss 는 빈 칸
+    if (r->misses_per_op >= 0) {
+      fprintf(f, "%.3f", r->misses_per_op);
+    }
+    fprintf(f, "\n");
+  }
+  fclose(f);
+}
+
+static void write_json(const char *path, time_t started) {
+  FILE *f = fopen(path, "w");
+  if (f == NULL) {
+    perror(path);
+    return;
+  }
+  fprintf(f, "{\n  \"timestamp\": %lld,\n  \"timer_overhead_ns\": %llu,\n  \"results\": [\n", (long long)started,
+          (unsigned long long)timer_overhead);
+  for (size_t i = 0; i < result_count; i++) {
+    const result_t *r = &results[i];
+    fprintf(f,
+            "    {\"dist\": \"%s\", \"size\": %zu, \"op\": \"%s\", \"ops\": %zu, \"ns_per_op\": %.2f, "
+            "\"p50_ns\": %.0f, \"p90_ns\": %.0f, \"p99_ns\": %.0f, \"p999_ns\": %.0f, \"max_ns\": %.0f, "
+            "\"cache_misses_per_op\": ",
+            r->dist, r->size, r->op, r->ops, r->ns_per_op, r->p50, r->p90, r->p99, r->p999, r->max);
+    if (r->misses_per_op < 0) {
+      fprintf(f, "null}");
+    } else {
+      fprintf(f, "%.3f}", r->misses_per_op);
+    }
+    fprintf(f, "%s\n", i + 1 < result_count ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+  fclose(f);
+}
+
+int main(int argc, char *argv[]) {
+  size_t sizes[MAX_SIZES] = {1000, 100000, 1000000};
+  size_t size_count = 3;
+  const char *csv = NULL, *json = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:c:j:")) != -1) {
+    if (opt == 's') {
+      size_count = 0;
+      for (char *tok = strtok(optarg, ","); tok != NULL && size_count < MAX_SIZES; tok = strtok(NULL, ",")) {
+        sizes[size_count++] = strtoul(tok, NULL, 10);
+      }
+    } else if (opt == 'c') {
+      csv = optarg;
+    } else if (opt == 'j') {
+      json = optarg;
+    } else {
+      fprintf(stderr, "usage: %s [-s sizes] [-c out.csv] [-j out.json]\n", argv[0]);
+      return 1;
+    }
+  }
+  const time_t started = time(NULL);
+  srand(42);
+  calibrate_timer();
+  perf_fd = perf_open();
+  printf("timer overhead %llu ns, cache misses %s\n", (unsigned long long)timer_overhead,
+         perf_fd >= 0 ? "on" : "unavailable");
+  printf("%-11s %9s %-9s %9s %8s %8s %8s %8s %10s %12s\n", "dist", "size", "op", "ns/op", "p50", "p90", "p99", "p99.9",
+         "max", "miss/op");
+
+  for (size_t s = 0; s < size_count; s++) {
+    if (sizes[s] < 2) {
+      continue;
+    }
+    for (int d = 0; d < DIST_COUNT; d++) {
+      bench_dist((dist_t)d, sizes[s]);
+    }
+  }
+  if (csv != NULL) {
+    write_csv(csv);
+  }
+  if (json != NULL) {
+    write_json(json, started);
+  }
+  if (perf_fd >= 0) {
+    close(perf_fd);
+  }
+  free(results);
+  return 0;
+}
@@ -0,0 +1,67 @@
+// rbtree_to_array 순회 비용 (ns/element)
+//
+// 사용법 : bench-to-array [max_n]
+//   1K 부터 10 배씩 max_n 까지 (기본 100M) 무작위 순서로 insert 한 tree 를 배열로 변환한다.
+//   100M 은 node 만 3GB 가 넘으므로 메모리가 부족하면 max_n 을 줄여서 돌린다.
+#include <rbtree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// 0 .. n-1 을 섞어서 insert → node 주소와 key 순서가 무관해짐
+static rbtree *build_shuffled(size_t n) {
+  key_t *keys = malloc(n * sizeof(key_t));
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = (key_t)i;
+  }
+  for (size_t i = n - 1; i > 0; i--) {
+    size_t j = ((size_t)rand() * RAND_MAX + rand()) % (i + 1);
+    key_t tmp = keys[i];
+    keys[i] = keys[j];
+    keys[j] = tmp;
+  }
+  rbtree *t = new_rbtree();
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, keys[i]);
+  }
+  free(keys);
+  return t;
+}
+
+int main(int argc, char *argv[]) {
+  const size_t max_n = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000000;
+  srand(42);
+
+  printf("%12s %8s %12s\n", "n", "reps", "ns/element");
+  for (size_t n = 1000; n <= max_n; n *= 10) {
+    rbtree *t = build_shuffled(n);
+    key_t *arr = malloc(n * sizeof(key_t));
+
+    // 최소 0.2 초 혹은 3 회 이상 반복
+    size_t reps = 0;
+    double elapsed = 0;
+    const double start = now_sec();
+    while (reps < 3 || elapsed < 0.2) {
+      rbtree_to_array(t, arr, n);
+      reps++;
+      elapsed = now_sec() - start;
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (arr[i] != (key_t)i) {
+        fprintf(stderr, "wrong order at %zu\n", i);
+        return 1;
+      }
+    }
+    printf("%12zu %8zu %12.2f\n", n, reps, elapsed * 1e9 / ((double)n * reps));
+
+    free(arr);
+    delete_rbtree(t);
+  }
+  return 0;
+}
@@ -0,0 +1,173 @@
+// trace 파일 (src/rbtree_trace.h) 을 rbtree 에 그대로 다시 돌리고 연산별 지연 분포를 보여줌
+//
+// 사용법 : rbtree-replay [-r repeat] trace
+//   기록은 -DRBTREE_TRACE 로 build 한 engine 에서 rbtree_trace_start / rbtree_trace_stop 사이에 남긴다.
+//   1) 시계 없이 trace 를 통째로 repeat 번 (기본 3) 돌려 가장 빠른 처리량
+//   2) op 마다 시계를 읽어 (읽는 비용은 빼고) insert / find / erase 별 2 배 간격 histogram 과 백분위
+//   erase 는 그 key 의 node 하나를 찾아 지운다. (없으면 find 만 한 셈)
+#include <rbtree.h>
+#include <rbtree_trace.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BUCKETS 32  // [2^(b-1), 2^b) ns, 0 번은 1 ns 미만
+#define BAR 40
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int comp_u64(const void *p1, const void *p2) {
+  const uint64_t e1 = *(const uint64_t *)p1;
+  const uint64_t e2 = *(const uint64_t *)p2;
+  return (e1 > e2) - (e1 < e2);
+}
+
+static uint64_t timer_overhead(void) {
+  uint64_t gaps[1001];
+  uint64_t prev = now_ns();
+  for (int i = 0; i < 1001; i++) {
+    const uint64_t cur = now_ns();
+    gaps[i] = cur - prev;
+    prev = cur;
+  }
+  qsort(gaps, 1001, sizeof(uint64_t), comp_u64);
+  return gaps[500];
+}
+
+static inline int apply(rbtree *t, const rbtree_trace_rec_t *r) {
+  switch (r->op) {
+    case RBTREE_TRACE_INSERT:
+      rbtree_insert(t, r->key);
+      return 0;
+    case RBTREE_TRACE_FIND:
+      return rbtree_find(t, r->key) != NULL;
+    default: {
+      node_t *p = rbtree_find(t, r->key);
+      if (p != NULL) {
+        rbtree_erase(t, p);
+      }
+      return p != NULL;
+    }
+  }
+}
+
+static __attribute__((noinline)) uint64_t replay(const rbtree_trace_rec_t *recs, size_t n, size_t *hits) {
+  rbtree *t = new_rbtree();
+  *hits = 0;
+  const uint64_t start = now_ns();
+  for (size_t i = 0; i < n; i++) {
+    *hits += apply(t, &recs[i]);
+  }
+  const uint64_t elapsed = now_ns() - start;
+  delete_rbtree(t);
+  return elapsed;
+}
+
+// op 별로 lat[op] 에 지연을 모음 (counts[op] 개)
+static __attribute__((noinline)) void replay_timed(const rbtree_trace_rec_t *recs, size_t n, uint64_t overhead,
+                                                   uint64_t **lat, size_t *counts) {
+  rbtree *t = new_rbtree();
+  uint64_t prev = now_ns();
+  for (size_t i = 0; i < n; i++) {
+    apply(t, &recs[i]);
+    const uint64_t cur = now_ns();
+    const uint8_t op = recs[i].op;
+    lat[op][counts[op]++] = cur - prev > overhead ? cur - prev - overhead : 0;
+    prev = cur;
+  }
+  delete_rbtree(t);
+}
+
+static void print_histogram(const char *name, uint64_t *lat, size_t n) {
+  if (n == 0) {
+    return;
+  }
+  qsort(lat, n, sizeof(uint64_t), comp_u64);
+  printf("\n%s : %zu ops, p50 %llu  p90 %llu  p99 %llu  p99.9 %llu  max %llu ns\n", name, n,
+         (unsigned long long)lat[n / 2], (unsigned long long)lat[n * 9 / 10], (unsigned long long)lat[n * 99 / 100],
+         (unsigned long long)lat[n * 999 / 1000], (unsigned long long)lat[n - 1]);
+  size_t hist[BUCKETS] = {0};
+  for (size_t i = 0; i < n; i++) {
+    int b = 0;
+    while (b < BUCKETS - 1 && lat[i] >> b != 0) {
+      b++;
+    }
+    hist[b]++;
+  }
+  size_t peak = 0;
+  int first = BUCKETS, last = 0;
+  for (int b = 0; b < BUCKETS; b++) {
+    if (hist[b] > 0) {
+      peak = hist[b] > peak ? hist[b] : peak;
+      first = b < first ? b : first;
+      last = b;
+    }
+  }
+  for (int b = first; b <= last; b++) {
+    const unsigned long long lo = b == 0 ? 0 : 1ull << (b - 1), hi = 1ull << b;
+    printf("  %9llu - %-9llu %10zu %6.2f%% ", lo, hi, hist[b], 100.0 * hist[b] / n);
+    for (size_t k = 0; k < (hist[b] * BAR + peak - 1) / peak; k++) {
+      putchar('#');
+    }
+    putchar('\n');
+  }
+}
+
+int main(int argc, char *argv[]) {
+  int repeat = 3;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:")) != -1) {
+    if (opt == 'r') {
+      repeat = atoi(optarg);
+    } else {
+      break;
+    }
+  }
+  if (optind != argc - 1 || repeat < 1) {
+    fprintf(stderr, "usage: %s [-r repeat] trace\n", argv[0]);
+    return 1;
+  }
+  size_t n;
+  rbtree_trace_rec_t *recs = rbtree_trace_load(argv[optind], &n);
+  if (recs == NULL) {
+    fprintf(stderr, "%s : not a trace file\n", argv[optind]);
+    return 1;
+  }
+  size_t counts[RBTREE_TRACE_OPS] = {0};
+  for (size_t i = 0; i < n; i++) {
+    counts[recs[i].op]++;
+  }
+  printf("%s : %zu ops (insert %zu / find %zu / erase %zu)\n", argv[optind], n, counts[RBTREE_TRACE_INSERT],
+         counts[RBTREE_TRACE_FIND], counts[RBTREE_TRACE_ERASE]);
+
+  uint64_t best = UINT64_MAX;
+  size_t hits = 0;
+  for (int r = 0; r < repeat; r++) {
+    const uint64_t elapsed = replay(recs, n, &hits);
+    best = elapsed < best ? elapsed : best;
+  }
+  printf("full speed : %.3f s, %.2f Mops/s, %.1f ns/op (best of %d), find / erase hits %zu\n", best * 1e-9,
+         best > 0 ? n * 1e3 / best : 0, n > 0 ? (double)best / n : 0, repeat, hits);
+
+  const uint64_t overhead = timer_overhead();
+  uint64_t *lat[RBTREE_TRACE_OPS];
+  for (int op = 0; op < RBTREE_TRACE_OPS; op++) {
+    lat[op] = malloc((counts[op] + 1) * sizeof(uint64_t));
+    counts[op] = 0;
+  }
+  replay_timed(recs, n, overhead, lat, counts);
+  printf("per-op latency (timer overhead %llu ns subtracted)\n", (unsigned long long)overhead);
+  const char *names[RBTREE_TRACE_OPS] = {"insert", "find", "erase"};
+  for (int op = 0; op < RBTREE_TRACE_OPS; op++) {
+    print_histogram(names[op], lat[op], counts[op]);
+    free(lat[op]);
+  }
+  free(recs);
+  return 0;
+}
@@ -1,50 +1,234 @@
 #include "rbtree.h"
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
-static node_t _nil = {
-    .color = RBTREE_BLACK,
-    .key = 0,
-    .parent = NULL,
-    .left = NULL,
-    .right = NULL};
+/*
+color / parent 접근자
+-DRBTREE_COMPACT 로 빌드하면 color 를 parent 포인터의 최하위 비트에 넣으므로
+두 필드는 항상 이 매크로로만 읽고 쓴다.
+*/
+#define COLOR(n) RBTREE_COLOR(n)
+#define PARENT(n) RBTREE_PARENT(n)
+#ifdef RBTREE_COMPACT
+#define SET_COLOR(n, c) ((n)->parent_color = ((n)->parent_color & ~(uintptr_t)1) | (uintptr_t)(c))
+#define SET_PARENT(n, p) ((n)->parent_color = (uintptr_t)(p) | ((n)->parent_color & 1))
+#else
+#define SET_COLOR(n, c) ((n)->color = (c))
+#define SET_PARENT(n, p) ((n)->parent = (p))
+#endif
+
+/*
+연산 기록 (src/rbtree_trace.h)
+-DRBTREE_TRACE 로 빌드하면 insert / find / erase 가 들어올 때마다 rbtree_trace_record 를 부른다.
+*/
+#ifdef RBTREE_TRACE
+#include "rbtree_trace.h"
+#define TRACE(op, key) rbtree_trace_record((op), (key))
+#else
+#define TRACE(op, key) ((void)0)
+#endif
+
+/*
+연산 counter (rbtree_counters_t)
+-DRBTREE_STATS 로 빌드하면 tree 마다 회전, fixup 반복, erase 의 CASE, 비교, 할당 수를 센다.
+find 계열은 const tree 를 받지만 counter 만 고친다.
+find 계열은 read lock 아래 여러 thread 가 같이 부르므로 (rbtree_concurrent.c) 그 counter 는 STAT_SHARED 로
+호출 끝에 한 번 atomic 하게 더한다.
+*/
+#ifdef RBTREE_STATS
+#define STAT(t, field) ((t)->counters.field++)
+#define STAT_SHARED(t, field, n) __atomic_fetch_add(&((rbtree *)(t))->counters.field, (n), __ATOMIC_RELAXED)
+#else
+#define STAT(t, field) ((void)0)
+#define STAT_SHARED(t, field, n) ((void)(n))
+#endif
 
-const static node_t *NIL = &_nil;
 
-__attribute__((constructor)) // GCC 전용: main 전에 실행됨
-static void
-init_nil_node()
+/*
+node 할당기
+tree 마다 slab 을 잡아 두고 node 를 잘라 쓰며, erase 된 node 는 free_list 에 넣어 재사용한다.
+slab 크기는 POOL_MIN_SLAB 부터 두 배씩 늘려 POOL_MAX_SLAB 에서 멈춘다.
+-DRBTREE_NO_POOL 로 빌드하면 예전처럼 node 마다 malloc/free 를 한다. (비교, valgrind 확인용)
+*/
+#define POOL_MIN_SLAB 32
+#define POOL_MAX_SLAB 4096
+
+#ifndef RBTREE_NO_POOL
+static node_slab_t *_new_slab(size_t cap)
 {
-    _nil.parent = &_nil;
-    _nil.left = &_nil;
-    _nil.right = &_nil;
+    // nodes 가 cache line 에 맞도록 slab 자체를 정렬해서 할당
+    void *mem = NULL;
+    const size_t size = sizeof(node_slab_t) + cap * sizeof(node_t);
+    if (posix_memalign(&mem, _Alignof(node_slab_t), size) != 0)
+    {
+        return NULL;
+    }
+    // 0 으로 채워 둠 : lock 없이 읽는 reader (rbtree_concurrent.c) 가 아직 연결 중인 node 를 봐도
+    // 쓰레기 포인터 대신 NULL 을 읽게 된다.
+    memset(mem, 0, size);
+    node_slab_t *slab = mem;
+    slab->cap = cap;
+    return slab;
 }
 
-rbtree *new_rbtree(void)
+// 같은 저장소를 쓰는 다른 tree 가 다른 thread 에서 동시에 붙일 수 있음
+static void _push_slab(node_store_t *store, node_slab_t *slab)
+{
+    slab->next = __atomic_load_n(&store->slabs, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&store->slabs, &slab->next, slab, true, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED))
+        ;
+}
+
+// slab 을 잡지 못하면 pool 은 그대로 두고 false
+static bool _pool_grow(node_pool_t *pool, size_t cap)
+{
+    node_slab_t *slab = _new_slab(cap);
+    if (slab == NULL)
+    {
+        return false;
+    }
+    _push_slab(pool->store, slab);
+    pool->slab = slab;
+    pool->used = 0;
+    return true;
+}
+#endif
+
+// 메모리가 모자라면 NULL
+static node_t *_alloc_node(rbtree *t)
+{
+    STAT(t, node_allocs);
+#ifdef RBTREE_NO_POOL
+    return malloc(sizeof(node_t));
+#else
+    node_pool_t *pool = &t->pool;
+    node_t *node = pool->free_list;
+    if (node != NULL)
+    {
+        pool->free_list = node->right;
+        return node;
+    }
+    if (pool->slab == NULL || pool->used == pool->slab->cap)
+    {
+        size_t cap = pool->slab == NULL ? POOL_MIN_SLAB : pool->slab->cap * 2;
+        STAT(t, slab_allocs);
+        if (!_pool_grow(pool, cap > POOL_MAX_SLAB ? POOL_MAX_SLAB : cap))
+        {
+            return NULL;
+        }
+    }
+    return &pool->slab->nodes[pool->used++];
+#endif
+}
+
+static void _free_node(rbtree *t, node_t *node)
+{
+    STAT(t, node_frees);
+#ifdef RBTREE_NO_POOL
+    free(node);
+#else
+    node->right = t->pool.free_list;
+    t->pool.free_list = node;
+#endif
+}
+
+// store 를 같이 쓰는 빈 tree (store 가 NULL 이면 새 저장소를 만듦)
+// 메모리가 모자라면 NULL
+static rbtree *_new_tree(node_store_t *store)
 {
     rbtree *t = (rbtree *)calloc(1, sizeof(rbtree));
-    t->nil = NIL;
+    if (t == NULL)
+    {
+        return NULL;
+    }
+    if (store == NULL)
+    {
+        // sentinel 은 저장소 안에 같이 할당 : 관계없는 tree 와 메모리를 공유하지 않음
+        store = calloc(1, sizeof(node_store_t));
+        if (store == NULL)
+        {
+            free(t);
+            return NULL;
+        }
+        SET_COLOR(&store->nil, RBTREE_BLACK);
+        SET_PARENT(&store->nil, &store->nil);
+        store->nil.left = &store->nil;
+        store->nil.right = &store->nil;
+    }
+    __atomic_add_fetch(&store->refs, 1, __ATOMIC_RELAXED);
+    t->pool.store = store;
+    t->nil = &store->nil;
 
     // root에 nil 정의
-    t->root = NIL;
+    t->root = t->nil;
     return t;
 }
 
-// rbtree 원소를 재귀로 제거
-static void _delete_rbtree(node_t *root)
+rbtree *new_rbtree(void)
+{
+    return _new_tree(NULL);
+}
+
+// 저장소를 놓고, 마지막 tree 였으면 slab 과 함께 해제
+static void _release_store(node_store_t *store)
+{
+    if (__atomic_sub_fetch(&store->refs, 1, __ATOMIC_ACQ_REL) != 0)
+    {
+        return;
+    }
+    // node 를 하나씩 찾아다닐 필요 없이 slab 단위로 반환
+    node_slab_t *slab = store->slabs;
+    while (slab != NULL)
+    {
+        node_slab_t *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    free(store);
+}
+
+#ifdef RBTREE_NO_POOL
+// rbtree 원소를 후위 순서로 제거 (재귀 없이 parent 포인터로 올라감)
+static void _delete_rbtree(rbtree *t)
 {
-    if (root->left != NIL)
-        _delete_rbtree(root->left);
-    if (root->right != NIL)
-        _delete_rbtree(root->right);
-    if (root != NIL)
-        free(root);
+    node_t *cur = t->root;
+    while (cur != t->nil)
+    {
+        if (cur->left != t->nil)
+        {
+            cur = cur->left;
+            continue;
+        }
+        if (cur->right != t->nil)
+        {
+            cur = cur->right;
+            continue;
+        }
+        // 자식이 없는 node 를 지우고 부모에서 끊은 뒤 부모로 올라감
+        node_t *parent = PARENT(cur);
+        if (parent != t->nil)
+        {
+            if (parent->left == cur)
+                parent->left = t->nil;
+            else
+                parent->right = t->nil;
+        }
+        free(cur);
+        cur = parent;
+    }
 }
+#endif
 
 void delete_rbtree(rbtree *t)
 {
-    _delete_rbtree(t->root);
-    // free(NIL);
+#ifdef RBTREE_NO_POOL
+    _delete_rbtree(t);
+#endif
+    _release_store(t->pool.store);
     free(t);
 }
 
@@ -54,13 +238,13 @@ typedef enum
     RIGHT
 } direction_t;
 
-static void _setChild(node_t *parent, node_t *child, direction_t isRight)
+static void _setChild(node_t *parent, node_t *child, direction_t isRight, const rbtree *t)
 {
-    if (child != NIL)
+    if (child != t->nil)
     {
-        child->parent = parent;
+        SET_PARENT(child, parent);
     }
-    if (parent == NIL)
+    if (parent == t->nil)
         return;
     if (isRight)
     {
@@ -91,119 +275,283 @@ static node_t *_getChild(node_t *parent, direction_t isRight)
 */
 static void _rotate(node_t *parent, direction_t isRight, rbtree * t)
 {
-    node_t *grandParent = parent->parent;
+    node_t *grandParent = PARENT(parent);
     node_t *newParent = _getChild(parent, !isRight);
     node_t *beta = _getChild(newParent, isRight);
 
     // 색 교환
-    color_t parentColor = parent->color;
-    parent->color = newParent->color;
-    newParent->color = parentColor;
+    color_t parentColor = COLOR(parent);
+    SET_COLOR(parent, COLOR(newParent));
+    SET_COLOR(newParent, parentColor);
 
     // 내부 회전
-    _setChild(parent, beta, !isRight);
-    _setChild(newParent, parent, isRight);
+    _setChild(parent, beta, !isRight, t);
+    _setChild(newParent, parent, isRight, t);
 
     // 조부모와 새 부모를 연결
     // !조부모가 NIL이면 루트니 t->root로 변경
-    _setChild(grandParent, newParent, (grandParent->right == parent));
-    if(newParent->parent == NIL){
+    _setChild(grandParent, newParent, (grandParent->right == parent), t);
+    if(PARENT(newParent) == t->nil){
         t->root = newParent;
     }
+
+#ifdef RBTREE_ORDER_STAT
+    // 새 부모가 원래 부모의 subtree 를 그대로 물려받음
+    newParent->size = parent->size;
+    parent->size = parent->left->size + parent->right->size + 1;
+#endif
 }
 
-node_t *rbtree_insert(rbtree *t, const key_t key)
+// 새 노드를 만들고 초기화 (red, NIL), 할당하지 못하면 NULL
+static node_t *_new_node(const key_t key, rbtree *t)
 {
-    // 새 노드를 만들고 초기화 (red, NIL)
-    node_t *newNode = malloc(sizeof(node_t));
-    newNode->key = key;
-    newNode->color = RBTREE_RED;
-    newNode->left = NIL;
-    newNode->right = NIL;
-    newNode->parent = NIL;
-
-    // root가 NIL이면 새 노드를 루트로 입력하고 종료
-    if (t->root == NIL)
-    {
-        newNode->color = RBTREE_BLACK;
-        t->root = newNode;
-        return t->root;
-    }
-
-    // BST처럼 새 노드가 삽입 될 위치를 찾음
-    node_t *parent = NIL, *cur = t->root;
-    while (cur != NIL)
+    node_t *newNode = _alloc_node(t);
+    if (newNode == NULL)
     {
-        parent = cur;
-        cur = newNode->key < cur->key ? cur->left : cur->right;
+        return NULL;
     }
-    _setChild(parent, newNode, (parent->key <= newNode->key));
+    newNode->key = key;
+    SET_COLOR(newNode, RBTREE_RED);
+    newNode->left = t->nil;
+    newNode->right = t->nil;
+    SET_PARENT(newNode, t->nil);
+#ifdef RBTREE_ORDER_STAT
+    newNode->size = 1;
+#endif
+    t->size++;
+    return newNode;
+}
 
-    cur = newNode;
-    node_t *uncle;
+/*
+red 인 cur 와 그 부모가 둘 다 red 이면 (이중 red) 위로 올라가며 고침
+cur 의 자식은 black 이어야 한다. 멈춘 자리의 node 를 돌려주며,
+그 node 가 루트 (부모가 NIL) 면 red 일 수 있으므로 부르는 쪽에서 black 으로 칠한다.
+*/
+static node_t *_fix_double_red(node_t *cur, rbtree *t)
+{
+    node_t *parent, *uncle;
     direction_t parentDirection, curDirection;
     // 부모가 레드여서 이중 레드일 동안 반복해서 수정
-    while (cur->parent->color == RBTREE_RED)
+    while (COLOR(PARENT(cur)) == RBTREE_RED)
     {
-        parent = cur->parent;
-        parentDirection = (parent->parent->right == parent);
-        uncle = _getChild(parent->parent, !parentDirection);
+        STAT(t, insert_fixups);
+        parent = PARENT(cur);
+        parentDirection = (PARENT(parent)->right == parent);
+        uncle = _getChild(PARENT(parent), !parentDirection);
 
         // CASE 1 : uncle이 red일 경우 -> grand parent ->red; parent & uncle -> black;
-        if (uncle->color == RBTREE_RED)
+        if (COLOR(uncle) == RBTREE_RED)
         {
-            parent->color = RBTREE_BLACK;
-            uncle->color = RBTREE_BLACK;
-            parent->parent->color = RBTREE_RED;
-            cur = parent->parent;
+            SET_COLOR(parent, RBTREE_BLACK);
+            SET_COLOR(uncle, RBTREE_BLACK);
+            SET_COLOR(PARENT(parent), RBTREE_RED);
+            cur = PARENT(parent);
             continue;
         }
 
         curDirection = (parent->right == cur);
-        node_t *grandParent = parent->parent;
+        node_t *grandParent = PARENT(parent);
 
         // CASE 2 : parent direction 과 cur direction이 다른 경우 -> 다이아몬드 모양 -> 쭉 펴줌
         if (curDirection != parentDirection)
         {
             _rotate(parent, !curDirection, t);
+            STAT(t, insert_rotations);
         }
 
         // CASE 3 : parent direction 과 cur direction이 같을 경우 -> 한칸 내리고 색칠
         _rotate(grandParent, !parentDirection, t);
+        STAT(t, insert_rotations);
         // grandParent->color = RBTREE_RED;
         // grandParent->parent->color = RBTREE_BLACK;
-        cur = grandParent->parent;
+        cur = PARENT(grandParent);
         break;
     }
 
+    return cur;
+}
+
+/*
+cur 를 루트로 하는 subtree 안에서 newNode 가 들어갈 자리를 찾아 붙이고 균형을 맞춤
+cur 는 t->root 이거나 newNode->key 가 그 subtree 의 key 범위 안에 드는 node 여야 한다.
+(cur 위쪽 조상의 size 는 부르는 쪽에서 올려 둔다)
+*/
+static void _insert_below(node_t *cur, node_t *newNode, rbtree *t)
+{
+    // BST처럼 새 노드가 삽입 될 위치를 찾음
+    node_t *parent = t->nil;
+    while (cur != t->nil)
+    {
+        parent = cur;
+#ifdef RBTREE_ORDER_STAT
+        cur->size++;
+#endif
+        cur = newNode->key < cur->key ? cur->left : cur->right;
+    }
+    _setChild(parent, newNode, (parent->key <= newNode->key), t);
+
+    cur = _fix_double_red(newNode, t);
     // cur 가 root가 됐으면 부모가 NIL일 것이므로 루트 변경
-    if (cur->parent == NIL)
+    if (PARENT(cur) == t->nil)
     {
         t->root = cur;
-        cur->color = RBTREE_BLACK;
+        SET_COLOR(cur, RBTREE_BLACK);
+    }
+}
+
+node_t *rbtree_insert(rbtree *t, const key_t key)
+{
+    TRACE(RBTREE_TRACE_INSERT, key);
+    STAT(t, inserts);
+    node_t *newNode = _new_node(key, t);
+    if (newNode == NULL)
+    {
+        return NULL;
     }
 
+    // root가 NIL이면 새 노드를 루트로 입력하고 종료
+    if (t->root == t->nil)
+    {
+        SET_COLOR(newNode, RBTREE_BLACK);
+        t->root = newNode;
+        return t->root;
+    }
+
+    _insert_below(t->root, newNode, t);
     return newNode;
 }
 
 node_t *rbtree_find(const rbtree *t, const key_t key)
 {
+    TRACE(RBTREE_TRACE_FIND, key);
+    STAT_SHARED(t, searches, 1);
     node_t *cur = t->root;
-    while (cur != NIL)
+    uint64_t compared = 0;
+    while (cur != t->nil)
     {
+        compared++;
         if (cur->key == key)
         {
-            return cur;
+            break;
         }
         cur = key < cur->key ? cur->left : cur->right;
     }
-    return NULL;
+    STAT_SHARED(t, comparisons, compared);
+    return cur == t->nil ? NULL : cur;
+}
+
+/*
+batch find
+한 번에 BATCH_FIND_GROUP 개의 key 를 번갈아 한 단계씩 내려가며, 다음에 갈 자식을 미리 prefetch 한다.
+하나의 find 는 매 단계가 앞 단계의 load 를 기다리는 pointer chase 이지만,
+서로 다른 key 의 내려가기는 독립이라 한 key 의 cache miss 를 기다리는 동안 나머지가 진행된다.
+끝난 자리에는 바로 다음 key 를 채워 group 이 항상 차 있게 한다.
+*/
+#define BATCH_FIND_GROUP 32
+
+size_t rbtree_find_batch(const rbtree *t, const key_t *keys, const size_t n, node_t **out)
+{
+    node_t *cur[BATCH_FIND_GROUP];
+    size_t slot[BATCH_FIND_GROUP];  // cur[g] 가 찾고 있는 keys 의 index
+    size_t next = 0, active = 0, found = 0;
+    uint64_t compared = 0;
+
+    // trace 와 counter 는 key 순서대로 rbtree_find 를 부른 것과 같게 남김
+    for (size_t i = 0; i < n; i++)
+    {
+        TRACE(RBTREE_TRACE_FIND, keys[i]);
+    }
+    STAT_SHARED(t, searches, n);
+    for (; active < BATCH_FIND_GROUP && next < n; active++, next++)
+    {
+        cur[active] = t->root;
+        slot[active] = next;
+    }
+    while (active > 0)
+    {
+        for (size_t g = 0; g < active;)
+        {
+            node_t *node = cur[g];
+            const key_t key = keys[slot[g]];
+            compared += node != t->nil;
+            if (node != t->nil && node->key != key)
+            {
+                node = key < node->key ? node->left : node->right;
+                __builtin_prefetch(node);
+                cur[g++] = node;
+                continue;
+            }
+            // 찾았거나 (node) 없음 (nil) : 결과를 쓰고 빈 자리를 다음 key 로 채움
+            out[slot[g]] = node == t->nil ? NULL : node;
+            found += node != t->nil;
+            if (next < n)
+            {
+                cur[g] = t->root;
+                slot[g] = next++;
+            }
+            else
+            {
+                // 남은 key 가 없으면 마지막 자리를 당겨 와 group 을 줄임
+                active--;
+                cur[g] = cur[active];
+                slot[g] = slot[active];
+            }
+        }
+    }
+    STAT_SHARED(t, comparisons, compared);
+    return found;
+}
+
+// key 이상인 첫 node, 없으면 NULL (중복 key 중 가장 왼쪽)
+node_t *rbtree_lower_bound(const rbtree *t, const key_t key)
+{
+    STAT_SHARED(t, searches, 1);
+    node_t *cur = t->root, *found = NULL;
+    uint64_t compared = 0;
+    while (cur != t->nil)
+    {
+        compared++;
+        if (cur->key >= key)
+        {
+            found = cur;
+            cur = cur->left;
+        }
+        else
+        {
+            cur = cur->right;
+        }
+    }
+    STAT_SHARED(t, comparisons, compared);
+    return found;
+}
+
+// key 보다 큰 첫 node, 없으면 NULL
+node_t *rbtree_upper_bound(const rbtree *t, const key_t key)
+{
+    STAT_SHARED(t, searches, 1);
+    node_t *cur = t->root, *found = NULL;
+    uint64_t compared = 0;
+    while (cur != t->nil)
+    {
+        compared++;
+        if (cur->key > key)
+        {
+            found = cur;
+            cur = cur->left;
+        }
+        else
+        {
+            cur = cur->right;
+        }
+    }
+    STAT_SHARED(t, comparisons, compared);
+    return found;
 }
 
-static node_t *_rbtree_min(const node_t *root)
+static node_t *_rbtree_min(const node_t *root, const rbtree *t)
 {
-    node_t *cur = root;
-    while (cur->left != NIL)
+    node_t *cur = (node_t *)root;
+    while (cur->left != t->nil)
     {
         cur = cur->left;
     }
@@ -212,13 +560,17 @@ static node_t *_rbtree_min(const node_t *root)
 
 node_t *rbtree_min(const rbtree *t)
 {
-    return _rbtree_min(t->root);
+    if (t->root == t->nil)
+    {
+        return NULL;
+    }
+    return _rbtree_min(t->root, t);
 }
 
-static node_t *_rbtree_max(const node_t *root)
+static node_t *_rbtree_max(const node_t *root, const rbtree *t)
 {
-    node_t *cur = root;
-    while (cur->right != NIL)
+    node_t *cur = (node_t *)root;
+    while (cur->right != t->nil)
     {
         cur = cur->right;
     }
@@ -227,57 +579,77 @@ static node_t *_rbtree_max(const node_t *root)
 
 node_t *rbtree_max(const rbtree *t)
 {
-    if (t->root == NIL)
+    if (t->root == t->nil)
     {
         return NULL;
     }
-    return _rbtree_max(t->root);
+    return _rbtree_max(t->root, t);
 }
 
 // *u 위치를 *v로 대체
-static void _transplant(node_t *u, node_t *v)
+static void _transplant(node_t *u, node_t *v, const rbtree *t)
 {
-    _setChild(u->parent, v, (u->parent->right == u));
-    _setChild(v, u->left, LEFT);
-    _setChild(v, u->right, RIGHT);
+    _setChild(PARENT(u), v, (PARENT(u)->right == u), t);
+    _setChild(v, u->left, LEFT, t);
+    _setChild(v, u->right, RIGHT, t);
 }
 
+#ifdef RBTREE_ORDER_STAT
+// 실제로 빠지는 자리의 조상들 subtree 크기를 하나씩 줄임
+static void _shrink_ancestors(node_t *cur, const rbtree *t)
+{
+    for (node_t *x = PARENT(cur); x != t->nil; x = PARENT(x))
+    {
+        x->size--;
+    }
+}
+#endif
+
 int rbtree_erase(rbtree *t, node_t *p)
 {
-    if(p == t->root && p->left == NIL && p->right == NIL){
-        t->root = NIL;
-        free(p);
+    TRACE(RBTREE_TRACE_ERASE, p->key);
+    STAT(t, erases);
+    t->size--;
+    if(p == t->root && p->left == t->nil && p->right == t->nil){
+        t->root = t->nil;
+        _free_node(t, p);
         return 0;
     }
     /* step 1 : BST 삭제 매 구현
         색을 유지해줘야할 replaceColor 찾아서 저장
     */
-    color_t replaceColor = p->color;
+    color_t replaceColor = COLOR(p);
     node_t * replacer, *cur, *parent;
-    if (p->left != NIL && p->right != NIL)
+    if (p->left != t->nil && p->right != t->nil)
     {
-        replacer = _rbtree_min(p->right);
+        replacer = _rbtree_min(p->right, t);
+#ifdef RBTREE_ORDER_STAT
+        _shrink_ancestors(replacer, t);
+        replacer->size = p->size;
+#endif
+        cur = replacer->right;
+        // cur 가 NIL 이어도 fixup 에서 쓸 수 있도록 부모를 미리 기억
         if(replacer != p->right){
-            _setChild(replacer->parent, replacer->right, LEFT);
+            parent = PARENT(replacer);
+            _setChild(PARENT(replacer), replacer->right, LEFT, t);
         }
         else {
-            _setChild(p,replacer->right,RIGHT);
+            parent = replacer;
+            _setChild(p,replacer->right,RIGHT, t);
         }
-        cur = replacer ->right;
-        parent = cur == NIL ? replacer : cur->parent;
-        replaceColor = replacer->color;
-        replacer->color = p->color;
-        _transplant(p, replacer);
+        replaceColor = COLOR(replacer);
+        SET_COLOR(replacer, COLOR(p));
+        _transplant(p, replacer, t);
     }
     else
     {
-        replacer = _getChild(p, (p->right != NIL));
+        replacer = _getChild(p, (p->right != t->nil));
+#ifdef RBTREE_ORDER_STAT
+        _shrink_ancestors(p, t);
+#endif
         cur = replacer;
-        parent = cur->parent;
-        if(p->left == NIL && p->right == NIL) {
-            parent = p->parent;
-        }
-        _setChild(p->parent, replacer, (p->parent->right == p));
+        parent = PARENT(p);
+        _setChild(PARENT(p), replacer, (PARENT(p)->right == p), t);
     }
     if(p == t->root){
         t->root = replacer;
@@ -285,70 +657,1232 @@ int rbtree_erase(rbtree *t, node_t *p)
     // STEP 2 : 없어진 색이 black이면 FIX가 필요
     if(replaceColor == RBTREE_BLACK){
         // CASE double-black :
-        while(cur->color == RBTREE_BLACK && t->root != cur){
+        while(COLOR(cur) == RBTREE_BLACK && t->root != cur){
+            STAT(t, erase_fixups);
             direction_t curDirection = (parent->right == cur);
             node_t *brother = _getChild(parent,!curDirection);
             // CASE 1 : 형제가 빨강 (부모는 검정)
             //  조치  이후 CASE 2, 3, 4 중 하나로 변환 됨
-            if(brother->color == RBTREE_RED){
+            if(COLOR(brother) == RBTREE_RED){
+                STAT(t, erase_cases[0]);
+                STAT(t, erase_rotations);
                 _rotate(parent, curDirection, t);
                 brother = _getChild(parent,!curDirection);
-                _nil.color = RBTREE_BLACK;
             }
 
             // NOTE : 이후부터는 형제가 검정
             // CASE 2 : 형제의 두 자식이 모두 검정
-            if(brother->left->color == RBTREE_BLACK && brother->right->color == RBTREE_BLACK){
-                brother->color = RBTREE_RED;
+            if(COLOR(brother->left) == RBTREE_BLACK && COLOR(brother->right) == RBTREE_BLACK){
+                STAT(t, erase_cases[1]);
+                SET_COLOR(brother, RBTREE_RED);
                 cur = parent;
-                parent = cur->parent;
-                _nil.color = RBTREE_BLACK;
+                parent = PARENT(cur);
                 continue;
             }
 
             // CASE 3 : 형재의 내 쪽 자식이 빨강, 반대 쪽 자식은 검정
-            else if(_getChild(brother, curDirection)->color == RBTREE_RED, _getChild(brother, !curDirection) == RBTREE_BLACK){
+            else if(COLOR(_getChild(brother, !curDirection)) == RBTREE_BLACK){
+                STAT(t, erase_cases[2]);
+                STAT(t, erase_rotations);
                 _rotate(brother, !curDirection, t);
-                brother = brother->parent;
-                _nil.color = RBTREE_BLACK;
+                brother = PARENT(brother);
                 // NOTE : CASE 4로 바뀜
             }
 
             // CASE 4 : 형제의 반대 자식이 빨강
-            if(_getChild(brother,!curDirection)->color == RBTREE_RED){
+            if(COLOR(_getChild(brother,!curDirection)) == RBTREE_RED){
+                STAT(t, erase_cases[3]);
+                STAT(t, erase_rotations);
 
-                _getChild(brother,!curDirection)->color = RBTREE_BLACK;
+                SET_COLOR(_getChild(brother,!curDirection), RBTREE_BLACK);
                 _rotate(parent, curDirection, t);
-                _nil.color = RBTREE_BLACK;
                 break;
             }
         }
 
         // CASE red-black : 교체한 내가 RED이면 검정으로 칠하고 종료
-        if(cur->color == RBTREE_RED){
-            cur->color = RBTREE_BLACK;
+        if(COLOR(cur) == RBTREE_RED){
+            SET_COLOR(cur, RBTREE_BLACK);
         }
-        t->root->color = RBTREE_BLACK;
+        SET_COLOR(t->root, RBTREE_BLACK);
     }
 
-    free(p);
+    _free_node(t, p);
     return 0;
 }
 
-int rbtree_inorder(key_t *arr, node_t * cur, int index, const size_t n){
-    if(cur == NIL || index >= n){
-        return index;
+// 중위 순회 다음 node : 오른쪽 subtree 의 최소값, 없으면 왼쪽 자식으로 올라온 첫 조상
+static node_t *_next_node(const node_t *cur, const rbtree *t)
+{
+    if (cur->right != t->nil)
+    {
+        return _rbtree_min(cur->right, t);
+    }
+    node_t *parent = PARENT(cur);
+    while (parent != t->nil && cur == parent->right)
+    {
+        cur = parent;
+        parent = PARENT(parent);
+    }
+    return parent;
+}
+
+// _next_node 의 대칭 : 왼쪽 subtree 의 최대값, 없으면 오른쪽 자식으로 올라온 첫 조상
+static node_t *_prev_node(const node_t *cur, const rbtree *t)
+{
+    if (cur->left != t->nil)
+    {
+        return _rbtree_max(cur->left, t);
+    }
+    node_t *parent = PARENT(cur);
+    while (parent != t->nil && cur == parent->left)
+    {
+        cur = parent;
+        parent = PARENT(parent);
+    }
+    return parent;
+}
+
+/*
+p 의 중위 순회 다음 / 이전 node, 없으면 NULL
+한 번 이동은 최악 O(log n) 이지만 처음부터 끝까지 훑으면 간선을 두 번씩만 지나므로 전체 O(n)
+*/
+node_t *rbtree_next(const rbtree *t, node_t *p)
+{
+    node_t *next = _next_node(p, t);
+    return next == t->nil ? NULL : next;
+}
+
+node_t *rbtree_prev(const rbtree *t, node_t *p)
+{
+    node_t *prev = _prev_node(p, t);
+    return prev == t->nil ? NULL : prev;
+}
+
+rbtree_cursor rbtree_cursor_first(const rbtree *t)
+{
+    rbtree_cursor c = {.tree = t, .node = rbtree_min(t)};
+    return c;
+}
+
+rbtree_cursor rbtree_cursor_last(const rbtree *t)
+{
+    rbtree_cursor c = {.tree = t, .node = rbtree_max(t)};
+    return c;
+}
+
+// 끝(NULL) 에서 next 는 그대로 끝에 머문다
+node_t *rbtree_cursor_next(rbtree_cursor *c)
+{
+    if (c->node != NULL)
+    {
+        c->node = rbtree_next(c->tree, c->node);
+    }
+    return c->node;
+}
+
+// 끝(NULL) 에서 prev 는 최대값으로 돌아온다
+node_t *rbtree_cursor_prev(rbtree_cursor *c)
+{
+    c->node = c->node == NULL ? rbtree_max(c->tree) : rbtree_prev(c->tree, c->node);
+    return c->node;
+}
+
+/*
+chunk 단위 내보내기
+rbtree_to_array 는 tree 크기만 한 배열이 필요하므로, 커서 위치부터 cap 개씩 끊어 읽는다.
+커서는 다음에 읽을 node 를 가리키므로 몇 번에 나눠 읽어도 이어진다. (그 사이 tree 를 고치면 안 됨)
+rbtree_export 는 같은 buf 를 다시 채워 가며 chunk 마다 fn 을 부르므로 메모리는 buf 하나로 끝난다.
+*/
+size_t rbtree_cursor_read(rbtree_cursor *c, key_t *out, const size_t cap)
+{
+    const rbtree *t = c->tree;
+    node_t *cur = c->node == NULL ? t->nil : c->node;
+    size_t count = 0;
+    while (cur != t->nil && count < cap)
+    {
+        out[count++] = cur->key;
+        cur = _next_node(cur, t);
+    }
+    c->node = cur == t->nil ? NULL : cur;
+    return count;
+}
+
+int rbtree_export(const rbtree *t, key_t *buf, const size_t cap, rbtree_export_fn fn, void *arg)
+{
+    rbtree_cursor c = rbtree_cursor_first(t);
+    size_t count;
+    while ((count = rbtree_cursor_read(&c, buf, cap)) > 0)
+    {
+        const int res = fn(buf, count, arg);
+        if (res != 0)
+        {
+            return res;
+        }
     }
-    index = rbtree_inorder(arr,cur->left,index, n);
-    arr[index] = cur->key;
-    return rbtree_inorder(arr,cur->right,index+1, n);
+    return 0;
 }
 
 int rbtree_to_array(const rbtree *t, key_t *arr, const size_t n)
 {
-    int index = rbtree_inorder(arr, t->root, 0, n);
+    size_t index = 0;
+    if (t->root == t->nil || n == 0)
+    {
+        return index != n;
+    }
+    // n 개를 채우는 순간 멈춤
+    node_t *cur = _rbtree_min(t->root, t);
+    while (cur != t->nil && index < n)
+    {
+        arr[index++] = cur->key;
+        if (index < n)
+        {
+            cur = _next_node(cur, t);
+        }
+    }
     if(index != n){
         return 1;
     }
     return 0;
 }
+
+/*
+정렬된 arr[lo, hi) 로 subtree 를 만든다
+가운데 원소를 루트로 잡으면 모든 NIL 의 깊이가 redDepth 또는 redDepth + 1 이 되므로
+깊이가 redDepth 인 (마지막 줄이 덜 찬) node 만 red 로 칠하면 black height 가 모두 같아진다.
+block 이 있으면 arr 와 같은 index 의 node 를 쓰고, 없으면 하나씩 할당한다.
+할당하지 못하면 이 호출에서 할당한 node 를 모두 반납하고 NULL 을 돌려준다.
+*/
+static size_t _free_subtree(node_t *cur, rbtree *t);
+
+static node_t *_build_sorted(rbtree *t, node_t *block, const key_t *arr, size_t lo, size_t hi,
+                             int depth, int redDepth, node_t *parent)
+{
+    if (lo >= hi)
+    {
+        return t->nil;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    node_t *node = block != NULL ? &block[mid] : _alloc_node(t);
+    if (node == NULL)
+    {
+        return NULL;
+    }
+    node->key = arr[mid];
+    SET_COLOR(node, depth == redDepth ? RBTREE_RED : RBTREE_BLACK);
+    SET_PARENT(node, parent);
+#ifdef RBTREE_ORDER_STAT
+    node->size = hi - lo;
+#endif
+    node->left = _build_sorted(t, block, arr, lo, mid, depth + 1, redDepth, node);
+    node->right = node->left == NULL ? NULL : _build_sorted(t, block, arr, mid + 1, hi, depth + 1, redDepth, node);
+    if (node->right == NULL)
+    {
+        if (node->left != NULL)
+        {
+            _free_subtree(node->left, t);
+        }
+        _free_node(t, node);
+        return NULL;
+    }
+    return node;
+}
+
+// 균형 잡힌 n 개짜리 tree 에서 red 로 칠할 깊이 = floor(log2(n + 1))
+static int _red_depth(const size_t n)
+{
+    int redDepth = 0;
+    while (((size_t)2 << redDepth) - 1 <= n)
+    {
+        redDepth++;
+    }
+    return redDepth;
+}
+
+rbtree *rbtree_from_sorted_array(const key_t *arr, const size_t n)
+{
+    rbtree *t = new_rbtree();
+    if (t == NULL || n == 0)
+    {
+        return t;
+    }
+
+    int redDepth = _red_depth(n);
+
+    node_t *block = NULL;
+#ifndef RBTREE_NO_POOL
+    // n 개를 한 slab 에 in-order 순서로 연속 배치
+    if (!_pool_grow(&t->pool, n))
+    {
+        delete_rbtree(t);
+        return NULL;
+    }
+    t->pool.used = n;
+    block = t->pool.slab->nodes;
+#endif
+    t->root = _build_sorted(t, block, arr, 0, n, 0, redDepth, t->nil);
+    if (t->root == NULL)
+    {
+        t->root = t->nil;
+        delete_rbtree(t);
+        return NULL;
+    }
+    t->size = n;
+    return t;
+}
+
+/*
+freeze
+노드를 van Emde Boas 순서로 새 slab 하나에 옮긴다. 높이 h 인 subtree 를 위쪽 h/2 단과
+그 아래 subtree 들로 나눠 위쪽을 먼저, 이어서 아래 subtree 를 하나씩 같은 방식으로 놓는다.
+어느 크기의 cache line / page 에 대해서도 루트부터의 경로가 O(log_B n) 개 블록만 지나게 된다.
+insert 순서대로 흩어진 node 는 find 한 번에 거의 단마다 다른 cache line 과 page 를 건드린다.
+옮긴 뒤에도 보통 tree 이므로 그대로 고칠 수 있다. (새 node 는 다시 새 slab 에서 잘라 씀)
+*/
+
+#ifndef RBTREE_NO_POOL
+// root 에서 깊이 h 미만인 node 들을 vEB 순서로 order 에 씀
+static void _veb_layout(node_t *root, const int h, node_t **order, size_t *count, const rbtree *t);
+
+// node 에서 depth 단 아래의 subtree 들을 왼쪽부터 높이 h 로 놓음
+static void _veb_bottoms(node_t *node, const int depth, const int h, node_t **order, size_t *count,
+                         const rbtree *t)
+{
+    if (node == t->nil)
+    {
+        return;
+    }
+    if (depth == 0)
+    {
+        _veb_layout(node, h, order, count, t);
+        return;
+    }
+    _veb_bottoms(node->left, depth - 1, h, order, count, t);
+    _veb_bottoms(node->right, depth - 1, h, order, count, t);
+}
+
+static void _veb_layout(node_t *root, const int h, node_t **order, size_t *count, const rbtree *t)
+{
+    if (root == t->nil)
+    {
+        return;
+    }
+    if (h == 1)
+    {
+        order[(*count)++] = root;
+        return;
+    }
+    const int top = h / 2;
+    _veb_layout(root, top, order, count, t);
+    _veb_bottoms(root, top, h - top, order, count, t);
+}
+
+static int _height(const node_t *node, const rbtree *t)
+{
+    if (node == t->nil)
+    {
+        return 0;
+    }
+    const int left = _height(node->left, t), right = _height(node->right, t);
+    return 1 + (left > right ? left : right);
+}
+#endif
+
+int rbtree_freeze(rbtree *t)
+{
+#ifdef RBTREE_NO_POOL
+    // node 마다 따로 free 하므로 한 블록으로 모을 수 없음
+    (void)t;
+    return -1;
+#else
+    const size_t n = t->size;
+    if (n == 0)
+    {
+        return 0;
+    }
+    node_t **order = malloc(n * sizeof(node_t *));
+    node_slab_t *slab = _new_slab(n);
+    if (order == NULL || slab == NULL)
+    {
+        free(order);
+        free(slab);
+        return -1;
+    }
+    size_t count = 0;
+    _veb_layout(t->root, _height(t->root, t), order, &count, t);
+
+    // 모두 복사한 뒤 옛 node 의 left 에 새 위치를 적어 두고, 새 node 의 link 를 그걸로 바꿈
+    node_t *nodes = slab->nodes;
+    for (size_t i = 0; i < n; i++)
+    {
+        nodes[i] = *order[i];
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        order[i]->left = &nodes[i];
+    }
+    node_t *nil = t->nil;
+    for (size_t i = 0; i < n; i++)
+    {
+        node_t *p = &nodes[i];
+        if (p->left != nil)
+        {
+            p->left = p->left->left;
+        }
+        if (p->right != nil)
+        {
+            p->right = p->right->left;
+        }
+        if (PARENT(p) != nil)
+        {
+            SET_PARENT(p, PARENT(p)->left);
+        }
+    }
+    t->root = t->root->left;
+
+    node_store_t *store = t->pool.store;
+    if (__atomic_load_n(&store->refs, __ATOMIC_ACQUIRE) == 1)
+    {
+        // 혼자 쓰는 저장소 : 옛 slab 을 모두 놓고 새 slab 하나만 남김
+        node_slab_t *old = store->slabs;
+        while (old != NULL)
+        {
+            node_slab_t *next = old->next;
+            free(old);
+            old = next;
+        }
+        slab->next = NULL;
+        store->slabs = slab;
+        t->pool.free_list = NULL;
+    }
+    else
+    {
+        // split 으로 갈라진 다른 tree 가 같은 slab 에 node 를 두고 있음 : 옛 node 는 반납해 두고 재사용
+        _push_slab(store, slab);
+        for (size_t i = 0; i < n; i++)
+        {
+            _free_node(t, order[i]);
+        }
+    }
+    free(order);
+    t->pool.slab = slab;
+    t->pool.used = n;
+    return 0;
+#endif
+}
+
+/*
+batch insert
+배치를 정렬한 뒤, 배치가 tree 에 비해 작으면 직전에 넣은 node 에서 출발해 (finger)
+다음 key 가 들어갈 subtree 까지만 올라갔다가 내려간다. 정렬된 key 는 서로 가까운 자리에 들어가므로
+루트부터 다시 내려가지 않고 방금 지나간 (cache 에 남은) 경로를 재사용한다.
+배치가 tree 크기의 BATCH_REBUILD_RATIO 배 이상이면 (빈 tree 포함) 기존 node 와 새 node 를 순서대로 합쳐
+_build_sorted 와 같은 모양으로 다시 엮는다. 기존 node 는 그대로 재사용하므로 node_t * 는 계속 유효하다.
+재구성은 기존 node 를 전부 한 번씩 (무작위 주소로) 건드리므로, 배치가 tree 만 할 때까지도 finger 쪽이 빠르다.
+(bench-insert-batch, 1M tree 에 1M 배치 : finger 210 ns/key, 재구성 340 ns/key)
+*/
+#define BATCH_REBUILD_RATIO 2
+
+// 부호 비트를 뒤집어 부호 없는 순서로 만든 뒤 8 bit 씩 LSD radix sort (결과는 arr, tmp 는 같은 크기)
+static void _sort_keys(key_t *arr, key_t *tmp, const size_t n)
+{
+    uint32_t *src = (uint32_t *)arr, *dst = (uint32_t *)tmp;
+    for (size_t i = 0; i < n; i++)
+    {
+        src[i] ^= 0x80000000u;
+    }
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        size_t count[257] = {0};
+        for (size_t i = 0; i < n; i++)
+        {
+            count[((src[i] >> shift) & 0xff) + 1]++;
+        }
+        // 모든 key 의 이 byte 가 같으면 건너뜀 (좁은 범위의 key)
+        if (count[((src[0] >> shift) & 0xff) + 1] == n)
+        {
+            continue;
+        }
+        for (int b = 0; b < 256; b++)
+        {
+            count[b + 1] += count[b];
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            dst[count[(src[i] >> shift) & 0xff]++] = src[i];
+        }
+        uint32_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != (uint32_t *)arr)
+    {
+        memcpy(arr, src, n * sizeof(key_t));
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        arr[i] ^= (key_t)0x80000000u;
+    }
+}
+
+// 정렬된 key 를 하나씩 : 직전 node 에서 key 가 들어갈 subtree 의 루트까지 올라간 뒤 내려감
+// node 를 할당하지 못하면 거기서 멈추고 false (앞쪽 key 만 들어감)
+static bool _insert_sorted(rbtree *t, const key_t *keys, const size_t n)
+{
+    node_t *last = t->nil;
+    for (size_t i = 0; i < n; i++)
+    {
+        node_t *newNode = _new_node(keys[i], t);
+        if (newNode == NULL)
+        {
+            return false;
+        }
+        node_t *cur = t->root;
+        if (last != t->nil)
+        {
+            /*
+            key >= last->key 이므로 아래 한계는 항상 만족한다.
+            cur 가 왼쪽 자식이면 부모의 key 가 cur subtree 의 위 한계이고,
+            오른쪽 자식이면 부모의 한계를 물려받으므로 계속 올라간다.
+            */
+            cur = last;
+            while (PARENT(cur) != t->nil)
+            {
+                node_t *parent = PARENT(cur);
+                if (parent->left == cur && keys[i] < parent->key)
+                {
+                    break;
+                }
+                cur = parent;
+            }
+#ifdef RBTREE_ORDER_STAT
+            for (node_t *p = PARENT(cur); p != t->nil; p = PARENT(p))
+            {
+                p->size++;
+            }
+#endif
+        }
+        _insert_below(cur, newNode, t);
+        last = newNode;
+    }
+    return true;
+}
+
+// nodes[lo, hi) 를 _build_sorted 와 같은 모양 / 색으로 다시 엮음
+static node_t *_link_sorted(node_t **nodes, size_t lo, size_t hi, int depth, int redDepth,
+                            node_t *parent, const rbtree *t)
+{
+    if (lo >= hi)
+    {
+        return t->nil;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    node_t *node = nodes[mid];
+    SET_COLOR(node, depth == redDepth ? RBTREE_RED : RBTREE_BLACK);
+    SET_PARENT(node, parent);
+#ifdef RBTREE_ORDER_STAT
+    node->size = hi - lo;
+#endif
+    node->left = _link_sorted(nodes, lo, mid, depth + 1, redDepth, node, t);
+    node->right = _link_sorted(nodes, mid + 1, hi, depth + 1, redDepth, node, t);
+    return node;
+}
+
+// 기존 node 를 중위 순서로 훑으며 정렬된 key 의 새 node 와 합친 뒤 통째로 다시 엮음
+// 배열을 잡지 못하면 tree 는 그대로, node 를 할당하지 못하면 남은 key 를 버리고 엮은 뒤 false
+static bool _merge_rebuild(rbtree *t, const key_t *keys, const size_t n)
+{
+    size_t total = t->size + n;
+    node_t **nodes = malloc(total * sizeof(node_t *));
+    if (nodes == NULL)
+    {
+        return false;
+    }
+    bool ok = true;
+    node_t *cur = t->root == t->nil ? t->nil : _rbtree_min(t->root, t);
+    size_t i = 0, k = 0;
+    while (k < total)
+    {
+        // 같은 key 는 기존 node 뒤에 (rbtree_insert 와 같은 순서)
+        if (i < n && (cur == t->nil || keys[i] < cur->key))
+        {
+            node_t *newNode = _new_node(keys[i++], t);
+            if (newNode != NULL)
+            {
+                nodes[k++] = newNode;
+                continue;
+            }
+            // t->size 는 기존 node 와 지금까지 만든 node 수
+            ok = false;
+            i = n;
+            total = t->size;
+        }
+        else
+        {
+            nodes[k++] = cur;
+            cur = _next_node(cur, t);
+        }
+    }
+    t->root = _link_sorted(nodes, 0, total, 0, _red_depth(total), t->nil, t);
+    free(nodes);
+    return ok;
+}
+
+int rbtree_insert_batch(rbtree *t, const key_t *keys, const size_t n)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    // 정렬 buffer 를 잡지 못하면 tree 는 그대로
+    key_t *sorted = n <= SIZE_MAX / (2 * sizeof(key_t)) ? malloc(2 * n * sizeof(key_t)) : NULL;
+    if (sorted == NULL)
+    {
+        return -1;
+    }
+    memcpy(sorted, keys, n * sizeof(key_t));
+    _sort_keys(sorted, sorted + n, n);
+
+    const bool ok = n >= t->size * BATCH_REBUILD_RATIO ? _merge_rebuild(t, sorted, n) : _insert_sorted(t, sorted, n);
+    free(sorted);
+    return ok ? 0 : -1;
+}
+
+/*
+split / join
+tree 에서 떼어 낸 subtree (루트의 부모가 NIL) 를 black height (bh, NIL 까지 가는 경로의 black node 수,
+NIL 은 0) 와 함께 다룬다.
+join 은 bh 가 큰 쪽의 안쪽 spine 을 따라 bh 가 같아지는 black node 까지 내려가 pivot 을 red 로 끼우고
+insert 와 같은 fixup 을 한다. 비용은 두 bh 의 차이만큼.
+split 은 key 가 지나는 경로의 node 를 하나씩 pivot 으로 써서 양쪽에 join 하며,
+join 비용의 합이 망원급수가 되어 전체 O(log n) 이다.
+중간에 _rotate 가 t->root 를 떼어 낸 subtree 의 루트로 바꿔 놓으므로 끝나면 t->root 를 다시 정한다.
+*/
+typedef struct
+{
+    node_t *root;
+    int bh;
+} subtree_t;
+
+static int _black_height(const node_t *root, const rbtree *t)
+{
+    int bh = 0;
+    for (; root != t->nil; root = root->left)
+    {
+        bh += COLOR(root) == RBTREE_BLACK;
+    }
+    return bh;
+}
+
+// 루트가 red 면 black 으로 (bh 가 1 늘어남)
+static subtree_t _blacken(subtree_t s)
+{
+    if (COLOR(s.root) == RBTREE_RED)
+    {
+        SET_COLOR(s.root, RBTREE_BLACK);
+        s.bh++;
+    }
+    return s;
+}
+
+// node 의 isRight 쪽 자식을 떼어 낸 subtree 로 (node 의 bh 는 bh)
+static subtree_t _detach(node_t *node, direction_t isRight, int bh, const rbtree *t)
+{
+    subtree_t s = {_getChild(node, isRight), bh - (COLOR(node) == RBTREE_BLACK)};
+    if (s.root != t->nil)
+    {
+        SET_PARENT(s.root, t->nil);
+    }
+    return s;
+}
+
+// left 의 key <= pivot->key <= right 의 key 인 세 조각을 이어 붙임
+static subtree_t _join(subtree_t left, node_t *pivot, subtree_t right, rbtree *t)
+{
+    left = _blacken(left);
+    right = _blacken(right);
+    if (left.bh == right.bh)
+    {
+        SET_COLOR(pivot, RBTREE_BLACK);
+        SET_PARENT(pivot, t->nil);
+        _setChild(pivot, left.root, LEFT, t);
+        _setChild(pivot, right.root, RIGHT, t);
+#ifdef RBTREE_ORDER_STAT
+        pivot->size = left.root->size + right.root->size + 1;
+#endif
+        return (subtree_t){pivot, left.bh + 1};
+    }
+
+    // 높은 쪽 (isRight 면 right) 의 안쪽 spine 을 따라 bh 가 낮은 쪽과 같은 black node 까지 내려감
+    const direction_t isRight = left.bh < right.bh;
+    const subtree_t tall = isRight ? right : left, low = isRight ? left : right;
+    node_t *parent = t->nil, *cur = tall.root;
+    int bh = tall.bh;
+    while (COLOR(cur) == RBTREE_RED || bh > low.bh)
+    {
+        bh -= COLOR(cur) == RBTREE_BLACK;
+#ifdef RBTREE_ORDER_STAT
+        cur->size += low.root->size + 1;
+#endif
+        parent = cur;
+        cur = _getChild(cur, !isRight);
+    }
+    SET_COLOR(pivot, RBTREE_RED);
+    _setChild(pivot, cur, isRight, t);
+    _setChild(pivot, low.root, !isRight, t);
+    _setChild(parent, pivot, !isRight, t);
+#ifdef RBTREE_ORDER_STAT
+    pivot->size = cur->size + low.root->size + 1;
+#endif
+
+    // 루트가 회전으로 바뀌면 _rotate 가 t->root 에 적어 둔다
+    t->root = tall.root;
+    node_t *top = _fix_double_red(pivot, t);
+    if (PARENT(top) == t->nil && COLOR(top) == RBTREE_RED)
+    {
+        SET_COLOR(top, RBTREE_BLACK);
+        return (subtree_t){t->root, tall.bh + 1};
+    }
+    return (subtree_t){t->root, tall.bh};
+}
+
+// s 를 key 보다 작은 쪽 (*less) 과 나머지 (*rest) 로 나눔
+static void _split(subtree_t s, const key_t key, subtree_t *less, subtree_t *rest, rbtree *t)
+{
+    node_t *root = s.root;
+    if (root == t->nil)
+    {
+        *less = *rest = s;
+        return;
+    }
+    subtree_t left = _detach(root, LEFT, s.bh, t);
+    subtree_t right = _detach(root, RIGHT, s.bh, t);
+    // 같은 key 는 양쪽에 있을 수 있지만 root 보다 왼쪽은 root->key 이하, 오른쪽은 이상
+    if (key <= root->key)
+    {
+        _split(left, key, less, &left, t);
+        *rest = _join(left, root, right, t);
+    }
+    else
+    {
+        _split(right, key, &right, rest, t);
+        *less = _join(left, root, right, t);
+    }
+}
+
+// 비어 있지 않은 s 에서 가장 오른쪽 node 를 떼어 *last 에 넣고 나머지를 돌려줌
+static subtree_t _split_last(subtree_t s, node_t **last, rbtree *t)
+{
+    node_t *root = s.root;
+    subtree_t left = _detach(root, LEFT, s.bh, t);
+    subtree_t right = _detach(root, RIGHT, s.bh, t);
+    if (right.root == t->nil)
+    {
+        *last = root;
+        return left;
+    }
+    right = _split_last(right, last, t);
+    return _join(left, root, right, t);
+}
+
+// pivot 없이 left 의 key <= right 의 key 인 두 조각을 이어 붙임
+static subtree_t _join2(subtree_t left, subtree_t right, rbtree *t)
+{
+    if (left.root == t->nil)
+    {
+        return right;
+    }
+    if (right.root == t->nil)
+    {
+        return left;
+    }
+    node_t *pivot;
+    left = _split_last(left, &pivot, t);
+    return _join(left, pivot, right, t);
+}
+
+/*
+떼어 낸 subtree 의 node 를 모두 반납하고 개수를 반환
+왼쪽 자식이 있으면 오른쪽으로 회전시켜 한 줄 (vine) 로 펴 가며 훑으므로 스택 없이 O(k) 이고,
+반납하는 node 마다 fixup 이 없다.
+*/
+static size_t _free_subtree(node_t *cur, rbtree *t)
+{
+    size_t count = 0;
+    while (cur != t->nil)
+    {
+        node_t *left = cur->left;
+        if (left != t->nil)
+        {
+            cur->left = left->right;
+            left->right = cur;
+            cur = left;
+            continue;
+        }
+        node_t *next = cur->right;
+        _free_node(t, cur);
+        cur = next;
+        count++;
+    }
+    return count;
+}
+
+/*
+[lo, hi) 에 속한 node 를 모두 지우고 지운 개수를 반환
+lo 와 hi 에서 두 번 split 해 가운데 조각을 통째로 반납한 뒤 양쪽을 join 하므로 O(log n + k)
+지운 node 의 node_t * 는 더 이상 쓰면 안 된다. (남은 node 의 node_t * 는 그대로 유효)
+*/
+size_t rbtree_erase_range(rbtree *t, const key_t lo, const key_t hi)
+{
+    // 범위에 node 가 없으면 tree 를 건드리지 않음
+    const node_t *first = rbtree_lower_bound(t, lo);
+    if (lo >= hi || first == NULL || first->key >= hi)
+    {
+        return 0;
+    }
+    subtree_t whole = {t->root, _black_height(t->root, t)};
+    subtree_t less, inside, greater;
+    _split(whole, lo, &less, &greater, t);
+    _split(greater, hi, &inside, &greater, t);
+    const size_t count = _free_subtree(inside.root, t);
+
+    t->root = _join2(less, greater, t).root;
+    if (t->root != t->nil)
+    {
+        SET_COLOR(t->root, RBTREE_BLACK);
+    }
+    t->size -= count;
+    return count;
+}
+
+// 떼어 낸 두 subtree (합쳐서 total 개) 중 left 의 node 수
+static size_t _left_size(const node_t *left, const node_t *right, const size_t total, const rbtree *t)
+{
+#ifdef RBTREE_ORDER_STAT
+    (void)right;
+    (void)total;
+    return left->size;
+#else
+    // subtree 크기를 모르므로 두 쪽을 같이 훑어 먼저 끝나는 쪽을 셈 : O(작은 쪽)
+    const node_t *a = left == t->nil ? t->nil : _rbtree_min(left, t);
+    const node_t *b = right == t->nil ? t->nil : _rbtree_min(right, t);
+    size_t count = 0;
+    while (a != t->nil && b != t->nil)
+    {
+        a = _next_node(a, t);
+        b = _next_node(b, t);
+        count++;
+    }
+    return a == t->nil ? count : total - count;
+#endif
+}
+
+/*
+split
+t 의 node 를 그대로 두 tree 에 나눠 준다. 새 tree 는 t 와 같은 저장소를 붙잡으므로
+(sentinel 이 같아 leaf 를 고칠 필요가 없다) 어느 쪽을 먼저 지워도 된다.
+O(log n), 다만 -DRBTREE_ORDER_STAT 없이 빌드하면 양쪽 크기를 세느라 O(log n + 작은 쪽)
+*/
+void rbtree_split(rbtree *t, const key_t key, rbtree **left, rbtree **right)
+{
+    rbtree *r = _new_tree(t->pool.store);
+    if (r == NULL)
+    {
+        *left = *right = NULL;
+        return;
+    }
+    subtree_t less, rest;
+    _split((subtree_t){t->root, _black_height(t->root, t)}, key, &less, &rest, t);
+    t->root = _blacken(less).root;
+    r->root = _blacken(rest).root;
+
+    const size_t leftSize = _left_size(t->root, r->root, t->size, t);
+    r->size = t->size - leftSize;
+    t->size = leftSize;
+    *left = t;
+    *right = r;
+}
+
+// src 의 key 로 t 안에 같은 모양의 subtree 를 새로 만듦 (저장소가 다른 tree 를 합칠 때)
+// 메모리가 모자라면 t 는 그대로 두고 false
+static bool _copy_into(const rbtree *src, rbtree *t, subtree_t *out)
+{
+    const size_t n = src->size;
+    if (n == 0)
+    {
+        *out = (subtree_t){t->nil, 0};
+        return true;
+    }
+    key_t *keys = malloc(n * sizeof(key_t));
+    if (keys == NULL)
+    {
+        return false;
+    }
+    rbtree_to_array(src, keys, n);
+    node_t *root = _build_sorted(t, NULL, keys, 0, n, 0, _red_depth(n), t->nil);
+    free(keys);
+    if (root == NULL)
+    {
+        return false;
+    }
+    *out = (subtree_t){root, _black_height(root, t)};
+    return true;
+}
+
+// 같은 저장소의 other 의 node 를 모두 t 로 옮긴 뒤 : 크기와 반납해 둔 node 를 넘겨받고 other 를 지움
+static void _absorb(rbtree *t, rbtree *other)
+{
+    t->size += other->size;
+    other->root = other->nil;
+#ifndef RBTREE_NO_POOL
+    node_t *freed = other->pool.free_list;
+    if (freed != NULL)
+    {
+        node_t *tail = freed;
+        while (tail->right != NULL)
+        {
+            tail = tail->right;
+        }
+        tail->right = t->pool.free_list;
+        t->pool.free_list = freed;
+    }
+#endif
+    delete_rbtree(other);
+}
+
+/*
+join
+split 으로 갈라진 (같은 저장소의) tree 끼리는 node 를 그대로 옮겨 O(log n) 이다.
+저장소가 다른 tree 는 sentinel 이 달라 node 를 그대로 옮길 수 없으므로
+작은 쪽의 key 를 큰 쪽 저장소에 복사해 붙인다. O(log n + 작은 쪽), 작은 쪽의 node_t * 는 무효가 된다.
+*/
+rbtree *rbtree_join(rbtree *left, const key_t pivot, rbtree *right)
+{
+    const node_t *max = rbtree_max(left), *min = rbtree_min(right);
+    if ((max != NULL && max->key > pivot) || (min != NULL && min->key < pivot))
+    {
+        return NULL;
+    }
+    // t 로 합치고 other 는 지움
+    const bool shared = left->pool.store == right->pool.store;
+    rbtree *t = left, *other = right;
+    if (!shared && left->size < right->size)
+    {
+        t = right;
+        other = left;
+    }
+    // pivot 과 복사본을 다 만든 뒤에야 두 tree 를 고침 (메모리가 모자라면 둘 다 그대로)
+    node_t *p = _new_node(pivot, t);
+    if (p == NULL)
+    {
+        return NULL;
+    }
+    subtree_t moved = {other->root, 0};
+    if (shared)
+    {
+        moved.bh = _black_height(other->root, other);
+    }
+    else if (!_copy_into(other, t, &moved))
+    {
+        _free_node(t, p);
+        t->size--;
+        return NULL;
+    }
+    subtree_t kept = {t->root, _black_height(t->root, t)};
+
+    subtree_t joined = t == left ? _join(kept, p, moved, t) : _join(moved, p, kept, t);
+    t->root = _blacken(joined).root;
+    if (shared)
+    {
+        _absorb(t, other);
+    }
+    else
+    {
+        t->size += other->size;
+        delete_rbtree(other);
+    }
+    return t;
+}
+
+/*
+집합 연산 (union / intersection / difference)
+입력은 그대로 두고 결과를 새 tree 로 만든다. key 를 집합으로 보므로 같은 key 는 결과에 하나만 남는다.
+join 기반 분할 정복 : pivot 쪽 tree 의 루트 key k 로 문제를 (lo, k) 와 (k, hi) 두 범위로 나눠 따로 풀고,
+k 를 남기면 새 node 를 pivot 으로 두 결과를 _join, 아니면 _join2 한다.
+입력을 실제로 split 하지 않고 열린 범위 (lo, hi) 만 내려보내며, 범위가 열려 있어 경계와 같은 (중복) key 는
+아래에서 자연히 빠진다. 한쪽 범위가 비면 다른 쪽 범위를 같은 재귀로 통째로 복사한다.
+pivot 은 작은 쪽 tree (m 개) 라 큰 쪽을 찾는 비용은 O(m log n), 나머지는 결과 크기에 비례한다.
+
+위쪽 몇 단계에서는 (lo, k) 쪽을 새 thread 에서 풀고 끝나면 합친다. (fork-join)
+_join 은 t->root 를 작업 공간으로 쓰고 node 할당기도 tree 마다 있으므로,
+thread 마다 결과와 같은 저장소를 붙잡은 작업용 tree 를 따로 주어 lock 없이 돈다.
+thread 수는 CPU 수로 정하며 -DRBTREE_SETOP_THREADS=8 처럼 고정할 수 있다.
+*/
+#ifndef RBTREE_SETOP_THREADS
+#define RBTREE_SETOP_THREADS 0
+#endif
+// thread 하나가 맡을 최소 node 수 (두 입력 합계 기준) : 이보다 작으면 thread 를 만드는 비용이 더 큼
+#define SETOP_FORK_MIN 16384
+
+typedef struct
+{
+    const rbtree *pivot, *other;  // 루트 key 로 나누는 쪽과 그 key 를 찾아보는 쪽
+    bool pivotOnly, otherOnly, both;  // 한쪽에만 / 양쪽에 있는 key 를 결과에 남기는지
+    int forkDepth;  // 이 깊이까지는 thread 를 나눔
+    bool *failed;   // node 를 할당하지 못하면 true (모든 thread 가 같이 씀)
+} set_op_t;
+
+// subtree node 중 열린 범위 (lo, hi) 의 key 를 가진 가장 위 node (없으면 nil)
+static const node_t *_narrow(const node_t *node, const int64_t lo, const int64_t hi, const rbtree *t)
+{
+    while (node != t->nil && (node->key <= lo || node->key >= hi))
+    {
+        node = node->key <= lo ? node->right : node->left;
+    }
+    return node;
+}
+
+static bool _contains(const node_t *node, const key_t key, const rbtree *t)
+{
+    while (node != t->nil && node->key != key)
+    {
+        node = key < node->key ? node->left : node->right;
+    }
+    return node != t->nil;
+}
+
+typedef struct
+{
+    const node_t *p, *o;
+    int64_t lo, hi;
+    int depth;
+    const set_op_t *op;
+    rbtree *out;
+    subtree_t result;
+} set_op_task_t;
+
+static void *_set_op_thread(void *arg);
+
+// p (pivot 쪽) 와 o (상대 쪽) subtree 중 (lo, hi) 범위의 key 로 결과 subtree 를 out 에 만듦
+static subtree_t _set_op(const node_t *p, const node_t *o, const int64_t lo, const int64_t hi,
+                         const int depth, const set_op_t *op, rbtree *out)
+{
+    const rbtree *pt = op->pivot, *ot = op->other;
+    p = _narrow(p, lo, hi, pt);
+    o = _narrow(o, lo, hi, ot);
+    if (p == pt->nil)
+    {
+        if (!op->otherOnly || o == ot->nil)
+        {
+            return (subtree_t){out->nil, 0};
+        }
+        // 상대 쪽 범위를 통째로 복사 : 상대를 pivot 으로, 빈 상대와 같은 재귀를 돈다
+        const set_op_t copy = {ot, ot, true, false, false, op->forkDepth, op->failed};
+        return _set_op(o, ot->nil, lo, hi, depth, &copy, out);
+    }
+    if (o == ot->nil && !op->pivotOnly)
+    {
+        return (subtree_t){out->nil, 0};
+    }
+
+    const key_t key = p->key;
+    const bool keep = o != ot->nil && _contains(o, key, ot) ? op->both : op->pivotOnly;
+    subtree_t left, right;
+    // 작업용 tree 를 만들지 못하면 thread 를 나누지 않고 이 thread 에서 품
+    rbtree *work = depth < op->forkDepth ? _new_tree(out->pool.store) : NULL;
+    if (work != NULL)
+    {
+        set_op_task_t task = {p->left, o, lo, key, depth + 1, op, work};
+        pthread_t thread;
+        const bool forked = pthread_create(&thread, NULL, _set_op_thread, &task) == 0;
+        if (!forked)
+        {
+            _set_op_thread(&task);
+        }
+        right = _set_op(p->right, o, key, hi, depth + 1, op, out);
+        if (forked)
+        {
+            pthread_join(thread, NULL);
+        }
+        left = task.result;
+        _absorb(out, task.out);
+    }
+    else
+    {
+        left = _set_op(p->left, o, lo, key, depth + 1, op, out);
+        right = _set_op(p->right, o, key, hi, depth + 1, op, out);
+    }
+    node_t *pivot = keep ? _new_node(key, out) : NULL;
+    if (keep && pivot == NULL)
+    {
+        // 결과는 버릴 것이지만 node 가 모두 out 에 엮여 있어야 delete_rbtree 로 반납됨
+        __atomic_store_n(op->failed, true, __ATOMIC_RELAXED);
+    }
+    return pivot != NULL ? _join(left, pivot, right, out) : _join2(left, right, out);
+}
+
+static void *_set_op_thread(void *arg)
+{
+    set_op_task_t *task = arg;
+    task->result = _set_op(task->p, task->o, task->lo, task->hi, task->depth, task->op, task->out);
+    return NULL;
+}
+
+// thread 를 2^depth 개까지 나눌 깊이 : CPU 수의 4 배 정도로 나눠 부분 문제 크기가 고르지 않아도 놀지 않게
+static int _fork_depth(const size_t total)
+{
+    long threads = RBTREE_SETOP_THREADS;
+    if (threads == 0)
+    {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 1 ? cpus * 4 : 1;
+    }
+    int depth = 0;
+    while ((1L << depth) < threads && (total >> (depth + 1)) >= SETOP_FORK_MIN)
+    {
+        depth++;
+    }
+    return depth;
+}
+
+// 메모리가 모자라면 만들던 결과를 모두 반납하고 NULL
+static rbtree *_set_operation(set_op_t op)
+{
+    rbtree *out = new_rbtree();
+    if (out == NULL)
+    {
+        return NULL;
+    }
+    bool failed = false;
+    op.forkDepth = _fork_depth(op.pivot->size + op.other->size);
+    op.failed = &failed;
+    // out->size 는 _new_node 가 센다 (다른 thread 의 몫은 _absorb 로 더해짐)
+    out->root = _blacken(_set_op(op.pivot->root, op.other->root, INT64_MIN, INT64_MAX, 0, &op, out)).root;
+    if (failed)
+    {
+        delete_rbtree(out);
+        return NULL;
+    }
+    return out;
+}
+
+rbtree *rbtree_union(const rbtree *a, const rbtree *b)
+{
+    const bool aSmall = a->size <= b->size;
+    return _set_operation((set_op_t){aSmall ? a : b, aSmall ? b : a, true, true, true});
+}
+
+rbtree *rbtree_intersection(const rbtree *a, const rbtree *b)
+{
+    const bool aSmall = a->size <= b->size;
+    return _set_operation((set_op_t){aSmall ? a : b, aSmall ? b : a, false, false, true});
+}
+
+// a 에만 있는 key
+rbtree *rbtree_difference(const rbtree *a, const rbtree *b)
+{
+    if (a->size <= b->size)
+    {
+        return _set_operation((set_op_t){a, b, true, false, false});
+    }
+    return _set_operation((set_op_t){b, a, false, true, false});
+}
+
+/*
+[lo, hi) 에 속한 key 를 순서대로 최대 cap 개까지 out 에 쓰고 쓴 개수를 반환
+lower_bound 로 한 번 내려간 뒤 범위 안의 node 만 따라가므로 O(log n + k)
+*/
+size_t rbtree_range_to_array(const rbtree *t, const key_t lo, const key_t hi, key_t *out, const size_t cap)
+{
+    size_t count = 0;
+    if (cap == 0 || lo >= hi)
+    {
+        return 0;
+    }
+    node_t *cur = rbtree_lower_bound(t, lo);
+    while (cur != NULL && cur->key < hi && count < cap)
+    {
+        out[count++] = cur->key;
+        cur = rbtree_next(t, cur);
+    }
+    return count;
+}
+
+size_t rbtree_size(const rbtree *t)
+{
+    return t->size;
+}
+
+// node 수와 깊이 합을 더하고 node 를 루트로 하는 subtree 의 높이를 돌려줌 (높이는 2 log n 을 넘지 않음)
+static int _depth_stats(const node_t *node, const size_t depth, size_t *count, double *depthSum, const rbtree *t)
+{
+    if (node == t->nil)
+    {
+        return 0;
+    }
+    (*count)++;
+    *depthSum += depth;
+    const int left = _depth_stats(node->left, depth + 1, count, depthSum, t);
+    const int right = _depth_stats(node->right, depth + 1, count, depthSum, t);
+    return 1 + (left > right ? left : right);
+}
+
+void rbtree_stats(const rbtree *t, rbtree_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    double depthSum = 0;
+    out->height = _depth_stats(t->root, 0, &out->nodes, &depthSum, t);
+    out->black_height = _black_height(t->root, t);
+    out->avg_depth = out->nodes > 0 ? depthSum / out->nodes : 0;
+#ifdef RBTREE_STATS
+    out->ops = t->counters;
+    out->ops.searches = __atomic_load_n(&t->counters.searches, __ATOMIC_RELAXED);
+    out->ops.comparisons = __atomic_load_n(&t->counters.comparisons, __ATOMIC_RELAXED);
+#endif
+}
+
+#ifdef RBTREE_ORDER_STAT
+// 0 부터 센 k 번째로 작은 node, k >= size 이면 NULL
+node_t *rbtree_select(const rbtree *t, size_t k)
+{
+    node_t *cur = t->root;
+    while (cur != t->nil)
+    {
+        size_t leftSize = cur->left->size;
+        if (k == leftSize)
+        {
+            return cur;
+        }
+        if (k < leftSize)
+        {
+            cur = cur->left;
+        }
+        else
+        {
+            k -= leftSize + 1;
+            cur = cur->right;
+        }
+    }
+    return NULL;
+}
+
+// key 보다 작은 원소의 수 (= lower_bound 의 순서)
+size_t rbtree_rank(const rbtree *t, const key_t key)
+{
+    size_t rank = 0;
+    node_t *cur = t->root;
+    while (cur != t->nil)
+    {
+        if (cur->key >= key)
+        {
+            cur = cur->left;
+        }
+        else
+        {
+            rank += cur->left->size + 1;
+            cur = cur->right;
+        }
+    }
+    return rank;
+}
+#endif
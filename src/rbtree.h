@@ -3,32 +3,233 @@
 #define SENTINEL 1
 
 #include <stddef.h>
+#include <stdint.h>
 
 typedef enum { RBTREE_RED, RBTREE_BLACK } color_t;
 
 typedef int key_t;
 
+#if defined(RBTREE_INDEX)
+// 32bit index 로 node 를 잇는 engine (src/rbtree_index.c, x86-64 에서 16 byte)
+// link 는 t->nodes 안의 index 이고 0 번이 sentinel 이다.
+// parent_color 의 최상위 비트가 color 이므로 node 는 2^31 - 1 개까지 담을 수 있다.
+typedef struct node_t {
+  uint32_t parent_color;
+  uint32_t left, right;
+  key_t key;
+#ifdef RBTREE_ORDER_STAT
+  uint32_t size;
+#endif
+} node_t;
+
+#define RBTREE_COLOR(n) ((color_t)((n)->parent_color >> 31))
+#define RBTREE_PARENT_INDEX(n) ((n)->parent_color & 0x7fffffffu)
+#define RBTREE_NODE(t, i) (&(t)->nodes[(i)])
+#elif defined(RBTREE_COMPACT)
+// color 를 parent 포인터의 최하위 비트에 넣은 배치 (x86-64 에서 28 byte)
+// node 는 4 byte 정렬이라 포인터 하위 비트가 항상 비어 있다.
+typedef struct node_t {
+  uintptr_t parent_color;
+  struct node_t *left, *right;
+  key_t key;
+#ifdef RBTREE_ORDER_STAT
+  size_t size;
+#endif
+} __attribute__((packed, aligned(4))) node_t;
+
+#define RBTREE_COLOR(n) ((color_t)((n)->parent_color & 1))
+#define RBTREE_PARENT(n) ((node_t *)((n)->parent_color & ~(uintptr_t)1))
+#elif defined(RBTREE_BTREE)
+// key 를 node 마다 RBTREE_BTREE_KEYS 개씩 모은 B+ tree engine (src/rbtree_btree.c)
+// node_t 는 leaf 안의 key 칸 하나이다. insert / erase 때 같은 leaf 의 key 가 밀리거나 다른 leaf 로 옮겨지므로
+// 반환된 node_t * 는 다음 insert / erase 전까지만 유효하다.
+#define RBTREE_BTREE_KEYS 16  // 32bit key 16 개 = cache line 하나
+
+typedef struct node_t {
+  key_t key;
+} node_t;
+
+// leaf 와 inner node 가 같이 쓰는 앞부분 (leaf 는 이것만 할당). keys 가 첫 cache line 을 통째로 차지해 SIMD 비교 한 번에 읽힌다.
+// inner node 의 child[i] 아래 key 는 keys[i - 1] 이상 keys[i] 이하이다. (같은 key 는 양쪽에 있을 수 있음)
+typedef struct btree_node_t {
+  key_t keys[RBTREE_BTREE_KEYS];  // leaf 는 key (node_t 칸), inner 는 separator
+  struct btree_node_t *parent;
+  uint32_t n;     // key (separator) 수. inner 의 child 는 n + 1 개
+  uint32_t leaf;
+#ifdef RBTREE_ORDER_STAT
+  size_t size;  // inner 아래의 key 수 (leaf 는 n)
+#endif
+  struct btree_node_t *prev, *next;  // leaf 만 : 이웃 leaf
+} btree_node_t;
+
+// inner node : 앞부분 뒤에 child 를 붙임 (x86-64 에서 256 byte)
+typedef struct {
+  btree_node_t node;
+  btree_node_t *child[RBTREE_BTREE_KEYS + 1];
+} __attribute__((aligned(64))) btree_inner_t;
+#else
 typedef struct node_t {
   color_t color;
   key_t key;
   struct node_t *parent, *left, *right;
+#ifdef RBTREE_ORDER_STAT
+  size_t size;  // 이 node 를 루트로 하는 subtree 의 node 수
+#endif
 } node_t;
 
+#define RBTREE_COLOR(n) ((n)->color)
+#define RBTREE_PARENT(n) ((n)->parent)
+#endif
+
+// node_t 를 묶어서 한 번에 할당하는 블록 (slab)
+// nodes 는 cache line 에 맞춰 두어 32 byte node 가 두 line 에 걸치지 않게 한다.
+typedef struct node_slab_t {
+  struct node_slab_t *next;
+  size_t cap;
+  node_t nodes[] __attribute__((aligned(64)));
+} node_slab_t;
+
+// node 저장소 : sentinel 과 slab 의 주인
+// tree 마다 하나씩 만들고, split 으로 갈라진 tree 들은 node 를 나눠 가지므로 같은 저장소를 붙잡는다.
+// 마지막 tree 가 지워질 때 slab 과 함께 해제된다. 관계없는 tree 끼리는 공유하지 않는다.
+typedef struct {
+  size_t refs;         // 이 저장소를 붙잡은 tree 수
+  node_slab_t *slabs;  // 가장 최근 slab 이 맨 앞 (다른 thread 의 tree 도 붙이므로 atomic 으로)
+  node_t nil;          // 같이 쓰는 sentinel (읽기만 함)
+} node_store_t;
+
+// tree 마다 하나씩 갖는 node 할당기
+// 반납된 node 는 right 포인터로 엮어 free_list 에 두었다가 재사용한다.
+typedef struct {
+  node_store_t *store;
+  node_slab_t *slab;  // 잘라 쓰고 있는 slab
+  size_t used;        // slab 에서 잘라 쓴 node 수
+  node_t *free_list;
+} node_pool_t;
+
+// -DRBTREE_STATS 로 빌드하면 tree 마다 세는 연산 counter (tree 를 만든 때부터 누적, pointer engine 만)
+// tree 를 고치지 않는 find 계열의 searches / comparisons 는 여러 thread 가 같이 읽어도 되도록 atomic 으로 센다.
+typedef struct {
+  uint64_t inserts, erases, searches;        // rbtree_insert / rbtree_erase / find, lower_bound, upper_bound 호출 수
+  uint64_t insert_fixups, insert_rotations;  // 이중 red 를 고치는 loop 반복 수와 회전 수 (insert, batch, join)
+  uint64_t erase_fixups, erase_rotations;    // rbtree_erase 의 double black loop 반복 수와 회전 수
+  uint64_t erase_cases[4];                   // 그 loop 에서 CASE 1 ~ 4 를 지난 횟수
+  uint64_t comparisons;                      // find 계열이 key 를 비교한 node 수
+  uint64_t node_allocs, node_frees;          // node 할당기 호출 수
+  uint64_t slab_allocs;                      // 할당기가 새 slab 을 잡은 수 (-DRBTREE_NO_POOL 이면 node 마다 malloc)
+} rbtree_counters_t;
+
+// rbtree_stats 결과 : 구조는 호출할 때 tree 를 훑어 잰다.
+typedef struct {
+  size_t nodes;
+  int height;             // 루트부터 가장 깊은 node 까지의 node 수 (빈 tree 면 0)
+  int black_height;       // 루트부터 NIL 까지 지나는 black node 수
+  double avg_depth;       // node 깊이의 평균 (루트가 0)
+  rbtree_counters_t ops;  // -DRBTREE_STATS 가 아니면 모두 0
+} rbtree_stats_t;
+
+#if defined(RBTREE_BTREE)
+typedef struct {
+  btree_node_t *root;  // 빈 tree 면 NULL
+  size_t size;
+} rbtree;
+#elif defined(RBTREE_INDEX)
+// node 는 배열 하나에 모여 있어 통째로 옮기거나 저장할 수 있다.
+// 배열이 커질 때 realloc 되므로 반환된 node_t * 는 다음 insert 전까지만 유효하다.
+typedef struct {
+  node_t *nodes;  // nodes[0] 은 sentinel
+  uint32_t root;
+  uint32_t cap, used;
+  uint32_t free_list;  // 반납된 index 를 right 로 엮음
+  size_t size;
+} rbtree;
+#else
 typedef struct {
   node_t *root;
-  node_t *nil;  // for sentinel
+  node_t *nil;  // for sentinel (&pool.store->nil)
+  node_pool_t pool;
+  size_t size;
+#ifdef RBTREE_STATS
+  rbtree_counters_t counters;
+#endif
 } rbtree;
+#endif
 
+// 중위 순회 위치. node 가 NULL 이면 끝을 지난 상태
+typedef struct {
+  const rbtree *tree;
+  node_t *node;
+} rbtree_cursor;
+
+// rbtree_export 가 chunk 마다 부르는 함수 : keys[0, n) 은 이어지는 key. 0 이 아니면 멈추고 그 값을 돌려줌
+typedef int (*rbtree_export_fn)(const key_t *keys, size_t n, void *arg);
+
+// 메모리가 모자라면 NULL
 rbtree *new_rbtree(void);
 void delete_rbtree(rbtree *);
 
+// 넣은 node 를 돌려줌. node 를 할당하지 못하면 (index engine 은 2^31 - 1 개로 가득 차도) NULL 이고 tree 는 그대로
 node_t *rbtree_insert(rbtree *, const key_t);
+// keys 를 정렬해서 한꺼번에 넣음. 성공하면 0, 정렬 buffer 를 잡지 못하면 -1 이고 tree 는 그대로
+// (기본 engine 과 B+ tree engine 에서 중간에 node 를 할당하지 못해도 -1 : 그때는 앞쪽 key 만 들어감)
+int rbtree_insert_batch(rbtree *, const key_t *, const size_t);
 node_t *rbtree_find(const rbtree *, const key_t);
+// keys[i] 를 찾은 node (없으면 NULL) 를 out[i] 에 쓰고 찾은 개수를 반환
+size_t rbtree_find_batch(const rbtree *, const key_t *, const size_t, node_t **);
+node_t *rbtree_lower_bound(const rbtree *, const key_t);
+node_t *rbtree_upper_bound(const rbtree *, const key_t);
 node_t *rbtree_min(const rbtree *);
 node_t *rbtree_max(const rbtree *);
 int rbtree_erase(rbtree *, node_t *);
+// [lo, hi) 의 node 를 한꺼번에 지우고 지운 개수를 반환
+// O(log n + k), B+ tree engine 은 O(log n + k log n) (k 가 tree 의 절반 이상이면 다시 만들어 O(n))
+size_t rbtree_erase_range(rbtree *, const key_t lo, const key_t hi);
+
+// t 를 key 보다 작은 쪽 (*left) 과 나머지 (*right) 로 나눔. 이후 t 대신 두 tree 를 쓴다.
+// 메모리가 모자라면 *left, *right 를 NULL 로 두고 t 는 그대로 둔다.
+void rbtree_split(rbtree *, const key_t, rbtree **left, rbtree **right);
+// left 의 key <= pivot <= right 의 key 이면 pivot 을 넣어 합친 tree 를 돌려줌 (left, right 는 더 이상 쓰지 않음)
+// 순서가 맞지 않거나 메모리가 모자라면 NULL 을 돌려주고 두 tree 는 그대로 둔다.
+rbtree *rbtree_join(rbtree *left, const key_t pivot, rbtree *right);
+
+// 두 tree 는 그대로 두고 합집합 / 교집합 / 차집합 (a 에만 있는 key) 을 새 tree 로 만듦 (같은 key 는 하나만)
+// pointer engine 은 큰 입력을 여러 thread 로 나눠 푼다. index / B+ tree engine 은 두 tree 를 한 번 병합하는 O(n + m) 으로
+// thread 를 쓰지 않는다. 메모리가 모자라면 NULL
+rbtree *rbtree_union(const rbtree *, const rbtree *);
+rbtree *rbtree_intersection(const rbtree *, const rbtree *);
+rbtree *rbtree_difference(const rbtree *a, const rbtree *b);
+
+node_t *rbtree_next(const rbtree *, node_t *);
+node_t *rbtree_prev(const rbtree *, node_t *);
+
+rbtree_cursor rbtree_cursor_first(const rbtree *);
+rbtree_cursor rbtree_cursor_last(const rbtree *);
+node_t *rbtree_cursor_next(rbtree_cursor *);
+node_t *rbtree_cursor_prev(rbtree_cursor *);
+// 커서 위치부터 최대 cap 개의 key 를 out 에 쓰고 그 다음으로 옮김. 쓴 개수를 반환 (끝이면 0)
+size_t rbtree_cursor_read(rbtree_cursor *, key_t *out, const size_t cap);
+// buf[0, cap) 를 chunk 로 다시 채워 가며 모든 key 를 순서대로 fn 에 넘김. 다 넘기면 0, 아니면 fn 이 돌려준 값
+int rbtree_export(const rbtree *, key_t *buf, const size_t cap, rbtree_export_fn fn, void *arg);
+
+// node 를 van Emde Boas 순서로 연속된 블록 하나에 다시 배치 (읽기 위주가 된 tree 의 find 를 빠르게)
+// 이전에 받은 node_t * 는 더 이상 쓸 수 없다. 이후에도 보통 tree 처럼 고칠 수 있다.
+// 옛 node 메모리를 해제하므로 concurrent_rbtree 가 감싼 tree 에는 쓰지 않는다.
+// 성공하면 0, 옮길 수 없는 빌드 (-DRBTREE_NO_POOL) 나 메모리가 모자라면 -1 (tree 는 그대로)
+int rbtree_freeze(rbtree *);
 
 int rbtree_to_array(const rbtree *, key_t *, const size_t);
+// 메모리가 모자라면 NULL
+rbtree *rbtree_from_sorted_array(const key_t *, const size_t);
+size_t rbtree_range_to_array(const rbtree *, const key_t lo, const key_t hi, key_t *, const size_t);
+
+size_t rbtree_size(const rbtree *);
+// 높이, black height, node 수, 평균 깊이 (O(n)) 와 -DRBTREE_STATS 의 연산 counter
+void rbtree_stats(const rbtree *, rbtree_stats_t *out);
+#ifdef RBTREE_ORDER_STAT
+// -DRBTREE_ORDER_STAT 로 빌드하면 node 마다 subtree 크기를 유지해 O(log n) 으로 동작
+node_t *rbtree_select(const rbtree *, size_t);
+size_t rbtree_rank(const rbtree *, const key_t);
+#endif
 
 // custom function
 // void _rotate(node_t *parent, direction_t isRight);
@@ -0,0 +1,1324 @@
+#include "rbtree.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+/*
+B+ tree engine
+rbtree.c 와 같은 API 를 key 여러 개를 담는 node 로 구현한다. (-DRBTREE_BTREE 로 빌드)
+key 는 모두 leaf 에 있고 leaf 끼리는 prev / next 로 이어져 있어 next / prev / cursor 는 대부분 같은 leaf 안에서 끝난다.
+node 하나의 key (separator) 는 cache line 하나라 한 level 을 내려갈 때 cache miss 가 한 번이다.
+red-black tree 는 key 하나마다 한 level (log2 n) 을 내려가지만 여기서는 log17 n 정도이다.
+
+node 는 루트가 아니면 key (separator) 를 MIN_KEYS 개 이상 갖는다.
+insert 는 가득 찬 node 를 반으로 나누고, erase 는 모자란 node 를 형제와 합치거나 형제에게서 하나 빌려 온다.
+*/
+#define KEYS RBTREE_BTREE_KEYS
+#define MIN_KEYS (KEYS / 2)
+
+// leaf 는 btree_node_t 만큼만 쓰므로 128 byte 로 할당하고 128 byte 에 맞춰 둔다.
+// 그래서 node_t * 의 하위 비트를 지우면 그 key 가 든 leaf 가 나온다.
+#define LEAF_BYTES 128
+#define LEAF_OF(p) ((btree_node_t *)((uintptr_t)(p) & ~(uintptr_t)(LEAF_BYTES - 1)))
+#define SLOT(leaf, i) ((node_t *)&(leaf)->keys[(i)])
+#define SLOT_INDEX(leaf, p) ((uint32_t)(&(p)->key - (leaf)->keys))
+#define CHILDREN(node) (((btree_inner_t *)(node))->child)
+
+_Static_assert(sizeof(btree_node_t) <= LEAF_BYTES, "leaf 가 128 byte 를 넘음");
+_Static_assert(sizeof(key_t) == 4 && KEYS == 16, "SIMD 비교는 32bit key 16 개 기준");
+
+// -DRBTREE_TRACE : insert / find / erase 를 기록 (rbtree.c 와 같음)
+#ifdef RBTREE_TRACE
+#include "rbtree_trace.h"
+#define TRACE(op, key) rbtree_trace_record((op), (key))
+#else
+#define TRACE(op, key) ((void)0)
+#endif
+
+/*
+node 안의 비교
+keys[0, n) 중 key 보다 작은 (이하인) 것의 수를 센다. keys 가 정렬되어 있으므로 이 수가 곧 내려갈 child / 들어갈 칸이다.
+16 개를 한꺼번에 비교해 bit mask 로 모으고 n 개만 남겨 센다. (n 뒤의 칸은 쓰레기 값이어도 됨)
+AVX2 면 8 개씩 두 번, SSE2 (x86-64 기본) 면 4 개씩 네 번, 그 밖에는 하나씩 비교한다.
+*/
+static inline uint32_t _greater_mask(const key_t *keys, const key_t key)
+{
+#if defined(__AVX2__)
+    const __m256i k = _mm256_set1_epi32(key);
+    const __m256i lo = _mm256_load_si256((const __m256i *)keys);
+    const __m256i hi = _mm256_load_si256((const __m256i *)(keys + 8));
+    return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(lo, k))) |
+           (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(hi, k))) << 8;
+#elif defined(__SSE2__)
+    const __m128i k = _mm_set1_epi32(key);
+    uint32_t mask = 0;
+    for (int i = 0; i < KEYS; i += 4)
+    {
+        const __m128i v = _mm_load_si128((const __m128i *)(keys + i));
+        mask |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, k))) << i;
+    }
+    return mask;
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < KEYS; i++)
+    {
+        mask |= (uint32_t)(keys[i] > key) << i;
+    }
+    return mask;
+#endif
+}
+
+static inline uint32_t _less_mask(const key_t *keys, const key_t key)
+{
+#if defined(__AVX2__)
+    const __m256i k = _mm256_set1_epi32(key);
+    const __m256i lo = _mm256_load_si256((const __m256i *)keys);
+    const __m256i hi = _mm256_load_si256((const __m256i *)(keys + 8));
+    return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, lo))) |
+           (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, hi))) << 8;
+#elif defined(__SSE2__)
+    const __m128i k = _mm_set1_epi32(key);
+    uint32_t mask = 0;
+    for (int i = 0; i < KEYS; i += 4)
+    {
+        const __m128i v = _mm_load_si128((const __m128i *)(keys + i));
+        mask |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, k))) << i;
+    }
+    return mask;
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < KEYS; i++)
+    {
+        mask |= (uint32_t)(keys[i] < key) << i;
+    }
+    return mask;
+#endif
+}
+
+// keys[0, n) 중 key 보다 작은 것의 수
+static inline uint32_t _count_less(const btree_node_t *node, const key_t key)
+{
+    return (uint32_t)__builtin_popcount(_less_mask(node->keys, key) & ((1u << node->n) - 1));
+}
+
+// keys[0, n) 중 key 이하인 것의 수
+static inline uint32_t _count_less_equal(const btree_node_t *node, const key_t key)
+{
+    return node->n - (uint32_t)__builtin_popcount(_greater_mask(node->keys, key) & ((1u << node->n) - 1));
+}
+
+// 메모리가 모자라면 NULL
+static btree_node_t *_new_leaf(void)
+{
+    btree_node_t *leaf = aligned_alloc(LEAF_BYTES, LEAF_BYTES);
+    if (leaf == NULL)
+    {
+        return NULL;
+    }
+    memset(leaf, 0, LEAF_BYTES);
+    leaf->leaf = 1;
+    return leaf;
+}
+
+static btree_node_t *_new_inner(void)
+{
+    btree_inner_t *inner = aligned_alloc(_Alignof(btree_inner_t), sizeof(btree_inner_t));
+    if (inner == NULL)
+    {
+        return NULL;
+    }
+    memset(inner, 0, sizeof(btree_inner_t));
+    return &inner->node;
+}
+
+static void _free_subtree(btree_node_t *node)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+    if (!node->leaf)
+    {
+        for (uint32_t i = 0; i <= node->n; i++)
+        {
+            _free_subtree(CHILDREN(node)[i]);
+        }
+    }
+    free(node);
+}
+
+rbtree *new_rbtree(void)
+{
+    return (rbtree *)calloc(1, sizeof(rbtree));
+}
+
+void delete_rbtree(rbtree *t)
+{
+    _free_subtree(t->root);
+    free(t);
+}
+
+#ifdef RBTREE_ORDER_STAT
+static size_t _size(const btree_node_t *node)
+{
+    return node->leaf ? node->n : node->size;
+}
+
+static void _recount(btree_node_t *node)
+{
+    node->size = 0;
+    for (uint32_t i = 0; i <= node->n; i++)
+    {
+        node->size += _size(CHILDREN(node)[i]);
+    }
+}
+#endif
+
+static uint32_t _child_index(const btree_node_t *parent, const btree_node_t *child)
+{
+    uint32_t i = 0;
+    while (CHILDREN(parent)[i] != child)
+    {
+        i++;
+    }
+    return i;
+}
+
+static btree_node_t *_leftmost_leaf(btree_node_t *node)
+{
+    while (!node->leaf)
+    {
+        node = CHILDREN(node)[0];
+    }
+    return node;
+}
+
+static btree_node_t *_rightmost_leaf(btree_node_t *node)
+{
+    while (!node->leaf)
+    {
+        node = CHILDREN(node)[node->n];
+    }
+    return node;
+}
+
+/*
+insert
+separator 가 key 이하인 쪽으로 내려가 (같은 key 는 뒤에 붙음) leaf 에 넣는다.
+leaf 가 가득 차 있으면 반으로 나누고 오른쪽 leaf 의 첫 key 를 separator 로 parent 에 올린다.
+parent 도 가득 차 있으면 같은 방식으로 나누며 올라가고, 루트가 나뉘면 tree 가 한 level 높아진다.
+나뉠 node 수는 내려간 경로만 보면 알 수 있으므로 새 node 를 먼저 모두 할당하고,
+하나라도 모자라면 tree 를 건드리기 전에 NULL 을 돌려준다.
+*/
+#define MAX_LEVELS 32  // 루트가 아닌 node 는 child 가 MIN_KEYS + 1 개 이상이라 2^64 개 key 도 21 level 이하
+
+// 나뉜 node (left) 의 오른쪽에 right 를 붙이고 그 사이 separator 를 sep 로 둠
+// 새 inner node 는 spare 에 미리 할당해 둔 것을 앞에서부터 씀
+static void _insert_parent(rbtree *t, btree_node_t *left, key_t sep, btree_node_t *right, btree_node_t **spare)
+{
+    while (true)
+    {
+        btree_node_t *parent = left->parent;
+        if (parent == NULL)
+        {
+            btree_node_t *root = *spare++;
+            root->n = 1;
+            root->keys[0] = sep;
+            CHILDREN(root)[0] = left;
+            CHILDREN(root)[1] = right;
+            left->parent = right->parent = root;
+#ifdef RBTREE_ORDER_STAT
+            _recount(root);
+#endif
+            t->root = root;
+            return;
+        }
+        right->parent = parent;
+        const uint32_t i = _child_index(parent, left);
+        if (parent->n < KEYS)
+        {
+            memmove(&parent->keys[i + 1], &parent->keys[i], (parent->n - i) * sizeof(key_t));
+            memmove(&CHILDREN(parent)[i + 2], &CHILDREN(parent)[i + 1], (parent->n - i) * sizeof(btree_node_t *));
+            parent->keys[i] = sep;
+            CHILDREN(parent)[i + 1] = right;
+            parent->n++;
+            return;
+        }
+
+        // KEYS + 1 개의 separator 중 가운데를 올리고 양쪽에 MIN_KEYS 개씩 남김
+        key_t keys[KEYS + 1];
+        btree_node_t *child[KEYS + 2];
+        memcpy(keys, parent->keys, i * sizeof(key_t));
+        keys[i] = sep;
+        memcpy(&keys[i + 1], &parent->keys[i], (KEYS - i) * sizeof(key_t));
+        memcpy(child, CHILDREN(parent), (i + 1) * sizeof(btree_node_t *));
+        child[i + 1] = right;
+        memcpy(&child[i + 2], &CHILDREN(parent)[i + 1], (KEYS - i) * sizeof(btree_node_t *));
+
+        btree_node_t *sibling = *spare++;
+        parent->n = MIN_KEYS;
+        memcpy(parent->keys, keys, MIN_KEYS * sizeof(key_t));
+        memcpy(CHILDREN(parent), child, (MIN_KEYS + 1) * sizeof(btree_node_t *));
+        sibling->n = KEYS - MIN_KEYS;
+        memcpy(sibling->keys, &keys[MIN_KEYS + 1], (KEYS - MIN_KEYS) * sizeof(key_t));
+        memcpy(CHILDREN(sibling), &child[MIN_KEYS + 1], (KEYS - MIN_KEYS + 1) * sizeof(btree_node_t *));
+        for (uint32_t j = 0; j <= parent->n; j++)
+        {
+            CHILDREN(parent)[j]->parent = parent;
+        }
+        for (uint32_t j = 0; j <= sibling->n; j++)
+        {
+            CHILDREN(sibling)[j]->parent = sibling;
+        }
+#ifdef RBTREE_ORDER_STAT
+        _recount(parent);
+        _recount(sibling);
+#endif
+        left = parent;
+        sep = keys[MIN_KEYS];
+        right = sibling;
+    }
+}
+
+static node_t *_insert(rbtree *t, const key_t key)
+{
+    if (t->root == NULL)
+    {
+        t->root = _new_leaf();
+        if (t->root == NULL)
+        {
+            return NULL;
+        }
+    }
+    btree_node_t *leaf = t->root;
+    while (!leaf->leaf)
+    {
+        leaf = CHILDREN(leaf)[_count_less_equal(leaf, key)];
+    }
+
+    // 가득 찬 leaf 와 그 위로 이어지는 가득 찬 inner node 마다 하나, 루트까지 가득 찼으면 새 루트 하나
+    btree_node_t *spare[MAX_LEVELS + 1];
+    size_t spares = 0;
+    bool ok = true;
+    if (leaf->n == KEYS)
+    {
+        spare[spares++] = _new_leaf();
+        ok = spare[0] != NULL;
+        for (btree_node_t *node = leaf->parent; ok; node = node->parent)
+        {
+            if (node != NULL && node->n < KEYS)
+            {
+                break;
+            }
+            spare[spares++] = _new_inner();
+            ok = spare[spares - 1] != NULL;
+            if (node == NULL)
+            {
+                break;
+            }
+        }
+    }
+    if (!ok)
+    {
+        for (size_t i = 0; i < spares; i++)
+        {
+            free(spare[i]);
+        }
+        return NULL;
+    }
+
+    t->size++;
+#ifdef RBTREE_ORDER_STAT
+    for (btree_node_t *node = leaf->parent; node != NULL; node = node->parent)
+    {
+        node->size++;
+    }
+#endif
+    uint32_t pos = _count_less_equal(leaf, key);
+    if (leaf->n < KEYS)
+    {
+        memmove(&leaf->keys[pos + 1], &leaf->keys[pos], (leaf->n - pos) * sizeof(key_t));
+        leaf->keys[pos] = key;
+        leaf->n++;
+        return SLOT(leaf, pos);
+    }
+
+    // 뒤쪽 절반을 새 leaf 로 옮기고 key 를 들어갈 쪽에 넣은 뒤 (ORDER_STAT 의 size 가 맞도록) parent 에 올림
+    btree_node_t *right = spare[0];
+    right->n = KEYS - MIN_KEYS;
+    memcpy(right->keys, &leaf->keys[MIN_KEYS], (KEYS - MIN_KEYS) * sizeof(key_t));
+    leaf->n = MIN_KEYS;
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next != NULL)
+    {
+        leaf->next->prev = right;
+    }
+    leaf->next = right;
+
+    btree_node_t *target = leaf;
+    if (pos > MIN_KEYS)
+    {
+        target = right;
+        pos -= MIN_KEYS;
+    }
+    memmove(&target->keys[pos + 1], &target->keys[pos], (target->n - pos) * sizeof(key_t));
+    target->keys[pos] = key;
+    target->n++;
+    _insert_parent(t, leaf, right->keys[0], right, &spare[1]);
+    return SLOT(target, pos);
+}
+
+node_t *rbtree_insert(rbtree *t, const key_t key)
+{
+    TRACE(RBTREE_TRACE_INSERT, key);
+    return _insert(t, key);
+}
+
+/*
+찾기
+separator 가 key 보다 작은 쪽으로 내려가면 도착한 leaf 의 key 는 모두 key 이하이거나 (그 뒤 leaf 부터 key 이상)
+leaf 안에 key 이상인 첫 칸이 있다. 그래서 leaf 끝에 닿으면 다음 leaf 의 첫 칸을 본다.
+*/
+static btree_node_t *_descend_less(const rbtree *t, const key_t key)
+{
+    btree_node_t *node = t->root;
+    while (!node->leaf)
+    {
+        node = CHILDREN(node)[_count_less(node, key)];
+    }
+    return node;
+}
+
+// leaf 의 pos 번째 칸, leaf 끝이면 다음 leaf 의 첫 칸 (없으면 NULL)
+static node_t *_slot_or_next(btree_node_t *leaf, const uint32_t pos)
+{
+    if (pos < leaf->n)
+    {
+        return SLOT(leaf, pos);
+    }
+    return leaf->next == NULL ? NULL : SLOT(leaf->next, 0);
+}
+
+// key 이상인 첫 node, 없으면 NULL
+node_t *rbtree_lower_bound(const rbtree *t, const key_t key)
+{
+    if (t->root == NULL)
+    {
+        return NULL;
+    }
+    btree_node_t *leaf = _descend_less(t, key);
+    return _slot_or_next(leaf, _count_less(leaf, key));
+}
+
+// key 보다 큰 첫 node, 없으면 NULL
+node_t *rbtree_upper_bound(const rbtree *t, const key_t key)
+{
+    if (t->root == NULL)
+    {
+        return NULL;
+    }
+    btree_node_t *node = t->root;
+    while (!node->leaf)
+    {
+        node = CHILDREN(node)[_count_less_equal(node, key)];
+    }
+    return _slot_or_next(node, _count_less_equal(node, key));
+}
+
+node_t *rbtree_find(const rbtree *t, const key_t key)
+{
+    TRACE(RBTREE_TRACE_FIND, key);
+    node_t *p = rbtree_lower_bound(t, key);
+    return p != NULL && p->key == key ? p : NULL;
+}
+
+/*
+batch find
+rbtree.c 와 같이 여러 key 를 번갈아 한 level 씩 내려가며 다음 node 의 separator 를 prefetch 한다.
+node 하나가 cache line 하나라 prefetch 도 한 번이다.
+*/
+#define BATCH_FIND_GROUP 16
+
+size_t rbtree_find_batch(const rbtree *t, const key_t *keys, const size_t n, node_t **out)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        TRACE(RBTREE_TRACE_FIND, keys[i]);
+    }
+    if (t->root == NULL)
+    {
+        memset(out, 0, n * sizeof(node_t *));
+        return 0;
+    }
+    btree_node_t *cur[BATCH_FIND_GROUP];
+    size_t slot[BATCH_FIND_GROUP];
+    size_t next = 0, active = 0, found = 0;
+
+    for (; active < BATCH_FIND_GROUP && next < n; active++, next++)
+    {
+        cur[active] = t->root;
+        slot[active] = next;
+    }
+    while (active > 0)
+    {
+        for (size_t g = 0; g < active;)
+        {
+            btree_node_t *node = cur[g];
+            const key_t key = keys[slot[g]];
+            if (!node->leaf)
+            {
+                node = CHILDREN(node)[_count_less(node, key)];
+                __builtin_prefetch(node);
+                cur[g++] = node;
+                continue;
+            }
+            node_t *p = _slot_or_next(node, _count_less(node, key));
+            p = p != NULL && p->key == key ? p : NULL;
+            out[slot[g]] = p;
+            found += p != NULL;
+            if (next < n)
+            {
+                cur[g] = t->root;
+                slot[g] = next++;
+            }
+            else
+            {
+                active--;
+                cur[g] = cur[active];
+                slot[g] = slot[active];
+            }
+        }
+    }
+    return found;
+}
+
+node_t *rbtree_min(const rbtree *t)
+{
+    if (t->root == NULL)
+    {
+        return NULL;
+    }
+    return SLOT(_leftmost_leaf(t->root), 0);
+}
+
+node_t *rbtree_max(const rbtree *t)
+{
+    if (t->root == NULL)
+    {
+        return NULL;
+    }
+    btree_node_t *leaf = _rightmost_leaf(t->root);
+    return SLOT(leaf, leaf->n - 1);
+}
+
+/*
+erase
+leaf 에서 key 를 빼고 앞으로 당긴다. leaf 가 MIN_KEYS 개보다 적어지면
+- 형제 (왼쪽, 맨 왼쪽이면 오른쪽) 와 합쳐 KEYS 개 이하면 합치고 parent 에서 separator 하나를 뺀다.
+  parent 가 모자라게 되면 같은 방식으로 올라간다.
+- 아니면 형제의 끝 key (child) 하나를 빌려 오고 사이 separator 를 고친다.
+루트는 모자라도 되지만 child 하나만 남은 inner 루트는 없애 tree 를 한 level 낮춘다.
+*/
+
+// parent 의 keys[i] 와 child[i + 1] 을 뺌
+static void _remove_child(btree_node_t *parent, const uint32_t i)
+{
+    memmove(&parent->keys[i], &parent->keys[i + 1], (parent->n - i - 1) * sizeof(key_t));
+    memmove(&CHILDREN(parent)[i + 1], &CHILDREN(parent)[i + 2], (parent->n - i - 1) * sizeof(btree_node_t *));
+    parent->n--;
+}
+
+static void _merge_leaves(btree_node_t *left, btree_node_t *right)
+{
+    memcpy(&left->keys[left->n], right->keys, right->n * sizeof(key_t));
+    left->n += right->n;
+    left->next = right->next;
+    if (right->next != NULL)
+    {
+        right->next->prev = left;
+    }
+}
+
+static void _merge_inners(btree_node_t *left, const key_t sep, btree_node_t *right)
+{
+    left->keys[left->n] = sep;
+    memcpy(&left->keys[left->n + 1], right->keys, right->n * sizeof(key_t));
+    memcpy(&CHILDREN(left)[left->n + 1], CHILDREN(right), (right->n + 1) * sizeof(btree_node_t *));
+    for (uint32_t j = 0; j <= right->n; j++)
+    {
+        CHILDREN(right)[j]->parent = left;
+    }
+    left->n += right->n + 1;
+#ifdef RBTREE_ORDER_STAT
+    left->size += right->size;
+#endif
+}
+
+// 왼쪽 형제의 마지막 key (child) 를 node 앞으로 옮김. sep 는 parent 에서 둘 사이의 separator
+static void _borrow_left(btree_node_t *left, btree_node_t *node, key_t *sep)
+{
+    if (node->leaf)
+    {
+        memmove(&node->keys[1], node->keys, node->n * sizeof(key_t));
+        node->keys[0] = left->keys[--left->n];
+        node->n++;
+        *sep = node->keys[0];
+        return;
+    }
+    btree_node_t *moved = CHILDREN(left)[left->n];
+    memmove(&node->keys[1], node->keys, node->n * sizeof(key_t));
+    memmove(&CHILDREN(node)[1], CHILDREN(node), (node->n + 1) * sizeof(btree_node_t *));
+    node->keys[0] = *sep;
+    CHILDREN(node)[0] = moved;
+    moved->parent = node;
+    *sep = left->keys[left->n - 1];
+    left->n--;
+    node->n++;
+#ifdef RBTREE_ORDER_STAT
+    left->size -= _size(moved);
+    node->size += _size(moved);
+#endif
+}
+
+// 오른쪽 형제의 첫 key (child) 를 node 끝으로 옮김
+static void _borrow_right(btree_node_t *node, btree_node_t *right, key_t *sep)
+{
+    if (node->leaf)
+    {
+        node->keys[node->n++] = right->keys[0];
+        memmove(right->keys, &right->keys[1], (right->n - 1) * sizeof(key_t));
+        right->n--;
+        *sep = right->keys[0];
+        return;
+    }
+    btree_node_t *moved = CHILDREN(right)[0];
+    node->keys[node->n] = *sep;
+    CHILDREN(node)[node->n + 1] = moved;
+    moved->parent = node;
+    node->n++;
+    *sep = right->keys[0];
+    memmove(right->keys, &right->keys[1], (right->n - 1) * sizeof(key_t));
+    memmove(CHILDREN(right), &CHILDREN(right)[1], right->n * sizeof(btree_node_t *));
+    right->n--;
+#ifdef RBTREE_ORDER_STAT
+    right->size -= _size(moved);
+    node->size += _size(moved);
+#endif
+}
+
+static void _rebalance(rbtree *t, btree_node_t *node)
+{
+    while (node->parent != NULL && node->n < MIN_KEYS)
+    {
+        btree_node_t *parent = node->parent;
+        const uint32_t i = _child_index(parent, node);
+        // parent->keys[sep] 가 left 와 right 사이
+        const uint32_t sep = i > 0 ? i - 1 : 0;
+        btree_node_t *left = CHILDREN(parent)[sep], *right = CHILDREN(parent)[sep + 1];
+
+        // inner 는 separator 하나가 내려오므로 합친 수가 하나 더 많음
+        if (left->n + right->n + !node->leaf <= KEYS)
+        {
+            if (node->leaf)
+            {
+                _merge_leaves(left, right);
+            }
+            else
+            {
+                _merge_inners(left, parent->keys[sep], right);
+            }
+            _remove_child(parent, sep);
+            free(right);
+            node = parent;
+            continue;
+        }
+        if (node == right)
+        {
+            _borrow_left(left, node, &parent->keys[sep]);
+        }
+        else
+        {
+            _borrow_right(node, right, &parent->keys[sep]);
+        }
+        return;
+    }
+
+    if (node->parent == NULL && node->n == 0)
+    {
+        // 빈 leaf 루트는 없애고, child 하나만 남은 inner 루트는 그 child 로 바꿈
+        t->root = node->leaf ? NULL : CHILDREN(node)[0];
+        if (t->root != NULL)
+        {
+            t->root->parent = NULL;
+        }
+        free(node);
+    }
+}
+
+static void _erase(rbtree *t, node_t *p)
+{
+    btree_node_t *leaf = LEAF_OF(p);
+    const uint32_t i = SLOT_INDEX(leaf, p);
+    memmove(&leaf->keys[i], &leaf->keys[i + 1], (leaf->n - i - 1) * sizeof(key_t));
+    leaf->n--;
+    t->size--;
+#ifdef RBTREE_ORDER_STAT
+    for (btree_node_t *up = leaf->parent; up != NULL; up = up->parent)
+    {
+        up->size--;
+    }
+#endif
+    _rebalance(t, leaf);
+}
+
+int rbtree_erase(rbtree *t, node_t *p)
+{
+    TRACE(RBTREE_TRACE_ERASE, p->key);
+    _erase(t, p);
+    return 0;
+}
+
+// leaf 안에서는 옆 칸, 끝이면 이웃 leaf 로 넘어감 (leaf 는 비어 있지 않음)
+node_t *rbtree_next(const rbtree *t, node_t *p)
+{
+    btree_node_t *leaf = LEAF_OF(p);
+    return _slot_or_next(leaf, SLOT_INDEX(leaf, p) + 1);
+}
+
+node_t *rbtree_prev(const rbtree *t, node_t *p)
+{
+    btree_node_t *leaf = LEAF_OF(p);
+    const uint32_t i = SLOT_INDEX(leaf, p);
+    if (i > 0)
+    {
+        return SLOT(leaf, i - 1);
+    }
+    return leaf->prev == NULL ? NULL : SLOT(leaf->prev, leaf->prev->n - 1);
+}
+
+rbtree_cursor rbtree_cursor_first(const rbtree *t)
+{
+    rbtree_cursor c = {.tree = t, .node = rbtree_min(t)};
+    return c;
+}
+
+rbtree_cursor rbtree_cursor_last(const rbtree *t)
+{
+    rbtree_cursor c = {.tree = t, .node = rbtree_max(t)};
+    return c;
+}
+
+node_t *rbtree_cursor_next(rbtree_cursor *c)
+{
+    if (c->node != NULL)
+    {
+        c->node = rbtree_next(c->tree, c->node);
+    }
+    return c->node;
+}
+
+node_t *rbtree_cursor_prev(rbtree_cursor *c)
+{
+    c->node = c->node == NULL ? rbtree_max(c->tree) : rbtree_prev(c->tree, c->node);
+    return c->node;
+}
+
+// leaf 단위로 memcpy 해 가며 읽음
+size_t rbtree_cursor_read(rbtree_cursor *c, key_t *out, const size_t cap)
+{
+    if (c->node == NULL)
+    {
+        return 0;
+    }
+    btree_node_t *leaf = LEAF_OF(c->node);
+    uint32_t i = SLOT_INDEX(leaf, c->node);
+    size_t count = 0;
+    while (leaf != NULL && count < cap)
+    {
+        const size_t left = leaf->n - i;
+        const size_t take = left < cap - count ? left : cap - count;
+        memcpy(&out[count], &leaf->keys[i], take * sizeof(key_t));
+        count += take;
+        i += (uint32_t)take;
+        if (i == leaf->n)
+        {
+            leaf = leaf->next;
+            i = 0;
+        }
+    }
+    c->node = leaf == NULL ? NULL : SLOT(leaf, i);
+    return count;
+}
+
+int rbtree_export(const rbtree *t, key_t *buf, const size_t cap, rbtree_export_fn fn, void *arg)
+{
+    rbtree_cursor c = rbtree_cursor_first(t);
+    size_t count;
+    while ((count = rbtree_cursor_read(&c, buf, cap)) > 0)
+    {
+        const int res = fn(buf, count, arg);
+        if (res != 0)
+        {
+            return res;
+        }
+    }
+    return 0;
+}
+
+int rbtree_to_array(const rbtree *t, key_t *arr, const size_t n)
+{
+    rbtree_cursor c = rbtree_cursor_first(t);
+    return rbtree_cursor_read(&c, arr, n) != n;
+}
+
+/*
+bulk load
+정렬된 arr 을 leaf 에 고르게 나눠 담고 (leaf 가 둘 이상이면 모두 MIN_KEYS 개 이상)
+각 level 의 node 를 다시 KEYS + 1 개씩 고르게 묶어 위 level 을 만든다.
+separator 는 오른쪽 child 아래의 가장 작은 key 이다.
+메모리가 모자라면 만든 node 를 모두 해제하고 false (*root 는 그대로)
+*/
+static bool _bulk_load(const key_t *arr, const size_t n, btree_node_t **root)
+{
+    if (n == 0)
+    {
+        *root = NULL;
+        return true;
+    }
+    size_t count = (n + KEYS - 1) / KEYS;
+    btree_node_t **level = malloc(count * sizeof(btree_node_t *));
+    key_t *mins = malloc(count * sizeof(key_t));
+    bool ok = level != NULL && mins != NULL;
+    btree_node_t *prev = NULL;
+    size_t from = 0, built = 0;
+    for (size_t j = 0; ok && j < count; j++)
+    {
+        const size_t take = (n - from) / (count - j);
+        btree_node_t *leaf = _new_leaf();
+        if (leaf == NULL)
+        {
+            ok = false;
+            break;
+        }
+        memcpy(leaf->keys, &arr[from], take * sizeof(key_t));
+        leaf->n = (uint32_t)take;
+        leaf->prev = prev;
+        if (prev != NULL)
+        {
+            prev->next = leaf;
+        }
+        prev = leaf;
+        level[j] = leaf;
+        mins[j] = arr[from];
+        from += take;
+        built = j + 1;
+    }
+    if (!ok)
+    {
+        for (size_t j = 0; j < built; j++)
+        {
+            free(level[j]);
+        }
+        free(mins);
+        free(level);
+        return false;
+    }
+
+    // level[j] 는 level[from, from + take) 를 다 읽은 뒤에 덮어쓰므로 (from >= j) 제자리에서 올라감
+    while (count > 1)
+    {
+        const size_t parents = (count + KEYS) / (KEYS + 1);
+        from = 0;
+        for (size_t j = 0; j < parents; j++)
+        {
+            const size_t take = (count - from) / (parents - j);
+            btree_node_t *node = _new_inner();
+            if (node == NULL)
+            {
+                // 이 level 의 level[0, j) 는 아래 level[0, from) 을 물고 있고 level[from, count) 는 아직 부모가 없음
+                for (size_t k = 0; k < j; k++)
+                {
+                    _free_subtree(level[k]);
+                }
+                for (size_t k = from; k < count; k++)
+                {
+                    _free_subtree(level[k]);
+                }
+                free(mins);
+                free(level);
+                return false;
+            }
+            for (size_t c = 0; c < take; c++)
+            {
+                CHILDREN(node)[c] = level[from + c];
+                CHILDREN(node)[c]->parent = node;
+                if (c > 0)
+                {
+                    node->keys[c - 1] = mins[from + c];
+                }
+            }
+            node->n = (uint32_t)(take - 1);
+#ifdef RBTREE_ORDER_STAT
+            _recount(node);
+#endif
+            mins[j] = mins[from];
+            level[j] = node;
+            from += take;
+        }
+        count = parents;
+    }
+    *root = level[0];
+    free(mins);
+    free(level);
+    return true;
+}
+
+rbtree *rbtree_from_sorted_array(const key_t *arr, const size_t n)
+{
+    rbtree *t = new_rbtree();
+    if (t == NULL)
+    {
+        return NULL;
+    }
+    if (!_bulk_load(arr, n, &t->root))
+    {
+        free(t);
+        return NULL;
+    }
+    t->size = n;
+    return t;
+}
+
+// tree 의 key 를 모두 순서대로 담은 배열 (n + 1 칸, free 로 해제)
+static key_t *_keys(const rbtree *t)
+{
+    key_t *keys = malloc((t->size + 1) * sizeof(key_t));
+    if (keys != NULL)
+    {
+        rbtree_to_array(t, keys, t->size);
+    }
+    return keys;
+}
+
+static int _comp_key(const void *p1, const void *p2)
+{
+    const key_t e1 = *(const key_t *)p1;
+    const key_t e2 = *(const key_t *)p2;
+    return (e1 > e2) - (e1 < e2);
+}
+
+/*
+freeze
+node 가 연속된 key 를 이미 묶고 있으므로 van Emde Boas 배치 대신 leaf 를 가득 채워 다시 만든다.
+erase 로 반쯤 빈 leaf 가 줄어 leaf 수가 최소 (ceil(n / KEYS)) 가 되고 높이도 그만큼 낮아진다.
+*/
+int rbtree_freeze(rbtree *t)
+{
+    key_t *keys = _keys(t);
+    btree_node_t *root;
+    // 새로 다 만든 뒤에 옛 node 를 해제 (모자라면 그대로 둠)
+    const bool ok = keys != NULL && _bulk_load(keys, t->size, &root);
+    free(keys);
+    if (!ok)
+    {
+        return -1;
+    }
+    _free_subtree(t->root);
+    t->root = root;
+    return 0;
+}
+
+/*
+batch insert
+tree 보다 큰 batch 는 rbtree.c 와 같이 기존 key 와 병합해 bulk load 로 다시 만들고,
+작은 batch 는 정렬한 순서대로 넣어 루트부터의 경로가 cache 에 남아 있게 한다.
+*/
+int rbtree_insert_batch(rbtree *t, const key_t *keys, const size_t n)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    // buffer 를 잡지 못하면 tree 는 그대로
+    key_t *sorted = malloc(n * sizeof(key_t));
+    if (sorted == NULL)
+    {
+        return -1;
+    }
+    memcpy(sorted, keys, n * sizeof(key_t));
+    qsort(sorted, n, sizeof(key_t), _comp_key);
+
+    if (n < t->size)
+    {
+        size_t i = 0;
+        while (i < n && _insert(t, sorted[i]) != NULL)
+        {
+            i++;
+        }
+        free(sorted);
+        return i == n ? 0 : -1;
+    }
+
+    key_t *old = _keys(t);
+    key_t *merged = malloc((t->size + n) * sizeof(key_t));
+    if (old == NULL || merged == NULL)
+    {
+        free(merged);
+        free(old);
+        free(sorted);
+        return -1;
+    }
+    size_t i = 0, j = 0, count = 0;
+    while (i < t->size || j < n)
+    {
+        // 같은 key 는 기존 것이 앞 (하나씩 넣은 것과 같은 순서)
+        merged[count++] = j == n || (i < t->size && old[i] <= sorted[j]) ? old[i++] : sorted[j++];
+    }
+    btree_node_t *root;
+    const bool ok = _bulk_load(merged, count, &root);
+    if (ok)
+    {
+        _free_subtree(t->root);
+        t->root = root;
+        t->size = count;
+    }
+    free(merged);
+    free(old);
+    free(sorted);
+    return ok ? 0 : -1;
+}
+
+/*
+범위 erase
+rbtree.c 처럼 두 번 잘라 가운데를 통째로 떼어 내는 대신 key 하나씩 지운다. (O(log n + k log n))
+먼저 leaf 를 따라가며 범위의 key 수 k 를 세고, k 가 tree 의 절반 이상이면 남는 key 로 bulk load 해
+O(n) = O(k) 에 끝낸다. 새 tree 를 만들 메모리가 없으면 하나씩 지우는 쪽으로 돌아간다. (erase 는 할당하지 않음)
+*/
+size_t rbtree_erase_range(rbtree *t, const key_t lo, const key_t hi)
+{
+    if (lo >= hi)
+    {
+        return 0;
+    }
+    node_t *first = rbtree_lower_bound(t, lo);
+    if (first == NULL)
+    {
+        return 0;
+    }
+    size_t count = 0;
+    btree_node_t *leaf = LEAF_OF(first);
+    for (uint32_t i = SLOT_INDEX(leaf, first); leaf != NULL && leaf->keys[i] < hi;)
+    {
+        count++;
+        if (++i == leaf->n)
+        {
+            leaf = leaf->next;
+            i = 0;
+        }
+    }
+
+    key_t *keys = 2 * count >= t->size ? _keys(t) : NULL;
+    if (keys != NULL)
+    {
+        // 범위는 정렬된 keys 안에서 [from, from + count) 한 덩어리
+        size_t from = 0;
+        while (keys[from] < lo)
+        {
+            from++;
+        }
+        memmove(&keys[from], &keys[from + count], (t->size - from - count) * sizeof(key_t));
+        btree_node_t *root;
+        if (_bulk_load(keys, t->size - count, &root))
+        {
+            _free_subtree(t->root);
+            t->root = root;
+            t->size -= count;
+            free(keys);
+            return count;
+        }
+        free(keys);
+    }
+    // 앞쪽 key 가 몰려 있는 leaf 부터 지우므로 지울 때마다 찾기만 O(log n)
+    for (size_t i = 0; i < count; i++)
+    {
+        _erase(t, rbtree_lower_bound(t, lo));
+    }
+    return count;
+}
+
+/*
+split / join
+B+ tree 를 경로를 따라 자르려면 경로 위 모든 node 를 나눠 다시 채워야 한다.
+여기서는 rbtree_index.c 와 같이 작은 쪽만 옮긴다. 작은 쪽 key 를 복사해 bulk load 로 새 tree 를 만들고
+t 에서는 그만큼을 끝에서부터 지운다. (O(작은 쪽 * log n))
+join 은 작은 tree 의 key 와 pivot 을 큰 tree 에 넣는다.
+*/
+#ifdef RBTREE_ORDER_STAT
+// key 보다 작은 key 의 수 : 내려가며 왼쪽 child 들의 크기를 더함
+static size_t _rank(const rbtree *t, const key_t key)
+{
+    size_t rank = 0;
+    const btree_node_t *node = t->root;
+    if (node == NULL)
+    {
+        return 0;
+    }
+    while (!node->leaf)
+    {
+        const uint32_t i = _count_less(node, key);
+        for (uint32_t j = 0; j < i; j++)
+        {
+            rank += _size(CHILDREN(node)[j]);
+        }
+        node = CHILDREN(node)[i];
+    }
+    return rank + _count_less(node, key);
+}
+#endif
+
+static size_t _left_size(const rbtree *t, const key_t key)
+{
+#ifdef RBTREE_ORDER_STAT
+    return _rank(t, key);
+#else
+    node_t *first = rbtree_lower_bound(t, key);
+    if (first == NULL)
+    {
+        return t->size;
+    }
+    // 앞쪽 (cut 앞의 leaf) 과 뒤쪽 (cut 뒤의 leaf) 을 leaf 단위로 번갈아 세고 먼저 끝난 쪽으로 정함
+    btree_node_t *cut = LEAF_OF(first);
+    size_t before = SLOT_INDEX(cut, first), after = cut->n - before;
+    btree_node_t *a = _leftmost_leaf(t->root), *b = cut->next;
+    while (a != cut && b != NULL)
+    {
+        before += a->n;
+        a = a->next;
+        after += b->n;
+        b = b->next;
+    }
+    return a == cut ? before : t->size - after;
+#endif
+}
+
+void rbtree_split(rbtree *t, const key_t key, rbtree **left, rbtree **right)
+{
+    const size_t leftSize = _left_size(t, key);
+    const bool moveLeft = leftSize < t->size - leftSize;
+    const size_t n = moveLeft ? leftSize : t->size - leftSize;
+    key_t *keys = malloc((n + 1) * sizeof(key_t));
+    if (keys == NULL)
+    {
+        *left = *right = NULL;
+        return;
+    }
+    rbtree_cursor c = {t, moveLeft ? rbtree_min(t) : rbtree_lower_bound(t, key)};
+    rbtree_cursor_read(&c, keys, n);
+    rbtree *copy = rbtree_from_sorted_array(keys, n);
+    free(keys);
+    // 옮길 쪽을 다 만든 뒤에만 t 에서 지우므로 모자라면 t 는 그대로
+    if (copy == NULL)
+    {
+        *left = *right = NULL;
+        return;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        _erase(t, moveLeft ? rbtree_min(t) : rbtree_max(t));
+    }
+    *left = moveLeft ? copy : t;
+    *right = moveLeft ? t : copy;
+}
+
+rbtree *rbtree_join(rbtree *left, const key_t pivot, rbtree *right)
+{
+    const node_t *max = rbtree_max(left), *min = rbtree_min(right);
+    if ((max != NULL && max->key > pivot) || (min != NULL && min->key < pivot))
+    {
+        return NULL;
+    }
+    rbtree *t = left, *other = right;
+    if (left->size < right->size)
+    {
+        t = right;
+        other = left;
+    }
+    key_t *keys = _keys(other);
+    if (keys == NULL)
+    {
+        return NULL;
+    }
+    // pivot 을 keys 끝에 두고 모두 넣음. 중간에 모자라면 넣은 만큼 다시 지워 두 tree 를 그대로 둔다.
+    // (같은 key 의 node 는 서로 구별되지 않으므로 어느 것을 지워도 됨)
+    keys[other->size] = pivot;
+    size_t inserted = 0;
+    while (inserted <= other->size && _insert(t, keys[inserted]) != NULL)
+    {
+        inserted++;
+    }
+    if (inserted <= other->size)
+    {
+        while (inserted > 0)
+        {
+            _erase(t, rbtree_find(t, keys[--inserted]));
+        }
+        free(keys);
+        return NULL;
+    }
+    free(keys);
+    delete_rbtree(other);
+    return t;
+}
+
+/*
+집합 연산 (union / intersection / difference)
+rbtree_index.c 와 같이 두 tree 의 key 를 순서대로 꺼내 한 번 병합하고 (같은 key 는 하나만) bulk load 한다.
+O(n + m) 이며 thread 로 나누지 않는다.
+*/
+static rbtree *_set_operation(const rbtree *a, const rbtree *b, bool aOnly, bool bOnly, bool both)
+{
+    key_t *ka = _keys(a);
+    key_t *kb = _keys(b);
+    key_t *out = malloc((a->size + b->size + 1) * sizeof(key_t));
+    if (ka == NULL || kb == NULL || out == NULL)
+    {
+        free(out);
+        free(kb);
+        free(ka);
+        return NULL;
+    }
+    size_t i = 0, j = 0, count = 0;
+    while (i < a->size || j < b->size)
+    {
+        key_t key;
+        bool keep;
+        if (j == b->size || (i < a->size && ka[i] < kb[j]))
+        {
+            key = ka[i];
+            keep = aOnly;
+        }
+        else if (i == a->size || kb[j] < ka[i])
+        {
+            key = kb[j];
+            keep = bOnly;
+        }
+        else
+        {
+            key = ka[i];
+            keep = both;
+        }
+        // 양쪽에서 이 key 를 모두 건너뜀 (중복 포함)
+        while (i < a->size && ka[i] == key)
+        {
+            i++;
+        }
+        while (j < b->size && kb[j] == key)
+        {
+            j++;
+        }
+        if (keep)
+        {
+            out[count++] = key;
+        }
+    }
+    rbtree *t = rbtree_from_sorted_array(out, count);
+    free(out);
+    free(kb);
+    free(ka);
+    return t;
+}
+
+rbtree *rbtree_union(const rbtree *a, const rbtree *b)
+{
+    return _set_operation(a, b, true, true, true);
+}
+
+rbtree *rbtree_intersection(const rbtree *a, const rbtree *b)
+{
+    return _set_operation(a, b, false, false, true);
+}
+
+rbtree *rbtree_difference(const rbtree *a, const rbtree *b)
+{
+    return _set_operation(a, b, true, false, false);
+}
+
+size_t rbtree_range_to_array(const rbtree *t, const key_t lo, const key_t hi, key_t *out, const size_t cap)
+{
+    if (cap == 0 || lo >= hi)
+    {
+        return 0;
+    }
+    node_t *first = rbtree_lower_bound(t, lo);
+    if (first == NULL)
+    {
+        return 0;
+    }
+    btree_node_t *leaf = LEAF_OF(first);
+    uint32_t i = SLOT_INDEX(leaf, first);
+    size_t count = 0;
+    while (leaf != NULL && count < cap && leaf->keys[i] < hi)
+    {
+        out[count++] = leaf->keys[i];
+        if (++i == leaf->n)
+        {
+            leaf = leaf->next;
+            i = 0;
+        }
+    }
+    return count;
+}
+
+size_t rbtree_size(const rbtree *t)
+{
+    return t->size;
+}
+
+/*
+구조 값
+key 는 모두 같은 깊이의 leaf 에 있으므로 height 는 level 수, avg_depth 는 height - 1 이다.
+모든 루트-leaf 경로의 길이가 같다는 점이 black height 와 같은 뜻이라 black_height 에도 level 수를 적는다.
+연산 counter (-DRBTREE_STATS) 는 pointer engine 에만 있으므로 ops 는 0
+*/
+void rbtree_stats(const rbtree *t, rbtree_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->nodes = t->size;
+    for (const btree_node_t *node = t->root; node != NULL; node = node->leaf ? NULL : CHILDREN(node)[0])
+    {
+        out->height++;
+    }
+    out->black_height = out->height;
+    out->avg_depth = out->height > 0 ? out->height - 1 : 0;
+}
+
+#ifdef RBTREE_ORDER_STAT
+node_t *rbtree_select(const rbtree *t, size_t k)
+{
+    if (k >= t->size)
+    {
+        return NULL;
+    }
+    btree_node_t *node = t->root;
+    while (!node->leaf)
+    {
+        uint32_t i = 0;
+        while (k >= _size(CHILDREN(node)[i]))
+        {
+            k -= _size(CHILDREN(node)[i]);
+            i++;
+        }
+        node = CHILDREN(node)[i];
+    }
+    return SLOT(node, k);
+}
+
+size_t rbtree_rank(const rbtree *t, const key_t key)
+{
+    return _rank(t, key);
+}
+#endif
@@ -0,0 +1,228 @@
+#include "rbtree_concurrent.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*
+읽기 경로 (seqlock)
+writer 는 tree 를 고치기 전후로 seq 를 하나씩 올린다. reader 는 seq 를 읽고, lock 없이 tree 를 따라
+내려간 뒤, seq 가 그대로이고 짝수였을 때만 결과를 믿는다. 아니면 다시 읽는다.
+
+writer 와 겹친 reader 는 회전 중인 포인터를 따라갈 수 있으므로 아래를 전제로 한다.
+- node 메모리는 tree 가 살아 있는 동안 해제되지 않는다. (node pool : erase 된 node 는 free_list 로,
+  slab 은 delete_rbtree 에서만 해제되고, 새 slab 은 0 으로 채워 둔다)
+  그래서 읽는 포인터는 항상 이 tree 의 node, nil, 아니면 free_list 끝의 NULL 이다.
+- 꼬인 포인터로 순환할 수 있으므로 내려가는 횟수를 MAX_STEPS 로 자른다.
+  (2^64 개 node 의 red-black tree 도 높이는 128 을 넘지 않는다)
+위 조건이 맞지 않는 빌드 (node 마다 malloc 하는 RBTREE_NO_POOL, 배열을 realloc 하는 RBTREE_INDEX,
+포인터가 정렬되지 않아 찢어져 읽힐 수 있는 RBTREE_COMPACT, 합쳐진 node 를 해제하는 RBTREE_BTREE) 와
+-DRBTREE_CONCURRENT_LOCKED 로 빌드하면 reader 도 항상 read lock 을 잡는다.
+*/
+#if !defined(RBTREE_NO_POOL) && !defined(RBTREE_INDEX) && !defined(RBTREE_COMPACT) && !defined(RBTREE_BTREE) && \
+    !defined(RBTREE_CONCURRENT_LOCKED)
+#define OPTIMISTIC_READ
+#endif
+
+#define OPTIMISTIC_TRIES 4
+#define MAX_STEPS 128
+
+#ifdef OPTIMISTIC_READ
+// writer 가 동시에 쓰는 필드는 이걸로만 읽음 (컴파일러가 합치거나 다시 읽지 않도록)
+#define LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+// 낙관적 읽기 결과
+#define READ_RETRY -1
+#endif
+
+concurrent_rbtree *new_concurrent_rbtree(void)
+{
+    concurrent_rbtree *ct = (concurrent_rbtree *)calloc(1, sizeof(concurrent_rbtree));
+    ct->tree = new_rbtree();
+    pthread_rwlock_init(&ct->lock, NULL);
+    return ct;
+}
+
+void delete_concurrent_rbtree(concurrent_rbtree *ct)
+{
+    pthread_rwlock_destroy(&ct->lock);
+    delete_rbtree(ct->tree);
+    free(ct);
+}
+
+/*
+writer
+lock 을 잡은 뒤 seq 를 홀수로 → tree 수정 → 짝수로 되돌림.
+release fence 로 seq 를 홀수로 만든 store 가 tree 수정보다 먼저 보이게 한다.
+*/
+static void _write_begin(concurrent_rbtree *ct)
+{
+    __atomic_store_n(&ct->seq, ct->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void _write_end(concurrent_rbtree *ct)
+{
+    __atomic_store_n(&ct->seq, ct->seq + 1, __ATOMIC_RELEASE);
+}
+
+// 넣으면 0, node 를 할당하지 못하면 -1 (tree 는 그대로)
+int concurrent_rbtree_insert(concurrent_rbtree *ct, const key_t key)
+{
+    pthread_rwlock_wrlock(&ct->lock);
+    _write_begin(ct);
+    const node_t *p = rbtree_insert(ct->tree, key);
+    _write_end(ct);
+    pthread_rwlock_unlock(&ct->lock);
+    return p != NULL ? 0 : -1;
+}
+
+// key 하나를 지우면 0, 없으면 -1
+int concurrent_rbtree_erase(concurrent_rbtree *ct, const key_t key)
+{
+    pthread_rwlock_wrlock(&ct->lock);
+    // 다른 writer 는 막혀 있으니 찾는 동안은 reader 를 방해할 필요가 없음
+    node_t *p = rbtree_find(ct->tree, key);
+    if (p != NULL)
+    {
+        _write_begin(ct);
+        rbtree_erase(ct->tree, p);
+        _write_end(ct);
+    }
+    pthread_rwlock_unlock(&ct->lock);
+    return p != NULL ? 0 : -1;
+}
+
+#ifdef OPTIMISTIC_READ
+static unsigned long _read_begin(const concurrent_rbtree *ct)
+{
+    return __atomic_load_n(&ct->seq, __ATOMIC_ACQUIRE);
+}
+
+// 읽는 동안 writer 가 끼어들었으면 true
+static bool _read_retry(const concurrent_rbtree *ct, unsigned long seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (seq & 1) || __atomic_load_n(&ct->seq, __ATOMIC_RELAXED) != seq;
+}
+
+// 1 : 있음, 0 : 없음, READ_RETRY : writer 와 겹침
+static int _find_optimistic(concurrent_rbtree *ct, const key_t key)
+{
+    const rbtree *t = ct->tree;
+    const unsigned long seq = _read_begin(ct);
+    if (seq & 1)
+    {
+        return READ_RETRY;
+    }
+    int found = 0;
+    node_t *const nil = t->nil;
+    node_t *cur = LOAD(t->root);
+    for (int steps = 0; cur != nil; steps++)
+    {
+        if (cur == NULL || steps == MAX_STEPS)
+        {
+            return READ_RETRY;
+        }
+        const key_t curKey = LOAD(cur->key);
+        if (curKey == key)
+        {
+            found = 1;
+            break;
+        }
+        // 두 자식을 다 읽어 두고 고름 : 분기 대신 cmov 가 되어 예측 실패가 없음 (같은 cache line)
+        node_t *left = LOAD(cur->left), *right = LOAD(cur->right);
+        cur = key < curKey ? left : right;
+    }
+    return _read_retry(ct, seq) ? READ_RETRY : found;
+}
+
+// 한쪽 끝 (isRight 면 max) 의 key. 0 : 있음, -1 : 비어 있음, READ_RETRY : writer 와 겹침
+static int _edge_optimistic(concurrent_rbtree *ct, bool isRight, key_t *out)
+{
+    const rbtree *t = ct->tree;
+    const unsigned long seq = _read_begin(ct);
+    if (seq & 1)
+    {
+        return READ_RETRY;
+    }
+    node_t *cur = LOAD(t->root);
+    if (cur == NULL)
+    {
+        return READ_RETRY;
+    }
+    if (cur == t->nil)
+    {
+        return _read_retry(ct, seq) ? READ_RETRY : -1;
+    }
+    for (int steps = 0;; steps++)
+    {
+        node_t *next = isRight ? LOAD(cur->right) : LOAD(cur->left);
+        if (next == NULL || steps == MAX_STEPS)
+        {
+            return READ_RETRY;
+        }
+        if (next == t->nil)
+        {
+            break;
+        }
+        cur = next;
+    }
+    const key_t key = LOAD(cur->key);
+    if (_read_retry(ct, seq))
+    {
+        return READ_RETRY;
+    }
+    *out = key;
+    return 0;
+}
+#endif
+
+int concurrent_rbtree_find(concurrent_rbtree *ct, const key_t key)
+{
+#ifdef OPTIMISTIC_READ
+    for (int i = 0; i < OPTIMISTIC_TRIES; i++)
+    {
+        const int found = _find_optimistic(ct, key);
+        if (found != READ_RETRY)
+        {
+            return found;
+        }
+    }
+#endif
+    // writer 가 계속 겹치면 read lock 을 잡고 읽음
+    pthread_rwlock_rdlock(&ct->lock);
+    const int found = rbtree_find(ct->tree, key) != NULL;
+    pthread_rwlock_unlock(&ct->lock);
+    return found;
+}
+
+static int _edge(concurrent_rbtree *ct, bool isRight, key_t *out)
+{
+#ifdef OPTIMISTIC_READ
+    for (int i = 0; i < OPTIMISTIC_TRIES; i++)
+    {
+        const int res = _edge_optimistic(ct, isRight, out);
+        if (res != READ_RETRY)
+        {
+            return res;
+        }
+    }
+#endif
+    pthread_rwlock_rdlock(&ct->lock);
+    const node_t *p = isRight ? rbtree_max(ct->tree) : rbtree_min(ct->tree);
+    if (p != NULL)
+    {
+        *out = p->key;
+    }
+    pthread_rwlock_unlock(&ct->lock);
+    return p != NULL ? 0 : -1;
+}
+
+int concurrent_rbtree_min(concurrent_rbtree *ct, key_t *out)
+{
+    return _edge(ct, false, out);
+}
+
+int concurrent_rbtree_max(concurrent_rbtree *ct, key_t *out)
+{
+    return _edge(ct, true, out);
+}
@@ -0,0 +1,32 @@
+#ifndef _RBTREE_CONCURRENT_H_
+#define _RBTREE_CONCURRENT_H_
+
+#include <pthread.h>
+
+#include "rbtree.h"
+
+// 여러 thread 가 같이 쓰는 rbtree (src/rbtree_concurrent.c)
+// writer 는 lock 으로 한 번에 하나씩, reader 는 seqlock 으로 lock 없이 읽고
+// 도중에 writer 와 겹쳤으면 다시 읽는다. 몇 번 실패하면 read lock 을 잡는다.
+// node 가 언제든 erase / 재사용될 수 있으므로 node_t * 대신 key 로 주고받는다.
+typedef struct {
+  rbtree *tree;
+  pthread_rwlock_t lock;  // writer 끼리, 그리고 fallback reader 와의 직렬화
+  unsigned long seq;      // 홀수면 writer 가 tree 를 고치는 중
+} concurrent_rbtree;
+
+concurrent_rbtree *new_concurrent_rbtree(void);
+void delete_concurrent_rbtree(concurrent_rbtree *);
+
+// 넣으면 0, node 를 할당하지 못하면 -1 (tree 는 그대로)
+int concurrent_rbtree_insert(concurrent_rbtree *, const key_t);
+// key 하나를 지우면 0, 없으면 -1
+int concurrent_rbtree_erase(concurrent_rbtree *, const key_t);
+
+// 있으면 1, 없으면 0
+int concurrent_rbtree_find(concurrent_rbtree *, const key_t);
+// 비어 있지 않으면 *out 에 담고 0, 비어 있으면 -1
+int concurrent_rbtree_min(concurrent_rbtree *, key_t *out);
+int concurrent_rbtree_max(concurrent_rbtree *, key_t *out);
+
+#endif  // _RBTREE_CONCURRENT_H_
@@ -0,0 +1,551 @@
+/*
+key / value 타입을 고를 수 있는 red-black tree (macro 로 타입마다 찍어내는 header)
+
+    #define RBT_NAME imap                    // 이름 접두사 : imap_tree, imap_node, imap_insert ...
+    #define RBT_KEY int64_t
+    #define RBT_VALUE const char *           // 생략하면 void *
+    #define RBT_LESS(a, b) ((a) < (b))       // 생략하면 <
+    #define RBT_EQ(a, b) ((a) == (b))        // 생략하면 <, == (RBT_LESS 만 주면 양쪽 RBT_LESS 로)
+    #include "rbtree_generic.h"
+
+strcmp 처럼 음수 / 0 / 양수를 돌려주는 비교가 이미 있으면 RBT_LESS / RBT_EQ 대신
+RBT_CMP(a, b) 하나를 정의한다. 그러면 한 단계에 비교를 한 번만 부른다.
+정수 key 는 RBT_LESS / RBT_EQ 쪽이 빠르다 : 세 갈래 값을 만들었다가 다시 비교하지 않고
+(key 읽기 → 비교 → cmov) 로 바로 내려가므로 rbtree.c 와 같은 코드가 나온다.
+모두 macro 라 비교가 그대로 inline 된다. a, b 는 항상 lvalue 이므로
+&(a) 를 넘겨 함수 (함수 포인터 등) 를 불러도 된다.
+
+include 가 끝나면 RBT_* 설정은 #undef 되므로 다른 타입으로 몇 번이고 다시 include 할 수 있다.
+
+rbtree.h 와 같은 규칙을 따른다 : 중복 key 허용 (insert), tree 마다 sentinel 과 node pool.
+찾아서 있으면 value 만 바꾸는 put 도 있다.
+*/
+#ifndef _RBTREE_GENERIC_H_
+#define _RBTREE_GENERIC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "rbtree.h"
+
+#define RBT_CAT_(a, b) a##b
+#define RBT_CAT(a, b) RBT_CAT_(a, b)
+#define RBT_FN(x) RBT_CAT(RBT_NAME, RBT_CAT(_, x))
+
+#define RBT_MIN_SLAB 32
+#define RBT_MAX_SLAB 4096
+#endif  // _RBTREE_GENERIC_H_
+
+#ifndef RBT_NAME
+#error "RBT_NAME 을 정의한 뒤 include 해야 한다"
+#endif
+#ifndef RBT_KEY
+#error "RBT_KEY 를 정의한 뒤 include 해야 한다"
+#endif
+#ifndef RBT_VALUE
+#define RBT_VALUE void *
+#endif
+#ifdef RBT_CMP
+#define RBT_LT(a, b) (RBT_CMP(a, b) < 0)
+#else
+#ifndef RBT_LESS
+#define RBT_LESS(a, b) ((a) < (b))
+#ifndef RBT_EQ
+#define RBT_EQ(a, b) ((a) == (b))
+#endif
+#endif
+#ifndef RBT_EQ
+#define RBT_EQ(a, b) (!RBT_LESS(a, b) && !RBT_LESS(b, a))
+#endif
+#define RBT_LT(a, b) RBT_LESS(a, b)
+#endif
+
+#define RBT_NODE RBT_FN(node)
+#define RBT_SLAB RBT_FN(slab)
+#define RBT_TREE RBT_FN(tree)
+
+typedef struct RBT_NODE
+{
+    color_t color;
+    struct RBT_NODE *parent, *left, *right;
+    RBT_KEY key;
+    RBT_VALUE value;
+} RBT_NODE;
+
+typedef struct RBT_SLAB
+{
+    struct RBT_SLAB *next;
+    size_t cap;
+    RBT_NODE nodes[];
+} RBT_SLAB;
+
+typedef struct
+{
+    RBT_NODE *root;
+    RBT_NODE *nil;
+    RBT_SLAB *slabs;  // 가장 최근 slab 이 맨 앞
+    size_t used;      // slabs(맨 앞) 에서 잘라 쓴 node 수
+    RBT_NODE *free_list;
+    size_t size;
+    RBT_NODE nil_node;
+} RBT_TREE;
+
+static inline RBT_TREE *RBT_FN(new)(void)
+{
+    RBT_TREE *t = (RBT_TREE *)calloc(1, sizeof(RBT_TREE));
+    t->nil = &t->nil_node;
+    t->nil->color = RBTREE_BLACK;
+    t->nil->parent = t->nil->left = t->nil->right = t->nil;
+    t->root = t->nil;
+    return t;
+}
+
+static inline void RBT_FN(delete)(RBT_TREE *t)
+{
+    while (t->slabs != NULL)
+    {
+        RBT_SLAB *next = t->slabs->next;
+        free(t->slabs);
+        t->slabs = next;
+    }
+    free(t);
+}
+
+static inline size_t RBT_FN(size)(const RBT_TREE *t)
+{
+    return t->size;
+}
+
+static inline RBT_NODE *RBT_FN(_alloc)(RBT_TREE *t)
+{
+    RBT_NODE *node = t->free_list;
+    if (node != NULL)
+    {
+        t->free_list = node->right;
+        return node;
+    }
+    if (t->slabs == NULL || t->used == t->slabs->cap)
+    {
+        size_t cap = t->slabs == NULL ? RBT_MIN_SLAB : t->slabs->cap * 2;
+        cap = cap > RBT_MAX_SLAB ? RBT_MAX_SLAB : cap;
+        RBT_SLAB *slab = (RBT_SLAB *)malloc(sizeof(RBT_SLAB) + cap * sizeof(RBT_NODE));
+        slab->cap = cap;
+        slab->next = t->slabs;
+        t->slabs = slab;
+        t->used = 0;
+    }
+    return &t->slabs->nodes[t->used++];
+}
+
+// x 를 왼쪽으로 내리고 x->right 를 올림
+static inline void RBT_FN(_rotate_left)(RBT_NODE *x, RBT_TREE *t)
+{
+    RBT_NODE *y = x->right;
+    x->right = y->left;
+    if (y->left != t->nil)
+    {
+        y->left->parent = x;
+    }
+    y->parent = x->parent;
+    if (x->parent == t->nil)
+    {
+        t->root = y;
+    }
+    else if (x == x->parent->left)
+    {
+        x->parent->left = y;
+    }
+    else
+    {
+        x->parent->right = y;
+    }
+    y->left = x;
+    x->parent = y;
+}
+
+// x 를 오른쪽으로 내리고 x->left 를 올림
+static inline void RBT_FN(_rotate_right)(RBT_NODE *x, RBT_TREE *t)
+{
+    RBT_NODE *y = x->left;
+    x->left = y->right;
+    if (y->right != t->nil)
+    {
+        y->right->parent = x;
+    }
+    y->parent = x->parent;
+    if (x->parent == t->nil)
+    {
+        t->root = y;
+    }
+    else if (x == x->parent->right)
+    {
+        x->parent->right = y;
+    }
+    else
+    {
+        x->parent->left = y;
+    }
+    y->right = x;
+    x->parent = y;
+}
+
+// 빨간 node z 를 붙인 뒤 red-red 를 위로 올리며 해소
+static inline void RBT_FN(_insert_fixup)(RBT_NODE *z, RBT_TREE *t)
+{
+    while (z->parent->color == RBTREE_RED)
+    {
+        RBT_NODE *grand = z->parent->parent;
+        if (z->parent == grand->left)
+        {
+            RBT_NODE *uncle = grand->right;
+            if (uncle->color == RBTREE_RED)
+            {
+                z->parent->color = RBTREE_BLACK;
+                uncle->color = RBTREE_BLACK;
+                grand->color = RBTREE_RED;
+                z = grand;
+                continue;
+            }
+            if (z == z->parent->right)
+            {
+                z = z->parent;
+                RBT_FN(_rotate_left)(z, t);
+            }
+            z->parent->color = RBTREE_BLACK;
+            grand->color = RBTREE_RED;
+            RBT_FN(_rotate_right)(grand, t);
+        }
+        else
+        {
+            RBT_NODE *uncle = grand->left;
+            if (uncle->color == RBTREE_RED)
+            {
+                z->parent->color = RBTREE_BLACK;
+                uncle->color = RBTREE_BLACK;
+                grand->color = RBTREE_RED;
+                z = grand;
+                continue;
+            }
+            if (z == z->parent->left)
+            {
+                z = z->parent;
+                RBT_FN(_rotate_right)(z, t);
+            }
+            z->parent->color = RBTREE_BLACK;
+            grand->color = RBTREE_RED;
+            RBT_FN(_rotate_left)(grand, t);
+        }
+    }
+    t->root->color = RBTREE_BLACK;
+}
+
+// parent 의 (isLeft 쪽) 빈 자리에 새 node 를 붙임. parent 가 nil 이면 root
+static inline RBT_NODE *RBT_FN(_link)(RBT_NODE *parent, bool isLeft, RBT_KEY key, RBT_VALUE value,
+                                      RBT_TREE *t)
+{
+    RBT_NODE *node = RBT_FN(_alloc)(t);
+    node->color = RBTREE_RED;
+    node->parent = parent;
+    node->left = node->right = t->nil;
+    node->key = key;
+    node->value = value;
+    if (parent == t->nil)
+    {
+        t->root = node;
+    }
+    else if (isLeft)
+    {
+        parent->left = node;
+    }
+    else
+    {
+        parent->right = node;
+    }
+    t->size++;
+    RBT_FN(_insert_fixup)(node, t);
+    return node;
+}
+
+// 같은 key 가 있어도 새로 넣음 (같은 key 들 중 가장 오른쪽)
+static inline RBT_NODE *RBT_FN(insert)(RBT_TREE *t, RBT_KEY key, RBT_VALUE value)
+{
+    RBT_NODE *parent = t->nil, *cur = t->root;
+    bool isLeft = false;
+    while (cur != t->nil)
+    {
+        parent = cur;
+        isLeft = RBT_LT(key, cur->key);
+        cur = isLeft ? cur->left : cur->right;
+    }
+    return RBT_FN(_link)(parent, isLeft, key, value, t);
+}
+
+/*
+key 와 같은 node 를 찾으며 내려감
+같으면 (*cmp == 0) 그 node, 아니면 마지막으로 지나간 node (붙일 자리의 parent) 와
+그 쪽 방향 (*cmp < 0 이면 왼쪽) 을 돌려준다. 비어 있으면 nil
+*/
+static inline RBT_NODE *RBT_FN(_search)(const RBT_TREE *t, RBT_KEY key, int *cmp)
+{
+    RBT_NODE *parent = t->nil, *cur = t->root;
+    *cmp = 1;
+    while (cur != t->nil)
+    {
+        parent = cur;
+#ifdef RBT_CMP
+        *cmp = RBT_CMP(key, cur->key);
+        if (*cmp == 0)
+        {
+            return cur;
+        }
+        cur = *cmp < 0 ? cur->left : cur->right;
+#else
+        if (RBT_EQ(key, cur->key))
+        {
+            *cmp = 0;
+            return cur;
+        }
+        *cmp = RBT_LESS(key, cur->key) ? -1 : 1;
+        cur = *cmp < 0 ? cur->left : cur->right;
+#endif
+    }
+    return parent;
+}
+
+static inline RBT_NODE *RBT_FN(find)(const RBT_TREE *t, RBT_KEY key)
+{
+    int cmp;
+    RBT_NODE *p = RBT_FN(_search)(t, key, &cmp);
+    return cmp == 0 ? p : NULL;
+}
+
+// key 가 있으면 value 만 바꾸고, 없으면 넣음 (한 번만 내려감)
+static inline RBT_NODE *RBT_FN(put)(RBT_TREE *t, RBT_KEY key, RBT_VALUE value)
+{
+    int cmp;
+    RBT_NODE *p = RBT_FN(_search)(t, key, &cmp);
+    if (cmp == 0)
+    {
+        p->value = value;
+        return p;
+    }
+    return RBT_FN(_link)(p, cmp < 0, key, value, t);
+}
+
+// key 이상인 첫 node, 없으면 NULL (같은 key 중 가장 왼쪽)
+static inline RBT_NODE *RBT_FN(lower_bound)(const RBT_TREE *t, RBT_KEY key)
+{
+    RBT_NODE *cur = t->root, *found = NULL;
+    while (cur != t->nil)
+    {
+        if (RBT_LT(cur->key, key))
+        {
+            cur = cur->right;
+        }
+        else
+        {
+            found = cur;
+            cur = cur->left;
+        }
+    }
+    return found;
+}
+
+static inline RBT_NODE *RBT_FN(_min)(RBT_NODE *cur, const RBT_TREE *t)
+{
+    while (cur->left != t->nil)
+    {
+        cur = cur->left;
+    }
+    return cur;
+}
+
+static inline RBT_NODE *RBT_FN(_max)(RBT_NODE *cur, const RBT_TREE *t)
+{
+    while (cur->right != t->nil)
+    {
+        cur = cur->right;
+    }
+    return cur;
+}
+
+static inline RBT_NODE *RBT_FN(min)(const RBT_TREE *t)
+{
+    return t->root == t->nil ? NULL : RBT_FN(_min)(t->root, t);
+}
+
+static inline RBT_NODE *RBT_FN(max)(const RBT_TREE *t)
+{
+    return t->root == t->nil ? NULL : RBT_FN(_max)(t->root, t);
+}
+
+// 중위 순회 다음 node, 마지막이면 NULL
+static inline RBT_NODE *RBT_FN(next)(const RBT_TREE *t, RBT_NODE *p)
+{
+    if (p->right != t->nil)
+    {
+        return RBT_FN(_min)(p->right, t);
+    }
+    while (p->parent != t->nil && p == p->parent->right)
+    {
+        p = p->parent;
+    }
+    return p->parent == t->nil ? NULL : p->parent;
+}
+
+static inline RBT_NODE *RBT_FN(prev)(const RBT_TREE *t, RBT_NODE *p)
+{
+    if (p->left != t->nil)
+    {
+        return RBT_FN(_max)(p->left, t);
+    }
+    while (p->parent != t->nil && p == p->parent->left)
+    {
+        p = p->parent;
+    }
+    return p->parent == t->nil ? NULL : p->parent;
+}
+
+// u 자리에 v 를 올림 (v 의 자식은 그대로)
+static inline void RBT_FN(_transplant)(RBT_NODE *u, RBT_NODE *v, RBT_TREE *t)
+{
+    if (u->parent == t->nil)
+    {
+        t->root = v;
+    }
+    else if (u == u->parent->left)
+    {
+        u->parent->left = v;
+    }
+    else
+    {
+        u->parent->right = v;
+    }
+    v->parent = u->parent;
+}
+
+// 검은 node 가 빠져 x 쪽 black height 가 하나 모자란 것을 해소
+static inline void RBT_FN(_erase_fixup)(RBT_NODE *x, RBT_TREE *t)
+{
+    while (x != t->root && x->color == RBTREE_BLACK)
+    {
+        if (x == x->parent->left)
+        {
+            RBT_NODE *brother = x->parent->right;
+            if (brother->color == RBTREE_RED)
+            {
+                brother->color = RBTREE_BLACK;
+                x->parent->color = RBTREE_RED;
+                RBT_FN(_rotate_left)(x->parent, t);
+                brother = x->parent->right;
+            }
+            if (brother->left->color == RBTREE_BLACK && brother->right->color == RBTREE_BLACK)
+            {
+                brother->color = RBTREE_RED;
+                x = x->parent;
+                continue;
+            }
+            if (brother->right->color == RBTREE_BLACK)
+            {
+                brother->left->color = RBTREE_BLACK;
+                brother->color = RBTREE_RED;
+                RBT_FN(_rotate_right)(brother, t);
+                brother = x->parent->right;
+            }
+            brother->color = x->parent->color;
+            x->parent->color = RBTREE_BLACK;
+            brother->right->color = RBTREE_BLACK;
+            RBT_FN(_rotate_left)(x->parent, t);
+            x = t->root;
+        }
+        else
+        {
+            RBT_NODE *brother = x->parent->left;
+            if (brother->color == RBTREE_RED)
+            {
+                brother->color = RBTREE_BLACK;
+                x->parent->color = RBTREE_RED;
+                RBT_FN(_rotate_right)(x->parent, t);
+                brother = x->parent->left;
+            }
+            if (brother->left->color == RBTREE_BLACK && brother->right->color == RBTREE_BLACK)
+            {
+                brother->color = RBTREE_RED;
+                x = x->parent;
+                continue;
+            }
+            if (brother->left->color == RBTREE_BLACK)
+            {
+                brother->right->color = RBTREE_BLACK;
+                brother->color = RBTREE_RED;
+                RBT_FN(_rotate_left)(brother, t);
+                brother = x->parent->left;
+            }
+            brother->color = x->parent->color;
+            x->parent->color = RBTREE_BLACK;
+            brother->left->color = RBTREE_BLACK;
+            RBT_FN(_rotate_right)(x->parent, t);
+            x = t->root;
+        }
+    }
+    x->color = RBTREE_BLACK;
+}
+
+static inline int RBT_FN(erase)(RBT_TREE *t, RBT_NODE *p)
+{
+    RBT_NODE *replacer = p, *x;
+    color_t removedColor = p->color;
+    if (p->left == t->nil)
+    {
+        x = p->right;
+        RBT_FN(_transplant)(p, p->right, t);
+    }
+    else if (p->right == t->nil)
+    {
+        x = p->left;
+        RBT_FN(_transplant)(p, p->left, t);
+    }
+    else
+    {
+        // 자식이 둘이면 successor 를 p 자리로 올림
+        replacer = RBT_FN(_min)(p->right, t);
+        removedColor = replacer->color;
+        x = replacer->right;
+        if (replacer->parent == p)
+        {
+            x->parent = replacer;  // x 가 nil 이어도 fixup 이 parent 를 따라갈 수 있게
+        }
+        else
+        {
+            RBT_FN(_transplant)(replacer, replacer->right, t);
+            replacer->right = p->right;
+            replacer->right->parent = replacer;
+        }
+        RBT_FN(_transplant)(p, replacer, t);
+        replacer->left = p->left;
+        replacer->left->parent = replacer;
+        replacer->color = p->color;
+    }
+    if (removedColor == RBTREE_BLACK)
+    {
+        RBT_FN(_erase_fixup)(x, t);
+    }
+    t->nil->parent = t->nil;
+
+    p->right = t->free_list;
+    t->free_list = p;
+    t->size--;
+    return 0;
+}
+
+#undef RBT_NAME
+#undef RBT_KEY
+#undef RBT_VALUE
+#undef RBT_CMP
+#undef RBT_LESS
+#undef RBT_EQ
+#undef RBT_LT
+#undef RBT_NODE
+#undef RBT_SLAB
+#undef RBT_TREE
@@ -0,0 +1,1271 @@
+#include "rbtree.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+32bit index engine
+rbtree.c 와 같은 API 를 node 배열 하나와 uint32_t link 로 구현한다. (-DRBTREE_INDEX 로 빌드)
+전역 _nil 대신 tree 마다 nodes[0] 을 sentinel 로 쓰고,
+erase 된 index 는 free_list 에 넣어 재사용한다.
+*/
+#define NIL 0
+#define COLOR_BIT 0x80000000u
+#define INDEX_MIN_CAP 32
+#define INDEX_MAX_CAP ((size_t)COLOR_BIT)  // index 는 color 비트 아래 31 bit (sentinel 포함 2^31 개)
+
+#define NODE(i) (&t->nodes[(i)])
+#define KEY(i) (t->nodes[(i)].key)
+#define LEFT(i) (t->nodes[(i)].left)
+#define RIGHT(i) (t->nodes[(i)].right)
+#define COLOR(i) RBTREE_COLOR(NODE(i))
+#define PARENT(i) RBTREE_PARENT_INDEX(NODE(i))
+#define SET_COLOR(i, c) (t->nodes[(i)].parent_color = PARENT(i) | ((uint32_t)(c) << 31))
+#define SET_PARENT(i, p) (t->nodes[(i)].parent_color = (p) | (t->nodes[(i)].parent_color & COLOR_BIT))
+#define INDEX_OF(p) ((uint32_t)((p) - t->nodes))
+
+// -DRBTREE_TRACE : insert / find / erase 를 기록 (rbtree.c 와 같음)
+#ifdef RBTREE_TRACE
+#include "rbtree_trace.h"
+#define TRACE(op, key) rbtree_trace_record((op), (key))
+#else
+#define TRACE(op, key) ((void)0)
+#endif
+
+// 배열을 node cap 개로 늘림 (이전 node_t * 는 무효가 됨)
+// INDEX_MAX_CAP 을 넘거나 realloc 이 실패하면 배열은 그대로 두고 false
+static bool _grow(rbtree *t, const size_t cap)
+{
+    if (cap > INDEX_MAX_CAP)
+    {
+        return false;
+    }
+    node_t *nodes = realloc(t->nodes, cap * sizeof(node_t));
+    if (nodes == NULL)
+    {
+        return false;
+    }
+    t->nodes = nodes;
+    t->cap = (uint32_t)cap;
+    return true;
+}
+
+// 새 node 의 index, 더 담을 수 없으면 NIL
+static uint32_t _alloc_node(rbtree *t)
+{
+    uint32_t node = t->free_list;
+    if (node != NIL)
+    {
+        t->free_list = RIGHT(node);
+        return node;
+    }
+    // 배열이 가득 차면 두 배로 늘림 (INDEX_MAX_CAP 에서 멈춤)
+    if (t->used == t->cap)
+    {
+        const size_t cap = (size_t)t->cap * 2 < INDEX_MAX_CAP ? (size_t)t->cap * 2 : INDEX_MAX_CAP;
+        if (t->used == INDEX_MAX_CAP || !_grow(t, cap))
+        {
+            return NIL;
+        }
+    }
+    return t->used++;
+}
+
+static void _free_node(rbtree *t, uint32_t node)
+{
+    RIGHT(node) = t->free_list;
+    t->free_list = node;
+}
+
+// node 를 cap 개 (sentinel 포함) 담을 빈 tree, INDEX_MAX_CAP 을 넘거나 메모리가 모자라면 NULL
+static rbtree *_new_rbtree(const size_t cap)
+{
+    if (cap > INDEX_MAX_CAP)
+    {
+        return NULL;
+    }
+    rbtree *t = (rbtree *)calloc(1, sizeof(rbtree));
+    if (t == NULL)
+    {
+        return NULL;
+    }
+    t->cap = cap < INDEX_MIN_CAP ? INDEX_MIN_CAP : (uint32_t)cap;
+    t->nodes = malloc((size_t)t->cap * sizeof(node_t));
+    if (t->nodes == NULL)
+    {
+        free(t);
+        return NULL;
+    }
+    t->used = 1;
+
+    // 0 번 node 를 sentinel 로 초기화
+    t->nodes[NIL] = (node_t){.parent_color = COLOR_BIT, .left = NIL, .right = NIL, .key = 0};
+    t->root = NIL;
+    t->free_list = NIL;
+    return t;
+}
+
+rbtree *new_rbtree(void)
+{
+    return _new_rbtree(INDEX_MIN_CAP);
+}
+
+void delete_rbtree(rbtree *t)
+{
+    // node 는 모두 한 배열에 있으므로 한 번에 반환
+    free(t->nodes);
+    free(t);
+}
+
+typedef enum
+{
+    LEFT,
+    RIGHT
+} direction_t;
+
+static void _setChild(rbtree *t, uint32_t parent, uint32_t child, direction_t isRight)
+{
+    if (child != NIL)
+    {
+        SET_PARENT(child, parent);
+    }
+    if (parent == NIL)
+        return;
+    if (isRight)
+    {
+        RIGHT(parent) = child;
+    }
+    else
+    {
+        LEFT(parent) = child;
+    }
+}
+
+static uint32_t _getChild(const rbtree *t, uint32_t parent, direction_t isRight)
+{
+    return isRight ? RIGHT(parent) : LEFT(parent);
+}
+
+/*
+노드를 회전하는 함수 (rbtree.c 의 _rotate 와 같음)
+회전하고 색을 유지하기 위해 회전하는 두색을 바꿔줌
+*/
+static void _rotate(rbtree *t, uint32_t parent, direction_t isRight)
+{
+    uint32_t grandParent = PARENT(parent);
+    uint32_t newParent = _getChild(t, parent, !isRight);
+    uint32_t beta = _getChild(t, newParent, isRight);
+
+    // 색 교환
+    color_t parentColor = COLOR(parent);
+    SET_COLOR(parent, COLOR(newParent));
+    SET_COLOR(newParent, parentColor);
+
+    // 내부 회전
+    _setChild(t, parent, beta, !isRight);
+    _setChild(t, newParent, parent, isRight);
+
+    // 조부모와 새 부모를 연결, 조부모가 NIL이면 루트 변경
+    _setChild(t, grandParent, newParent, (RIGHT(grandParent) == parent));
+    if (PARENT(newParent) == NIL)
+    {
+        t->root = newParent;
+    }
+
+#ifdef RBTREE_ORDER_STAT
+    NODE(newParent)->size = NODE(parent)->size;
+    NODE(parent)->size = NODE(LEFT(parent))->size + NODE(RIGHT(parent))->size + 1;
+#endif
+}
+
+// 이중 red 를 위로 올라가며 고치고 멈춘 자리를 돌려줌 (rbtree.c 의 _fix_double_red 와 같음)
+static uint32_t _fix_double_red(rbtree *t, uint32_t cur)
+{
+    uint32_t parent, uncle;
+    direction_t parentDirection, curDirection;
+    // 부모가 레드여서 이중 레드일 동안 반복해서 수정
+    while (COLOR(PARENT(cur)) == RBTREE_RED)
+    {
+        parent = PARENT(cur);
+        parentDirection = (RIGHT(PARENT(parent)) == parent);
+        uncle = _getChild(t, PARENT(parent), !parentDirection);
+
+        // CASE 1 : uncle이 red일 경우 -> grand parent ->red; parent & uncle -> black;
+        if (COLOR(uncle) == RBTREE_RED)
+        {
+            SET_COLOR(parent, RBTREE_BLACK);
+            SET_COLOR(uncle, RBTREE_BLACK);
+            SET_COLOR(PARENT(parent), RBTREE_RED);
+            cur = PARENT(parent);
+            continue;
+        }
+
+        curDirection = (RIGHT(parent) == cur);
+        uint32_t grandParent = PARENT(parent);
+
+        // CASE 2 : 다이아몬드 모양 -> 쭉 펴줌
+        if (curDirection != parentDirection)
+        {
+            _rotate(t, parent, !curDirection);
+        }
+
+        // CASE 3 : 한칸 내리고 색칠
+        _rotate(t, grandParent, !parentDirection);
+        cur = PARENT(grandParent);
+        break;
+    }
+
+    return cur;
+}
+
+node_t *rbtree_insert(rbtree *t, const key_t key)
+{
+    TRACE(RBTREE_TRACE_INSERT, key);
+    // 새 노드를 만들고 초기화 (red, NIL)
+    uint32_t newNode = _alloc_node(t);
+    if (newNode == NIL)
+    {
+        return NULL;
+    }
+    KEY(newNode) = key;
+    NODE(newNode)->parent_color = NIL;
+    LEFT(newNode) = NIL;
+    RIGHT(newNode) = NIL;
+#ifdef RBTREE_ORDER_STAT
+    NODE(newNode)->size = 1;
+#endif
+    t->size++;
+
+    if (t->root == NIL)
+    {
+        SET_COLOR(newNode, RBTREE_BLACK);
+        t->root = newNode;
+        return NODE(newNode);
+    }
+
+    // BST처럼 새 노드가 삽입 될 위치를 찾음
+    uint32_t parent = NIL, cur = t->root;
+    while (cur != NIL)
+    {
+        parent = cur;
+#ifdef RBTREE_ORDER_STAT
+        NODE(cur)->size++;
+#endif
+        cur = key < KEY(cur) ? LEFT(cur) : RIGHT(cur);
+    }
+    _setChild(t, parent, newNode, (KEY(parent) <= key));
+
+    cur = _fix_double_red(t, newNode);
+    if (PARENT(cur) == NIL)
+    {
+        t->root = cur;
+        SET_COLOR(cur, RBTREE_BLACK);
+    }
+
+    return NODE(newNode);
+}
+
+node_t *rbtree_find(const rbtree *t, const key_t key)
+{
+    TRACE(RBTREE_TRACE_FIND, key);
+    uint32_t cur = t->root;
+    while (cur != NIL)
+    {
+        if (KEY(cur) == key)
+        {
+            return NODE(cur);
+        }
+        cur = key < KEY(cur) ? LEFT(cur) : RIGHT(cur);
+    }
+    return NULL;
+}
+
+// rbtree.c 의 rbtree_find_batch 와 같은 방식 : 여러 key 를 번갈아 내려가며 다음 node 를 prefetch
+#define BATCH_FIND_GROUP 32
+
+size_t rbtree_find_batch(const rbtree *t, const key_t *keys, const size_t n, node_t **out)
+{
+    uint32_t cur[BATCH_FIND_GROUP];
+    size_t slot[BATCH_FIND_GROUP];
+    size_t next = 0, active = 0, found = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        TRACE(RBTREE_TRACE_FIND, keys[i]);
+    }
+    for (; active < BATCH_FIND_GROUP && next < n; active++, next++)
+    {
+        cur[active] = t->root;
+        slot[active] = next;
+    }
+    while (active > 0)
+    {
+        for (size_t g = 0; g < active;)
+        {
+            uint32_t node = cur[g];
+            const key_t key = keys[slot[g]];
+            if (node != NIL && KEY(node) != key)
+            {
+                node = key < KEY(node) ? LEFT(node) : RIGHT(node);
+                __builtin_prefetch(NODE(node));
+                cur[g++] = node;
+                continue;
+            }
+            out[slot[g]] = node == NIL ? NULL : NODE(node);
+            found += node != NIL;
+            if (next < n)
+            {
+                cur[g] = t->root;
+                slot[g] = next++;
+            }
+            else
+            {
+                active--;
+                cur[g] = cur[active];
+                slot[g] = slot[active];
+            }
+        }
+    }
+    return found;
+}
+
+// key 이상인 첫 node, 없으면 NULL
+node_t *rbtree_lower_bound(const rbtree *t, const key_t key)
+{
+    uint32_t cur = t->root, found = NIL;
+    while (cur != NIL)
+    {
+        if (KEY(cur) >= key)
+        {
+            found = cur;
+            cur = LEFT(cur);
+        }
+        else
+        {
+            cur = RIGHT(cur);
+        }
+    }
+    return found == NIL ? NULL : NODE(found);
+}
+
+// key 보다 큰 첫 node, 없으면 NULL
+node_t *rbtree_upper_bound(const rbtree *t, const key_t key)
+{
+    uint32_t cur = t->root, found = NIL;
+    while (cur != NIL)
+    {
+        if (KEY(cur) > key)
+        {
+            found = cur;
+            cur = LEFT(cur);
+        }
+        else
+        {
+            cur = RIGHT(cur);
+        }
+    }
+    return found == NIL ? NULL : NODE(found);
+}
+
+static uint32_t _rbtree_min(const rbtree *t, uint32_t cur)
+{
+    while (LEFT(cur) != NIL)
+    {
+        cur = LEFT(cur);
+    }
+    return cur;
+}
+
+static uint32_t _rbtree_max(const rbtree *t, uint32_t cur)
+{
+    while (RIGHT(cur) != NIL)
+    {
+        cur = RIGHT(cur);
+    }
+    return cur;
+}
+
+node_t *rbtree_min(const rbtree *t)
+{
+    if (t->root == NIL)
+    {
+        return NULL;
+    }
+    return NODE(_rbtree_min(t, t->root));
+}
+
+node_t *rbtree_max(const rbtree *t)
+{
+    if (t->root == NIL)
+    {
+        return NULL;
+    }
+    return NODE(_rbtree_max(t, t->root));
+}
+
+// u 위치를 v로 대체
+static void _transplant(rbtree *t, uint32_t u, uint32_t v)
+{
+    _setChild(t, PARENT(u), v, (RIGHT(PARENT(u)) == u));
+    _setChild(t, v, LEFT(u), LEFT);
+    _setChild(t, v, RIGHT(u), RIGHT);
+}
+
+#ifdef RBTREE_ORDER_STAT
+// 실제로 빠지는 자리의 조상들 subtree 크기를 하나씩 줄임
+static void _shrink_ancestors(rbtree *t, uint32_t cur)
+{
+    for (uint32_t x = PARENT(cur); x != NIL; x = PARENT(x))
+    {
+        NODE(x)->size--;
+    }
+}
+#endif
+
+int rbtree_erase(rbtree *t, node_t *node)
+{
+    TRACE(RBTREE_TRACE_ERASE, node->key);
+    uint32_t p = INDEX_OF(node);
+    t->size--;
+    if (p == t->root && LEFT(p) == NIL && RIGHT(p) == NIL)
+    {
+        t->root = NIL;
+        _free_node(t, p);
+        return 0;
+    }
+    // step 1 : BST 삭제, 색을 유지해줘야할 replaceColor 찾아서 저장
+    color_t replaceColor = COLOR(p);
+    uint32_t replacer, cur, parent;
+    if (LEFT(p) != NIL && RIGHT(p) != NIL)
+    {
+        replacer = _rbtree_min(t, RIGHT(p));
+#ifdef RBTREE_ORDER_STAT
+        _shrink_ancestors(t, replacer);
+        NODE(replacer)->size = NODE(p)->size;
+#endif
+        cur = RIGHT(replacer);
+        if (replacer != RIGHT(p))
+        {
+            parent = PARENT(replacer);
+            _setChild(t, PARENT(replacer), RIGHT(replacer), LEFT);
+        }
+        else
+        {
+            parent = replacer;
+            _setChild(t, p, RIGHT(replacer), RIGHT);
+        }
+        replaceColor = COLOR(replacer);
+        SET_COLOR(replacer, COLOR(p));
+        _transplant(t, p, replacer);
+    }
+    else
+    {
+        replacer = _getChild(t, p, (RIGHT(p) != NIL));
+#ifdef RBTREE_ORDER_STAT
+        _shrink_ancestors(t, p);
+#endif
+        cur = replacer;
+        parent = PARENT(p);
+        _setChild(t, PARENT(p), replacer, (RIGHT(PARENT(p)) == p));
+    }
+    if (p == t->root)
+    {
+        t->root = replacer;
+    }
+    // STEP 2 : 없어진 색이 black이면 FIX가 필요
+    if (replaceColor == RBTREE_BLACK)
+    {
+        while (COLOR(cur) == RBTREE_BLACK && t->root != cur)
+        {
+            direction_t curDirection = (RIGHT(parent) == cur);
+            uint32_t brother = _getChild(t, parent, !curDirection);
+            // CASE 1 : 형제가 빨강 (부모는 검정) -> CASE 2, 3, 4 중 하나로 변환
+            if (COLOR(brother) == RBTREE_RED)
+            {
+                _rotate(t, parent, curDirection);
+                brother = _getChild(t, parent, !curDirection);
+            }
+
+            // CASE 2 : 형제의 두 자식이 모두 검정
+            if (COLOR(LEFT(brother)) == RBTREE_BLACK && COLOR(RIGHT(brother)) == RBTREE_BLACK)
+            {
+                SET_COLOR(brother, RBTREE_RED);
+                cur = parent;
+                parent = PARENT(cur);
+                continue;
+            }
+
+            // CASE 3 : 형제의 반대 쪽 자식이 검정 (내 쪽 자식은 빨강) -> CASE 4로 바뀜
+            else if (COLOR(_getChild(t, brother, !curDirection)) == RBTREE_BLACK)
+            {
+                _rotate(t, brother, !curDirection);
+                brother = PARENT(brother);
+            }
+
+            // CASE 4 : 형제의 반대 자식이 빨강
+            SET_COLOR(_getChild(t, brother, !curDirection), RBTREE_BLACK);
+            _rotate(t, parent, curDirection);
+            break;
+        }
+
+        // CASE red-black : 교체한 내가 RED이면 검정으로 칠하고 종료
+        if (COLOR(cur) == RBTREE_RED)
+        {
+            SET_COLOR(cur, RBTREE_BLACK);
+        }
+        SET_COLOR(t->root, RBTREE_BLACK);
+    }
+
+    _free_node(t, p);
+    return 0;
+}
+
+static uint32_t _next_node(const rbtree *t, uint32_t cur)
+{
+    if (RIGHT(cur) != NIL)
+    {
+        return _rbtree_min(t, RIGHT(cur));
+    }
+    uint32_t parent = PARENT(cur);
+    while (parent != NIL && cur == RIGHT(parent))
+    {
+        cur = parent;
+        parent = PARENT(parent);
+    }
+    return parent;
+}
+
+static uint32_t _prev_node(const rbtree *t, uint32_t cur)
+{
+    if (LEFT(cur) != NIL)
+    {
+        return _rbtree_max(t, LEFT(cur));
+    }
+    uint32_t parent = PARENT(cur);
+    while (parent != NIL && cur == LEFT(parent))
+    {
+        cur = parent;
+        parent = PARENT(parent);
+    }
+    return parent;
+}
+
+node_t *rbtree_next(const rbtree *t, node_t *p)
+{
+    uint32_t next = _next_node(t, INDEX_OF(p));
+    return next == NIL ? NULL : NODE(next);
+}
+
+node_t *rbtree_prev(const rbtree *t, node_t *p)
+{
+    uint32_t prev = _prev_node(t, INDEX_OF(p));
+    return prev == NIL ? NULL : NODE(prev);
+}
+
+rbtree_cursor rbtree_cursor_first(const rbtree *t)
+{
+    rbtree_cursor c = {.tree = t, .node = rbtree_min(t)};
+    return c;
+}
+
+rbtree_cursor rbtree_cursor_last(const rbtree *t)
+{
+    rbtree_cursor c = {.tree = t, .node = rbtree_max(t)};
+    return c;
+}
+
+node_t *rbtree_cursor_next(rbtree_cursor *c)
+{
+    if (c->node != NULL)
+    {
+        c->node = rbtree_next(c->tree, c->node);
+    }
+    return c->node;
+}
+
+node_t *rbtree_cursor_prev(rbtree_cursor *c)
+{
+    c->node = c->node == NULL ? rbtree_max(c->tree) : rbtree_prev(c->tree, c->node);
+    return c->node;
+}
+
+// rbtree.c 와 같이 커서 위치부터 cap 개씩 끊어 읽음
+size_t rbtree_cursor_read(rbtree_cursor *c, key_t *out, const size_t cap)
+{
+    const rbtree *t = c->tree;
+    uint32_t cur = c->node == NULL ? NIL : INDEX_OF(c->node);
+    size_t count = 0;
+    while (cur != NIL && count < cap)
+    {
+        out[count++] = KEY(cur);
+        cur = _next_node(t, cur);
+    }
+    c->node = cur == NIL ? NULL : NODE(cur);
+    return count;
+}
+
+int rbtree_export(const rbtree *t, key_t *buf, const size_t cap, rbtree_export_fn fn, void *arg)
+{
+    rbtree_cursor c = rbtree_cursor_first(t);
+    size_t count;
+    while ((count = rbtree_cursor_read(&c, buf, cap)) > 0)
+    {
+        const int res = fn(buf, count, arg);
+        if (res != 0)
+        {
+            return res;
+        }
+    }
+    return 0;
+}
+
+int rbtree_to_array(const rbtree *t, key_t *arr, const size_t n)
+{
+    size_t index = 0;
+    if (t->root == NIL || n == 0)
+    {
+        return index != n;
+    }
+    uint32_t cur = _rbtree_min(t, t->root);
+    while (cur != NIL && index < n)
+    {
+        arr[index++] = KEY(cur);
+        if (index < n)
+        {
+            cur = _next_node(t, cur);
+        }
+    }
+    return index != n;
+}
+
+// 정렬된 arr[lo, hi) 로 subtree 를 만든다 (rbtree.c 의 _build_sorted 와 같은 색칠)
+// arr[i] 는 nodes[base + i] 에 들어가 배열 순서가 곧 key 순서가 된다.
+static uint32_t _build_sorted(rbtree *t, uint32_t base, const key_t *arr, size_t lo, size_t hi,
+                              int depth, int redDepth, uint32_t parent)
+{
+    if (lo >= hi)
+    {
+        return NIL;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    uint32_t node = base + (uint32_t)mid;
+    KEY(node) = arr[mid];
+    NODE(node)->parent_color = parent | (depth == redDepth ? 0 : COLOR_BIT);
+#ifdef RBTREE_ORDER_STAT
+    NODE(node)->size = (uint32_t)(hi - lo);
+#endif
+    LEFT(node) = _build_sorted(t, base, arr, lo, mid, depth + 1, redDepth, node);
+    RIGHT(node) = _build_sorted(t, base, arr, mid + 1, hi, depth + 1, redDepth, node);
+    return node;
+}
+
+static int _red_depth(const size_t n)
+{
+    int redDepth = 0;
+    while (((size_t)2 << redDepth) - 1 <= n)
+    {
+        redDepth++;
+    }
+    return redDepth;
+}
+
+rbtree *rbtree_from_sorted_array(const key_t *arr, const size_t n)
+{
+    // n + 1 이 넘치지 않도록 먼저 자름 (node 는 INDEX_MAX_CAP - 1 개까지)
+    rbtree *t = n < INDEX_MAX_CAP ? _new_rbtree(n + 1) : NULL;
+    if (t == NULL || n == 0)
+    {
+        return t;
+    }
+
+    t->used = (uint32_t)n + 1;
+    t->root = _build_sorted(t, 1, arr, 0, n, 0, _red_depth(n), NIL);
+    t->size = n;
+    return t;
+}
+
+static int _comp_key(const void *p1, const void *p2)
+{
+    const key_t e1 = *(const key_t *)p1;
+    const key_t e2 = *(const key_t *)p2;
+    return (e1 > e2) - (e1 < e2);
+}
+
+/*
+freeze
+rbtree.c 와 같은 van Emde Boas 순서로 node 를 새 배열에 옮겨 담고 index 를 바꿔 단다.
+반납된 index 는 버리므로 배열은 node 수에 맞게 줄어든다.
+*/
+static void _veb_layout(const rbtree *t, uint32_t root, const int h, uint32_t *order, size_t *count);
+
+static void _veb_bottoms(const rbtree *t, uint32_t node, const int depth, const int h, uint32_t *order,
+                         size_t *count)
+{
+    if (node == NIL)
+    {
+        return;
+    }
+    if (depth == 0)
+    {
+        _veb_layout(t, node, h, order, count);
+        return;
+    }
+    _veb_bottoms(t, LEFT(node), depth - 1, h, order, count);
+    _veb_bottoms(t, RIGHT(node), depth - 1, h, order, count);
+}
+
+static void _veb_layout(const rbtree *t, uint32_t root, const int h, uint32_t *order, size_t *count)
+{
+    if (root == NIL)
+    {
+        return;
+    }
+    if (h == 1)
+    {
+        order[(*count)++] = root;
+        return;
+    }
+    const int top = h / 2;
+    _veb_layout(t, root, top, order, count);
+    _veb_bottoms(t, root, top, h - top, order, count);
+}
+
+static int _height(const rbtree *t, uint32_t node)
+{
+    if (node == NIL)
+    {
+        return 0;
+    }
+    const int left = _height(t, LEFT(node)), right = _height(t, RIGHT(node));
+    return 1 + (left > right ? left : right);
+}
+
+int rbtree_freeze(rbtree *t)
+{
+    const size_t n = t->size;
+    const uint32_t cap = n + 1 < INDEX_MIN_CAP ? INDEX_MIN_CAP : (uint32_t)(n + 1);
+    uint32_t *order = malloc((n + 1) * sizeof(uint32_t));
+    uint32_t *newIndex = malloc((size_t)t->used * sizeof(uint32_t));
+    node_t *nodes = malloc((size_t)cap * sizeof(node_t));
+    if (order == NULL || newIndex == NULL || nodes == NULL)
+    {
+        free(nodes);
+        free(newIndex);
+        free(order);
+        return -1;
+    }
+    size_t count = 0;
+    _veb_layout(t, t->root, _height(t, t->root), order, &count);
+
+    nodes[NIL] = (node_t){.parent_color = COLOR_BIT, .left = NIL, .right = NIL, .key = 0};
+    newIndex[NIL] = NIL;
+    for (size_t i = 0; i < n; i++)
+    {
+        newIndex[order[i]] = (uint32_t)(i + 1);
+        nodes[i + 1] = *NODE(order[i]);
+    }
+    for (size_t i = 1; i <= n; i++)
+    {
+        node_t *p = &nodes[i];
+        p->left = newIndex[p->left];
+        p->right = newIndex[p->right];
+        p->parent_color = newIndex[RBTREE_PARENT_INDEX(p)] | (p->parent_color & COLOR_BIT);
+    }
+    t->root = newIndex[t->root];
+    free(newIndex);
+    free(order);
+
+    free(t->nodes);
+    t->nodes = nodes;
+    t->cap = cap;
+    t->used = (uint32_t)(n + 1);
+    t->free_list = NIL;
+    return 0;
+}
+
+/*
+batch insert
+rbtree.c 의 finger insert / 재구성 대신 정렬한 순서대로 rbtree_insert 를 부른다.
+정렬된 key 는 가까운 자리로 들어가므로 루트부터의 경로가 대부분 cache 에 남아 있다.
+배열은 미리 한 번에 늘려 두어 중간에 realloc 이 일어나지 않게 한다. (그래서 넣기 시작하면 실패하지 않음)
+*/
+int rbtree_insert_batch(rbtree *t, const key_t *keys, const size_t n)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    // buffer 나 배열을 잡지 못하면 (node 가 INDEX_MAX_CAP 을 넘어도) tree 는 그대로
+    if (n >= INDEX_MAX_CAP || ((size_t)t->used + n > t->cap && !_grow(t, (size_t)t->used + n)))
+    {
+        return -1;
+    }
+    key_t *sorted = malloc(n * sizeof(key_t));
+    if (sorted == NULL)
+    {
+        return -1;
+    }
+    memcpy(sorted, keys, n * sizeof(key_t));
+    qsort(sorted, n, sizeof(key_t), _comp_key);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        rbtree_insert(t, sorted[i]);
+    }
+    free(sorted);
+    return 0;
+}
+
+// split / join : rbtree.c 와 같은 방식 (떼어 낸 subtree 를 black height 와 함께 다룸)
+typedef struct
+{
+    uint32_t root;
+    int bh;
+} subtree_t;
+
+static int _black_height(const rbtree *t, uint32_t root)
+{
+    int bh = 0;
+    for (; root != NIL; root = LEFT(root))
+    {
+        bh += COLOR(root) == RBTREE_BLACK;
+    }
+    return bh;
+}
+
+static subtree_t _blacken(rbtree *t, subtree_t s)
+{
+    if (COLOR(s.root) == RBTREE_RED)
+    {
+        SET_COLOR(s.root, RBTREE_BLACK);
+        s.bh++;
+    }
+    return s;
+}
+
+static subtree_t _detach(rbtree *t, uint32_t node, direction_t isRight, int bh)
+{
+    subtree_t s = {_getChild(t, node, isRight), bh - (COLOR(node) == RBTREE_BLACK)};
+    if (s.root != NIL)
+    {
+        SET_PARENT(s.root, NIL);
+    }
+    return s;
+}
+
+static subtree_t _join(rbtree *t, subtree_t left, uint32_t pivot, subtree_t right)
+{
+    left = _blacken(t, left);
+    right = _blacken(t, right);
+    if (left.bh == right.bh)
+    {
+        NODE(pivot)->parent_color = NIL | COLOR_BIT;
+        _setChild(t, pivot, left.root, LEFT);
+        _setChild(t, pivot, right.root, RIGHT);
+#ifdef RBTREE_ORDER_STAT
+        NODE(pivot)->size = NODE(left.root)->size + NODE(right.root)->size + 1;
+#endif
+        return (subtree_t){pivot, left.bh + 1};
+    }
+
+    const direction_t isRight = left.bh < right.bh;
+    const subtree_t tall = isRight ? right : left, low = isRight ? left : right;
+    uint32_t parent = NIL, cur = tall.root;
+    int bh = tall.bh;
+    while (COLOR(cur) == RBTREE_RED || bh > low.bh)
+    {
+        bh -= COLOR(cur) == RBTREE_BLACK;
+#ifdef RBTREE_ORDER_STAT
+        NODE(cur)->size += NODE(low.root)->size + 1;
+#endif
+        parent = cur;
+        cur = _getChild(t, cur, !isRight);
+    }
+    SET_COLOR(pivot, RBTREE_RED);
+    _setChild(t, pivot, cur, isRight);
+    _setChild(t, pivot, low.root, !isRight);
+    _setChild(t, parent, pivot, !isRight);
+#ifdef RBTREE_ORDER_STAT
+    NODE(pivot)->size = NODE(cur)->size + NODE(low.root)->size + 1;
+#endif
+
+    t->root = tall.root;
+    uint32_t top = _fix_double_red(t, pivot);
+    if (PARENT(top) == NIL && COLOR(top) == RBTREE_RED)
+    {
+        SET_COLOR(top, RBTREE_BLACK);
+        return (subtree_t){t->root, tall.bh + 1};
+    }
+    return (subtree_t){t->root, tall.bh};
+}
+
+static void _split(rbtree *t, subtree_t s, const key_t key, subtree_t *less, subtree_t *rest)
+{
+    uint32_t root = s.root;
+    if (root == NIL)
+    {
+        *less = *rest = s;
+        return;
+    }
+    subtree_t left = _detach(t, root, LEFT, s.bh);
+    subtree_t right = _detach(t, root, RIGHT, s.bh);
+    if (key <= KEY(root))
+    {
+        _split(t, left, key, less, &left);
+        *rest = _join(t, left, root, right);
+    }
+    else
+    {
+        _split(t, right, key, &right, rest);
+        *less = _join(t, left, root, right);
+    }
+}
+
+static subtree_t _split_last(rbtree *t, subtree_t s, uint32_t *last)
+{
+    uint32_t root = s.root;
+    subtree_t left = _detach(t, root, LEFT, s.bh);
+    subtree_t right = _detach(t, root, RIGHT, s.bh);
+    if (right.root == NIL)
+    {
+        *last = root;
+        return left;
+    }
+    right = _split_last(t, right, last);
+    return _join(t, left, root, right);
+}
+
+static subtree_t _join2(rbtree *t, subtree_t left, subtree_t right)
+{
+    if (left.root == NIL)
+    {
+        return right;
+    }
+    if (right.root == NIL)
+    {
+        return left;
+    }
+    uint32_t pivot;
+    left = _split_last(t, left, &pivot);
+    return _join(t, left, pivot, right);
+}
+
+// 떼어 낸 subtree 를 한 줄로 펴 가며 index 를 모두 free_list 로 반납
+static size_t _free_subtree(rbtree *t, uint32_t cur)
+{
+    size_t count = 0;
+    while (cur != NIL)
+    {
+        uint32_t left = LEFT(cur);
+        if (left != NIL)
+        {
+            LEFT(cur) = RIGHT(left);
+            RIGHT(left) = cur;
+            cur = left;
+            continue;
+        }
+        uint32_t next = RIGHT(cur);
+        _free_node(t, cur);
+        cur = next;
+        count++;
+    }
+    return count;
+}
+
+size_t rbtree_erase_range(rbtree *t, const key_t lo, const key_t hi)
+{
+    const node_t *first = rbtree_lower_bound(t, lo);
+    if (lo >= hi || first == NULL || first->key >= hi)
+    {
+        return 0;
+    }
+    subtree_t whole = {t->root, _black_height(t, t->root)};
+    subtree_t less, inside, greater;
+    _split(t, whole, lo, &less, &greater);
+    _split(t, greater, hi, &inside, &greater);
+    const size_t count = _free_subtree(t, inside.root);
+
+    t->root = _join2(t, less, greater).root;
+    if (t->root != NIL)
+    {
+        SET_COLOR(t->root, RBTREE_BLACK);
+    }
+    t->size -= count;
+    return count;
+}
+
+static size_t _left_size(const rbtree *t, uint32_t left, uint32_t right, const size_t total)
+{
+#ifdef RBTREE_ORDER_STAT
+    (void)right;
+    (void)total;
+    return NODE(left)->size;
+#else
+    uint32_t a = left == NIL ? NIL : _rbtree_min(t, left);
+    uint32_t b = right == NIL ? NIL : _rbtree_min(t, right);
+    size_t count = 0;
+    while (a != NIL && b != NIL)
+    {
+        a = _next_node(t, a);
+        b = _next_node(t, b);
+        count++;
+    }
+    return a == NIL ? count : total - count;
+#endif
+}
+
+// 떼어 낸 subtree 의 key 를 순서대로 out 에 씀
+static void _subtree_keys(const rbtree *t, uint32_t root, key_t *out)
+{
+    for (uint32_t cur = root == NIL ? NIL : _rbtree_min(t, root); cur != NIL; cur = _next_node(t, cur))
+    {
+        *out++ = KEY(cur);
+    }
+}
+
+/*
+split / join
+link 가 tree 마다 따로인 배열의 index 라 node 를 다른 tree 로 그대로 옮길 수 없다.
+t 안에서 O(log n) 으로 나눈 뒤 작은 쪽만 새 배열로 복사하고 (O(log n + 작은 쪽)),
+join 은 작은 쪽을 큰 쪽 배열 끝에 복사해 붙인다.
+*/
+void rbtree_split(rbtree *t, const key_t key, rbtree **left, rbtree **right)
+{
+    subtree_t less, rest;
+    _split(t, (subtree_t){t->root, _black_height(t, t->root)}, key, &less, &rest);
+    less = _blacken(t, less);
+    rest = _blacken(t, rest);
+    const size_t leftSize = _left_size(t, less.root, rest.root, t->size);
+
+    // 작은 쪽을 복사해 나가고 t 에는 큰 쪽이 남음
+    const bool moveLeft = leftSize < t->size - leftSize;
+    const subtree_t moved = moveLeft ? less : rest;
+    const size_t n = moveLeft ? leftSize : t->size - leftSize;
+    key_t *keys = malloc((n + 1) * sizeof(key_t));
+    rbtree *copy = NULL;
+    if (keys != NULL)
+    {
+        _subtree_keys(t, moved.root, keys);
+        copy = rbtree_from_sorted_array(keys, n);
+        free(keys);
+    }
+    if (copy == NULL)
+    {
+        // 옮길 자리를 만들지 못하면 두 조각을 다시 붙여 t 를 그대로 둠 (node 는 같은 배열에 있음)
+        t->root = _blacken(t, _join2(t, less, rest)).root;
+        *left = *right = NULL;
+        return;
+    }
+    _free_subtree(t, moved.root);
+
+    t->root = moveLeft ? rest.root : less.root;
+    t->size -= n;
+    *left = moveLeft ? copy : t;
+    *right = moveLeft ? t : copy;
+}
+
+rbtree *rbtree_join(rbtree *left, const key_t pivot, rbtree *right)
+{
+    const node_t *max = rbtree_max(left), *min = rbtree_min(right);
+    if ((max != NULL && max->key > pivot) || (min != NULL && min->key < pivot))
+    {
+        return NULL;
+    }
+    rbtree *t = left, *other = right;
+    if (left->size < right->size)
+    {
+        t = right;
+        other = left;
+    }
+    // other 의 node 와 pivot 이 들어갈 자리를 한 번에 늘려 둠
+    const size_t n = other->size;
+    if ((size_t)t->used + n + 1 > t->cap && !_grow(t, (size_t)t->used + n + 1))
+    {
+        return NULL;
+    }
+    key_t *keys = malloc((n + 1) * sizeof(key_t));
+    if (keys == NULL)
+    {
+        return NULL;
+    }
+    _subtree_keys(other, other->root, keys);
+    const uint32_t base = t->used;
+    t->used += (uint32_t)n;
+    uint32_t root = _build_sorted(t, base, keys, 0, n, 0, _red_depth(n), NIL);
+    free(keys);
+    subtree_t moved = {root, _black_height(t, root)};
+    subtree_t kept = {t->root, _black_height(t, t->root)};
+
+    uint32_t p = _alloc_node(t);
+    KEY(p) = pivot;
+    subtree_t joined = t == left ? _join(t, kept, p, moved) : _join(t, moved, p, kept);
+    t->root = _blacken(t, joined).root;
+    t->size += n + 1;
+    delete_rbtree(other);
+    return t;
+}
+
+/*
+집합 연산 (union / intersection / difference)
+rbtree.c 의 join 기반 분할 정복은 node 를 새 tree 로 옮겨 붙이지만 여기서는 배열 index 라 그럴 수 없다.
+두 tree 의 key 를 순서대로 꺼내 한 번 병합하고 (같은 key 는 하나만), 결과를 rbtree_from_sorted_array 로 만든다.
+O(n + m) 이며 thread 로 나누지 않는다.
+*/
+static rbtree *_set_operation(const rbtree *a, const rbtree *b, bool aOnly, bool bOnly, bool both)
+{
+    key_t *ka = malloc((a->size + 1) * sizeof(key_t));
+    key_t *kb = malloc((b->size + 1) * sizeof(key_t));
+    key_t *out = malloc((a->size + b->size + 1) * sizeof(key_t));
+    if (ka == NULL || kb == NULL || out == NULL)
+    {
+        free(out);
+        free(kb);
+        free(ka);
+        return NULL;
+    }
+    _subtree_keys(a, a->root, ka);
+    _subtree_keys(b, b->root, kb);
+    size_t i = 0, j = 0, count = 0;
+    while (i < a->size || j < b->size)
+    {
+        key_t key;
+        bool keep;
+        if (j == b->size || (i < a->size && ka[i] < kb[j]))
+        {
+            key = ka[i];
+            keep = aOnly;
+        }
+        else if (i == a->size || kb[j] < ka[i])
+        {
+            key = kb[j];
+            keep = bOnly;
+        }
+        else
+        {
+            key = ka[i];
+            keep = both;
+        }
+        // 양쪽에서 이 key 를 모두 건너뜀 (중복 포함)
+        while (i < a->size && ka[i] == key)
+        {
+            i++;
+        }
+        while (j < b->size && kb[j] == key)
+        {
+            j++;
+        }
+        if (keep)
+        {
+            out[count++] = key;
+        }
+    }
+    rbtree *t = rbtree_from_sorted_array(out, count);
+    free(out);
+    free(kb);
+    free(ka);
+    return t;
+}
+
+rbtree *rbtree_union(const rbtree *a, const rbtree *b)
+{
+    return _set_operation(a, b, true, true, true);
+}
+
+rbtree *rbtree_intersection(const rbtree *a, const rbtree *b)
+{
+    return _set_operation(a, b, false, false, true);
+}
+
+rbtree *rbtree_difference(const rbtree *a, const rbtree *b)
+{
+    return _set_operation(a, b, true, false, false);
+}
+
+size_t rbtree_range_to_array(const rbtree *t, const key_t lo, const key_t hi, key_t *out, const size_t cap)
+{
+    size_t count = 0;
+    if (cap == 0 || lo >= hi)
+    {
+        return 0;
+    }
+    node_t *cur = rbtree_lower_bound(t, lo);
+    uint32_t idx = cur == NULL ? NIL : INDEX_OF(cur);
+    while (idx != NIL && KEY(idx) < hi && count < cap)
+    {
+        out[count++] = KEY(idx);
+        idx = _next_node(t, idx);
+    }
+    return count;
+}
+
+size_t rbtree_size(const rbtree *t)
+{
+    return t->size;
+}
+
+static int _depth_stats(const rbtree *t, const uint32_t node, const size_t depth, size_t *count, double *depthSum)
+{
+    if (node == NIL)
+    {
+        return 0;
+    }
+    (*count)++;
+    *depthSum += depth;
+    const int left = _depth_stats(t, LEFT(node), depth + 1, count, depthSum);
+    const int right = _depth_stats(t, RIGHT(node), depth + 1, count, depthSum);
+    return 1 + (left > right ? left : right);
+}
+
+// 구조만 잰다. 연산 counter (-DRBTREE_STATS) 는 pointer engine 에만 있으므로 ops 는 0
+void rbtree_stats(const rbtree *t, rbtree_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    double depthSum = 0;
+    out->height = _depth_stats(t, t->root, 0, &out->nodes, &depthSum);
+    out->black_height = _black_height(t, t->root);
+    out->avg_depth = out->nodes > 0 ? depthSum / out->nodes : 0;
+}
+
+#ifdef RBTREE_ORDER_STAT
+node_t *rbtree_select(const rbtree *t, size_t k)
+{
+    uint32_t cur = t->root;
+    while (cur != NIL)
+    {
+        size_t leftSize = NODE(LEFT(cur))->size;
+        if (k == leftSize)
+        {
+            return NODE(cur);
+        }
+        if (k < leftSize)
+        {
+            cur = LEFT(cur);
+        }
+        else
+        {
+            k -= leftSize + 1;
+            cur = RIGHT(cur);
+        }
+    }
+    return NULL;
+}
+
+size_t rbtree_rank(const rbtree *t, const key_t key)
+{
+    size_t rank = 0;
+    uint32_t cur = t->root;
+    while (cur != NIL)
+    {
+        if (KEY(cur) >= key)
+        {
+            cur = LEFT(cur);
+        }
+        else
+        {
+            rank += NODE(LEFT(cur))->size + 1;
+            cur = RIGHT(cur);
+        }
+    }
+    return rank;
+}
+#endif
@@ -0,0 +1,125 @@
+#include "rbtree_io.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+파일 형식
+[header 24 byte][key_t * count]
+key 는 in-order 순서 (중복 포함) 이며 header 바로 뒤부터 정렬 (4 byte) 에 맞게 놓인다.
+byteOrder 에 BYTE_ORDER_MARK 를 그대로 써 두어 다른 byte order 에서 만든 파일을 알아본다.
+*/
+#define IMAGE_MAGIC "RBTIMG01"
+#define BYTE_ORDER_MARK 0x01020304u
+
+typedef struct
+{
+    char magic[8];
+    uint32_t keySize;
+    uint32_t byteOrder;
+    uint64_t count;
+} image_header_t;
+
+// 저장할 때 key 를 모아 쓰는 단위
+#define SAVE_CHUNK 65536
+
+static int _write_chunk(const key_t *keys, size_t n, void *f)
+{
+    return fwrite(keys, sizeof(key_t), n, f) == n ? 0 : -1;
+}
+
+int rbtree_save(const rbtree *t, const char *path)
+{
+    const size_t len = strlen(path);
+    char *tmp = malloc(len + 5);
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, ".tmp", 5);
+    FILE *f = fopen(tmp, "wb");
+    if (f == NULL)
+    {
+        free(tmp);
+        return -1;
+    }
+
+    image_header_t header = {IMAGE_MAGIC, sizeof(key_t), BYTE_ORDER_MARK, rbtree_size(t)};
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    key_t *chunk = malloc(SAVE_CHUNK * sizeof(key_t));
+    ok = ok && rbtree_export(t, chunk, SAVE_CHUNK, _write_chunk, f) == 0;
+    free(chunk);
+    // rename 전에 내용이 디스크에 닿아야 새 이름이 잘린 파일을 가리키지 않음
+    ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok)
+    {
+        const int err = errno;
+        unlink(tmp);
+        errno = err;
+    }
+    free(tmp);
+    return ok ? 0 : -1;
+}
+
+// header 와 크기가 맞고 key 가 정렬되어 있으면 key 배열, 아니면 NULL
+static const key_t *_image_keys(const void *image, const size_t size, size_t *count)
+{
+    const image_header_t *header = image;
+    if (size < sizeof(image_header_t) || memcmp(header->magic, IMAGE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->keySize != sizeof(key_t) || header->byteOrder != BYTE_ORDER_MARK ||
+        header->count != (size - sizeof(image_header_t)) / sizeof(key_t) ||
+        (size - sizeof(image_header_t)) % sizeof(key_t) != 0)
+    {
+        return NULL;
+    }
+    const key_t *keys = (const key_t *)(header + 1);
+    for (size_t i = 1; i < header->count; i++)
+    {
+        if (keys[i - 1] > keys[i])
+        {
+            return NULL;
+        }
+    }
+    *count = header->count;
+    return keys;
+}
+
+rbtree *rbtree_load(const char *path)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(image_header_t))
+    {
+        close(fd);
+        return NULL;
+    }
+    const size_t size = (size_t)st.st_size;
+    void *image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED)
+    {
+        return NULL;
+    }
+    // 앞에서부터 한 번 읽고 끝나므로 미리 읽어 들이고 읽은 page 는 바로 놓아도 됨
+    madvise(image, size, MADV_SEQUENTIAL);
+
+    rbtree *t = NULL;
+    size_t count;
+    const key_t *keys = _image_keys(image, size, &count);
+    if (keys != NULL)
+    {
+        t = rbtree_from_sorted_array(keys, count);
+    }
+    munmap(image, size);
+    return t;
+}
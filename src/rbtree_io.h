@@ -0,0 +1,18 @@
+#ifndef _RBTREE_IO_H_
+#define _RBTREE_IO_H_
+
+#include "rbtree.h"
+
+// tree 를 파일로 저장 / 복원 (src/rbtree_io.c)
+// 파일에는 포인터 없이 header 와 정렬된 key 만 쓴다. (node 배치, 색은 저장하지 않음)
+// 읽을 때는 mmap 한 key 를 rbtree_from_sorted_array 로 한 번에 엮으므로 node 마다 할당하거나
+// 회전하지 않는다. 시간은 파일을 한 번 읽는 것과 node 를 순서대로 채우는 것에 비례한다.
+// 같은 key_t 크기와 byte order 로 만든 파일만 읽는다. (engine 은 달라도 됨)
+
+// path 에 저장. 같은 디렉터리의 임시 파일에 다 쓴 뒤 rename 하므로 중간에 죽어도 예전 파일은 그대로.
+// 성공하면 0, 실패하면 -1 (errno 유지)
+int rbtree_save(const rbtree *, const char *path);
+// 실패하면 (없는 파일, 형식이 다르거나 잘린 파일) NULL
+rbtree *rbtree_load(const char *path);
+
+#endif  // _RBTREE_IO_H_
@@ -0,0 +1,363 @@
+#include "rbtree_persistent.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*
+버전 공유
+link (부모의 left / right, 버전의 root) 하나가 node 의 refs 하나다. 어떤 node 가 지금 고치는 버전에서만
+보이려면 루트부터 그 node 까지 모든 node 의 refs 가 1 이어야 한다. 그래서 수정은 항상 루트부터 내려가며
+_own 으로 자기 것으로 만든 node 만 고친다. 공유된 node 를 복사하면 복사본이 두 자식을 새로 가리키므로
+자식들의 refs 가 늘어, 그 아래로 내려갈 때 다시 복사된다.
+회전은 link 를 옮길 뿐 link 수를 바꾸지 않으므로 refs 를 건드리지 않는다.
+
+refs 는 다른 thread 가 snapshot 을 놓으며 줄일 수 있으므로 atomic 으로 다룬다.
+늘리는 쪽은 그 node 가 보이는 버전을 가진 thread 뿐이라 늘어나는 중에 1 로 보일 일은 없다.
+(1 이 아닌데 1 로 보이면 다른 버전이 보는 node 를 고치게 된다)
+놓는 쪽은 release, 1 인지 보는 쪽은 acquire 라, 다른 thread 가 마지막으로 읽은 뒤에야 고치거나 해제한다.
+
+node 는 버전마다 따로 해제되므로 pool 없이 node 마다 malloc 한다.
+*/
+
+// 2^64 개 node 의 red-black tree 도 높이는 128 을 넘지 않는다
+#define MAX_HEIGHT 128
+
+static pnode_t *_retain(pnode_t *node)
+{
+    if (node != NULL)
+    {
+        __atomic_fetch_add(&node->refs, 1, __ATOMIC_RELAXED);
+    }
+    return node;
+}
+
+// link 하나를 놓음. 마지막 link 였으면 해제하고 자식도 놓음
+static void _release(pnode_t *node)
+{
+    while (node != NULL && __atomic_sub_fetch(&node->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        _release(node->left);
+        pnode_t *right = node->right;
+        free(node);
+        node = right;
+    }
+}
+
+// *link 가 가리키는 node 를 이 버전만의 것으로 만들어 돌려줌 (*link 를 가진 node 는 이미 자기 것이어야 함)
+static pnode_t *_own(pnode_t **link)
+{
+    pnode_t *node = *link;
+    if (__atomic_load_n(&node->refs, __ATOMIC_ACQUIRE) == 1)
+    {
+        return node;
+    }
+    // refs 는 다른 thread 가 줄이는 중일 수 있으므로 통째로 복사하지 않음
+    pnode_t *copy = (pnode_t *)malloc(sizeof(pnode_t));
+    *copy = (pnode_t){node->key, node->color, 1, _retain(node->left), _retain(node->right)};
+    _release(node);
+    *link = copy;
+    return copy;
+}
+
+static bool _is_red(const pnode_t *node)
+{
+    return node != NULL && node->color == RBTREE_RED;
+}
+
+persistent_rbtree *new_persistent_rbtree(void)
+{
+    return (persistent_rbtree *)calloc(1, sizeof(persistent_rbtree));
+}
+
+void delete_persistent_rbtree(persistent_rbtree *t)
+{
+    _release(t->root);
+    free(t);
+}
+
+persistent_rbtree *persistent_rbtree_snapshot(const persistent_rbtree *t)
+{
+    persistent_rbtree *snap = new_persistent_rbtree();
+    snap->root = _retain(t->root);
+    snap->size = t->size;
+    return snap;
+}
+
+/*
+parent 대신 루트부터의 경로 path[0 .. depth] 로 부모를 찾는다. path 의 node 는 모두 자기 것이다.
+path[i] 를 가리키는 link : 루트면 t->root, 아니면 path[i - 1] 의 자식 칸
+*/
+static pnode_t **_link(persistent_rbtree *t, pnode_t **path, const int i)
+{
+    if (i == 0)
+    {
+        return &t->root;
+    }
+    return path[i - 1]->left == path[i] ? &path[i - 1]->left : &path[i - 1]->right;
+}
+
+// path[i] 를 회전해 (isLeft 면 오른쪽 자식이) 그 자리로 올림. 올라오는 자식은 자기 것이어야 함
+static void _rotate(persistent_rbtree *t, pnode_t **path, const int i, const bool isLeft)
+{
+    pnode_t **link = _link(t, path, i);
+    pnode_t *node = path[i];
+    pnode_t *child;
+    if (isLeft)
+    {
+        child = node->right;
+        node->right = child->left;
+        child->left = node;
+    }
+    else
+    {
+        child = node->left;
+        node->left = child->right;
+        child->right = node;
+    }
+    *link = child;
+}
+
+void persistent_rbtree_insert(persistent_rbtree *t, const key_t key)
+{
+    pnode_t *path[MAX_HEIGHT + 1];
+    int depth = 0;
+    pnode_t **link = &t->root;
+    // 같은 key 는 오른쪽으로 (rbtree_insert 처럼 중복 허용)
+    while (*link != NULL)
+    {
+        pnode_t *node = _own(link);
+        path[depth++] = node;
+        link = key < node->key ? &node->left : &node->right;
+    }
+    pnode_t *newNode = (pnode_t *)malloc(sizeof(pnode_t));
+    *newNode = (pnode_t){key, RBTREE_RED, 1, NULL, NULL};
+    *link = newNode;
+    path[depth] = newNode;
+    t->size++;
+
+    // path[i] 가 red 이고 부모도 red 인 동안
+    int i = depth;
+    while (i >= 2 && _is_red(path[i - 1]))
+    {
+        pnode_t *parent = path[i - 1], *grand = path[i - 2];
+        const bool parentIsLeft = grand->left == parent;
+        pnode_t **uncleLink = parentIsLeft ? &grand->right : &grand->left;
+        if (_is_red(*uncleLink))
+        {
+            // 색만 바꾸고 grand 에서 다시
+            _own(uncleLink)->color = RBTREE_BLACK;
+            parent->color = RBTREE_BLACK;
+            grand->color = RBTREE_RED;
+            i -= 2;
+            continue;
+        }
+        // 안쪽 자식이면 parent 를 돌려 바깥쪽으로 펴고 둘의 역할을 바꿈
+        if ((parent->left == path[i]) != parentIsLeft)
+        {
+            _rotate(t, path, i - 1, parentIsLeft);
+            parent = path[i];
+        }
+        _rotate(t, path, i - 2, !parentIsLeft);
+        parent->color = RBTREE_BLACK;
+        grand->color = RBTREE_RED;
+        break;
+    }
+    t->root->color = RBTREE_BLACK;
+}
+
+/*
+path[i] 쪽 (isLeft 면 왼쪽) 자식 자리의 black 이 하나 모자람 (double black)
+rbtree_erase 의 fixup 과 같은 경우 나눔이며, 고치는 형제와 조카는 먼저 자기 것으로 만든다.
+회전으로 path[i] 가 한 칸 내려가면 path 를 고쳐 둔다.
+*/
+static void _erase_fixup(persistent_rbtree *t, pnode_t **path, int i, bool isLeft)
+{
+    while (i >= 0)
+    {
+        pnode_t *parent = path[i];
+        pnode_t **siblingLink = isLeft ? &parent->right : &parent->left;
+        pnode_t *sibling = _own(siblingLink);
+        // 1) 형제가 red : parent 를 돌려 black 형제를 만듦
+        if (sibling->color == RBTREE_RED)
+        {
+            sibling->color = RBTREE_BLACK;
+            parent->color = RBTREE_RED;
+            _rotate(t, path, i, isLeft);
+            path[i] = sibling;
+            path[++i] = parent;
+            sibling = _own(siblingLink);
+        }
+        pnode_t **nearLink = isLeft ? &sibling->left : &sibling->right;
+        pnode_t **farLink = isLeft ? &sibling->right : &sibling->left;
+        // 2) 조카가 둘 다 black : 형제를 red 로 하고 모자란 black 을 parent 로 올림
+        if (!_is_red(*nearLink) && !_is_red(*farLink))
+        {
+            sibling->color = RBTREE_RED;
+            if (parent->color == RBTREE_RED)
+            {
+                parent->color = RBTREE_BLACK;
+                return;
+            }
+            if (--i >= 0)
+            {
+                isLeft = path[i]->left == parent;
+            }
+            continue;
+        }
+        // 3) 먼 조카가 black : 형제를 돌려 먼 조카를 red 로
+        if (!_is_red(*farLink))
+        {
+            pnode_t *near = _own(nearLink);
+            near->color = RBTREE_BLACK;
+            sibling->color = RBTREE_RED;
+            *siblingLink = near;
+            if (isLeft)
+            {
+                sibling->left = near->right;
+                near->right = sibling;
+            }
+            else
+            {
+                sibling->right = near->left;
+                near->left = sibling;
+            }
+            sibling = near;
+            farLink = isLeft ? &sibling->right : &sibling->left;
+        }
+        // 4) 먼 조카가 red : parent 를 돌리고 색을 옮기면 끝
+        _own(farLink)->color = RBTREE_BLACK;
+        sibling->color = parent->color;
+        parent->color = RBTREE_BLACK;
+        _rotate(t, path, i, isLeft);
+        return;
+    }
+}
+
+int persistent_rbtree_erase(persistent_rbtree *t, const key_t key)
+{
+    if (!persistent_rbtree_find(t, key))
+    {
+        // 없는 key 로 경로를 복사하지 않도록
+        return -1;
+    }
+    pnode_t *path[MAX_HEIGHT + 1];
+    int depth = 0;
+    pnode_t **link = &t->root;
+    pnode_t *target = NULL;
+    while (target == NULL)
+    {
+        pnode_t *node = _own(link);
+        path[depth++] = node;
+        if (node->key == key)
+        {
+            target = node;
+        }
+        else
+        {
+            link = key < node->key ? &node->left : &node->right;
+        }
+    }
+    // 자식이 둘이면 successor 의 key 를 가져오고 successor 자리를 지움
+    if (target->left != NULL && target->right != NULL)
+    {
+        link = &target->right;
+        while (true)
+        {
+            pnode_t *node = _own(link);
+            path[depth++] = node;
+            if (node->left == NULL)
+            {
+                break;
+            }
+            link = &node->left;
+        }
+        target->key = path[depth - 1]->key;
+    }
+
+    // 지울 node 는 자식이 하나 이하 : 그 자식을 부모 자리로 올림 (link 를 옮기므로 refs 는 그대로)
+    pnode_t *victim = path[--depth];
+    pnode_t *child = victim->left != NULL ? victim->left : victim->right;
+    const bool isLeft = depth > 0 && path[depth - 1]->left == victim;
+    pnode_t **childLink = _link(t, path, depth);
+    *childLink = child;
+    const color_t removed = victim->color;
+    free(victim);
+    t->size--;
+
+    if (removed == RBTREE_BLACK)
+    {
+        if (_is_red(child))
+        {
+            _own(childLink)->color = RBTREE_BLACK;
+        }
+        else
+        {
+            _erase_fixup(t, path, depth - 1, isLeft);
+        }
+    }
+    if (t->root != NULL)
+    {
+        t->root->color = RBTREE_BLACK;
+    }
+    return 0;
+}
+
+int persistent_rbtree_find(const persistent_rbtree *t, const key_t key)
+{
+    const pnode_t *cur = t->root;
+    while (cur != NULL && cur->key != key)
+    {
+        cur = key < cur->key ? cur->left : cur->right;
+    }
+    return cur != NULL;
+}
+
+static int _edge(const persistent_rbtree *t, const bool isRight, key_t *out)
+{
+    const pnode_t *cur = t->root;
+    if (cur == NULL)
+    {
+        return -1;
+    }
+    while ((isRight ? cur->right : cur->left) != NULL)
+    {
+        cur = isRight ? cur->right : cur->left;
+    }
+    *out = cur->key;
+    return 0;
+}
+
+int persistent_rbtree_min(const persistent_rbtree *t, key_t *out)
+{
+    return _edge(t, false, out);
+}
+
+int persistent_rbtree_max(const persistent_rbtree *t, key_t *out)
+{
+    return _edge(t, true, out);
+}
+
+size_t persistent_rbtree_size(const persistent_rbtree *t)
+{
+    return t->size;
+}
+
+// parent 가 없으므로 경로를 stack 에 쌓으며 중위 순회
+int persistent_rbtree_to_array(const persistent_rbtree *t, key_t *arr, const size_t n)
+{
+    const pnode_t *stack[MAX_HEIGHT];
+    int top = 0;
+    size_t index = 0;
+    const pnode_t *cur = t->root;
+    while (index < n && (cur != NULL || top > 0))
+    {
+        while (cur != NULL)
+        {
+            stack[top++] = cur;
+            cur = cur->left;
+        }
+        cur = stack[--top];
+        arr[index++] = cur->key;
+        cur = cur->right;
+    }
+    return index != n;
+}
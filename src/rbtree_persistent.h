@@ -0,0 +1,47 @@
+#ifndef _RBTREE_PERSISTENT_H_
+#define _RBTREE_PERSISTENT_H_
+
+#include <stddef.h>
+
+#include "rbtree.h"
+
+// 버전을 남기는 rbtree (src/rbtree_persistent.c)
+// insert / erase 는 node 를 고치지 않고 루트부터 바뀌는 경로만 복사해 새 버전을 만든다. (path copying)
+// snapshot 은 루트를 공유하는 handle 을 하나 더 만들 뿐이라 O(1) 이고, 이후 원래 tree 를 고쳐도 바뀌지 않는다.
+// node 는 자신을 가리키는 link 수를 세어 마지막 버전이 놓을 때 해제된다.
+// 다른 버전과 공유하지 않는 (참조가 하나뿐인) node 는 복사하지 않고 그 자리에서 고친다.
+//
+// 한 handle 은 한 thread 만 쓴다. snapshot 을 떠서 다른 thread 에 넘기면 그 thread 는 lock 없이 읽고,
+// 다 쓰면 어느 thread 에서든 delete_persistent_rbtree 로 놓는다.
+// parent 를 따라 올라갈 수 없어 (공유된 node 는 parent 가 여럿) node 대신 key 로 주고받는다.
+typedef struct pnode_t {
+  key_t key;
+  color_t color;
+  unsigned int refs;  // 이 node 를 가리키는 link (부모 node 또는 버전의 루트) 수
+  struct pnode_t *left, *right;
+} pnode_t;
+
+typedef struct {
+  pnode_t *root;  // 빈 tree 면 NULL
+  size_t size;
+} persistent_rbtree;
+
+persistent_rbtree *new_persistent_rbtree(void);
+void delete_persistent_rbtree(persistent_rbtree *);
+
+// t 의 지금 내용을 가진 새 handle (O(1))
+persistent_rbtree *persistent_rbtree_snapshot(const persistent_rbtree *);
+
+void persistent_rbtree_insert(persistent_rbtree *, const key_t);
+// key 하나를 지우면 0, 없으면 -1
+int persistent_rbtree_erase(persistent_rbtree *, const key_t);
+
+// 있으면 1, 없으면 0
+int persistent_rbtree_find(const persistent_rbtree *, const key_t);
+// 비어 있지 않으면 *out 에 담고 0, 비어 있으면 -1
+int persistent_rbtree_min(const persistent_rbtree *, key_t *out);
+int persistent_rbtree_max(const persistent_rbtree *, key_t *out);
+size_t persistent_rbtree_size(const persistent_rbtree *);
+int persistent_rbtree_to_array(const persistent_rbtree *, key_t *, const size_t);
+
+#endif  // _RBTREE_PERSISTENT_H_
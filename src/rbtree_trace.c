@@ -0,0 +1,196 @@
+#include "rbtree_trace.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+파일 형식
+[header 24 byte][rbtree_trace_rec_t * count]
+record 는 op 1 byte 와 key 를 빈틈 없이 붙인 5 byte 이다. (정렬을 맞추면 8 byte 라 trace 가 1.6 배 커짐)
+header 는 rbtree_io.c 의 image 와 같은 모양이고 magic 만 다르다.
+*/
+#define TRACE_MAGIC "RBTRACE1"
+#define BYTE_ORDER_MARK 0x01020304u
+
+typedef struct
+{
+    char magic[8];
+    uint32_t keySize;
+    uint32_t byteOrder;
+    uint64_t count;
+} trace_header_t;
+
+int rbtree_trace_save(const char *path, const rbtree_trace_rec_t *recs, const size_t count)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL)
+    {
+        return -1;
+    }
+    trace_header_t header = {TRACE_MAGIC, sizeof(key_t), BYTE_ORDER_MARK, count};
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    ok = ok && fwrite(recs, sizeof(rbtree_trace_rec_t), count, f) == count;
+    ok = fclose(f) == 0 && ok;
+    if (!ok)
+    {
+        const int err = errno;
+        remove(path);
+        errno = err;
+    }
+    return ok ? 0 : -1;
+}
+
+rbtree_trace_rec_t *rbtree_trace_load(const char *path, size_t *count)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return NULL;
+    }
+    trace_header_t header;
+    rbtree_trace_rec_t *recs = NULL;
+    if (fread(&header, sizeof(header), 1, f) == 1 && memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) == 0 &&
+        header.keySize == sizeof(key_t) && header.byteOrder == BYTE_ORDER_MARK &&
+        header.count <= SIZE_MAX / sizeof(rbtree_trace_rec_t))
+    {
+        const size_t n = (size_t)header.count;
+        recs = malloc(n * sizeof(rbtree_trace_rec_t) + 1);
+        // 잘린 파일도, 뒤에 뭔가 더 붙은 파일도 받지 않음
+        bool ok = recs != NULL && fread(recs, sizeof(rbtree_trace_rec_t), n, f) == n && fgetc(f) == EOF;
+        for (size_t i = 0; ok && i < n; i++)
+        {
+            ok = recs[i].op < RBTREE_TRACE_OPS;
+        }
+        if (ok)
+        {
+            *count = n;
+        }
+        else
+        {
+            free(recs);
+            recs = NULL;
+        }
+    }
+    fclose(f);
+    return recs;
+}
+
+/*
+기록기
+thread 마다 buffer 를 하나씩 두고 lock 없이 record 를 쌓다가, 가득 차면 lock 을 잡고 파일에 쓴다.
+그래서 파일 안의 순서는 thread 안에서는 호출 순서 그대로이고 thread 끼리는 buffer 단위로 섞인다.
+buffer 는 기록마다 _buffers 에 엮어 두었다가 stop 에서 남은 것을 쓰고 해제한다.
+thread 는 자기 buffer 가 몇 번째 기록의 것인지 (_mineSession) 보고, 지난 기록의 것이면 새로 만든다.
+*/
+#define TRACE_BUFFER 4096
+
+typedef struct trace_buffer_t
+{
+    struct trace_buffer_t *next;
+    size_t used;
+    rbtree_trace_rec_t recs[TRACE_BUFFER];
+} trace_buffer_t;
+
+static pthread_mutex_t _lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *_file;
+static uint64_t _count;
+static bool _failed;
+static trace_buffer_t *_buffers;
+static unsigned int _sessions;  // 지금까지 시작한 기록 수
+static unsigned int _active;    // 기록 중이면 그 기록의 번호, 아니면 0
+
+static __thread trace_buffer_t *_mine;
+static __thread unsigned int _mineSession;
+
+// _lock 을 잡은 채로 부름
+static void _flush(trace_buffer_t *buf)
+{
+    if (fwrite(buf->recs, sizeof(rbtree_trace_rec_t), buf->used, _file) != buf->used)
+    {
+        _failed = true;
+    }
+    _count += buf->used;
+    buf->used = 0;
+}
+
+int rbtree_trace_start(const char *path)
+{
+    pthread_mutex_lock(&_lock);
+    if (_file != NULL)
+    {
+        pthread_mutex_unlock(&_lock);
+        errno = EBUSY;
+        return -1;
+    }
+    _file = fopen(path, "wb");
+    if (_file == NULL)
+    {
+        pthread_mutex_unlock(&_lock);
+        return -1;
+    }
+    // 개수는 stop 에서 고쳐 씀
+    trace_header_t header = {TRACE_MAGIC, sizeof(key_t), BYTE_ORDER_MARK, 0};
+    _failed = fwrite(&header, sizeof(header), 1, _file) != 1;
+    _count = 0;
+    _sessions++;
+    __atomic_store_n(&_active, _sessions, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&_lock);
+    return 0;
+}
+
+void rbtree_trace_record(const rbtree_trace_op_t op, const key_t key)
+{
+    const unsigned int session = __atomic_load_n(&_active, __ATOMIC_ACQUIRE);
+    if (session == 0)
+    {
+        return;
+    }
+    trace_buffer_t *buf = _mine;
+    if (_mineSession != session)
+    {
+        buf = malloc(sizeof(trace_buffer_t));
+        buf->used = 0;
+        pthread_mutex_lock(&_lock);
+        buf->next = _buffers;
+        _buffers = buf;
+        pthread_mutex_unlock(&_lock);
+        _mine = buf;
+        _mineSession = session;
+    }
+    buf->recs[buf->used].op = (uint8_t)op;
+    buf->recs[buf->used].key = key;
+    if (++buf->used == TRACE_BUFFER)
+    {
+        pthread_mutex_lock(&_lock);
+        _flush(buf);
+        pthread_mutex_unlock(&_lock);
+    }
+}
+
+int rbtree_trace_stop(void)
+{
+    pthread_mutex_lock(&_lock);
+    if (_file == NULL)
+    {
+        pthread_mutex_unlock(&_lock);
+        errno = EINVAL;
+        return -1;
+    }
+    __atomic_store_n(&_active, 0, __ATOMIC_RELEASE);
+    while (_buffers != NULL)
+    {
+        trace_buffer_t *buf = _buffers;
+        _buffers = buf->next;
+        _flush(buf);
+        free(buf);
+    }
+    trace_header_t header = {TRACE_MAGIC, sizeof(key_t), BYTE_ORDER_MARK, _count};
+    bool ok = !_failed && fseek(_file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, _file) == 1;
+    ok = fclose(_file) == 0 && ok;
+    _file = NULL;
+    pthread_mutex_unlock(&_lock);
+    return ok ? 0 : -1;
+}
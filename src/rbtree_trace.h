@@ -0,0 +1,42 @@
+#ifndef _RBTREE_TRACE_H_
+#define _RBTREE_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rbtree.h"
+
+// workload trace : tree 에 들어간 연산열을 기록 / 저장 / 읽기 (src/rbtree_trace.c)
+// 같은 trace 를 여러 자료구조에 흘려 비교하거나 (bench/bench-compare.cpp) 운영에서 모은 key 흐름을 다시 돌린다.
+// 파일은 header 뒤에 연산 하나당 5 byte 의 record 가 이어진다. 같은 key_t 크기와 byte order 로 만든 파일만 읽는다.
+typedef enum {
+  RBTREE_TRACE_INSERT,
+  RBTREE_TRACE_FIND,
+  RBTREE_TRACE_ERASE,  // key 와 같은 node 하나를 지움 (없으면 그냥 넘어감)
+  RBTREE_TRACE_OPS
+} rbtree_trace_op_t;
+
+typedef struct {
+  uint8_t op;  // rbtree_trace_op_t
+  key_t key;
+} __attribute__((packed)) rbtree_trace_rec_t;
+
+// recs[0, count) 를 path 에 저장. 성공하면 0, 실패하면 -1 (errno 유지)
+int rbtree_trace_save(const char *path, const rbtree_trace_rec_t *recs, size_t count);
+// malloc 한 record 배열 (free 로 해제) 과 개수 *count
+// 실패하면 (없는 파일, 형식이 다르거나 잘린 파일, 모르는 op) NULL
+rbtree_trace_rec_t *rbtree_trace_load(const char *path, size_t *count);
+
+// 기록 : -DRBTREE_TRACE 로 build 한 engine 은 rbtree_insert / rbtree_find / rbtree_erase 마다
+// rbtree_trace_record 를 부르고, start 와 stop 사이의 호출이 파일에 쌓인다. (기록 중이 아니면 load 하나로 끝)
+// 다른 API (batch, range, split / join, set 연산) 는 기록하지 않는다. 그 안에서 위 세 함수를 부르면 그것만 남는다.
+// record 는 thread 마다 buffer 에 쌓으므로 lock 을 잡지 않는다. 파일 안의 순서는 thread 안에서만 지켜진다.
+// start / stop 은 다른 thread 가 tree 를 쓰지 않을 때 부른다. 한 번에 하나만 기록한다.
+
+// 성공하면 0, 이미 기록 중이거나 파일을 못 열면 -1
+int rbtree_trace_start(const char *path);
+// 남은 record 를 쓰고 header 에 개수를 적어 닫음. 성공하면 0, 쓰다 실패했거나 기록 중이 아니면 -1
+int rbtree_trace_stop(void);
+void rbtree_trace_record(const rbtree_trace_op_t op, const key_t key);
+
+#endif  // _RBTREE_TRACE_H_
@@ -41,9 +41,9 @@ void draw_nil_info_svg(FILE *f, const node_t *nil, int x, int y) {
     }
     fprintf(f, "  <text x=\"%d\" y=\"%d\" font-size=\"14px\" font-weight=\"bold\" fill=\"black\">NIL Node Info:</text>\n",
             x + 10, y + 20);
-    char *font_color = nil != nil->parent ? "red" : "black";
+    char *font_color = nil != RBTREE_PARENT(nil) ? "red" : "black";
     fprintf(f, "  <text x=\"%d\" y=\"%d\" font-size=\"12px\" fill=\"%s\">Parent: %p</text>\n",
-            x + 10, y + 35, font_color, (void*)nil->parent);
+            x + 10, y + 35, font_color, (void*)RBTREE_PARENT(nil));
     font_color = nil != nil->left ? "red" : "black";
     fprintf(f, "  <text x=\"%d\" y=\"%d\" font-size=\"12px\" fill=\"%s\">Left: %p</text>\n",
             x + 10, y + 50, font_color, (void*)nil->left);
@@ -112,7 +112,7 @@ void draw_node_svg(FILE *f, const node_t *node, const node_t *nil,
     }
 
     // 노드 그리기
-    const char *fill_color = (node->color == RBTREE_RED) ? "red" : "black";
+    const char *fill_color = (RBTREE_COLOR(node) == RBTREE_RED) ? "red" : "black";
 
     fprintf(f, "  <circle cx=\"%d\" cy=\"%d\" r=\"%d\" fill=\"%s\" stroke=\"black\" stroke-width=\"2\" />\n",
             x, y, radius, fill_color);
@@ -148,7 +148,7 @@ void draw_node_detailed_svg(FILE *f, const node_t *node, const node_t *nil,
     }
 
     // 노드  그리기
-    const char *bg_color = (node->color == RBTREE_RED) ? "#ffe6e6" : "lightgray";
+    const char *bg_color = (RBTREE_COLOR(node) == RBTREE_RED) ? "#ffe6e6" : "lightgray";
 
     fprintf(f, "  <rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\" fill=\"%s\" "
                "stroke=\"black\" stroke-width=\"1\" rx=\"5\" />\n",
@@ -159,7 +159,7 @@ void draw_node_detailed_svg(FILE *f, const node_t *node, const node_t *nil,
 
     fprintf(f, "  <text x=\"%d\" y=\"%d\" text-anchor=\"middle\" font-size=\"12px\" "
                "font-weight=\"bold\" fill=\"%s\">Value: %d</text>\n",
-            x, text_y, (node->color == RBTREE_RED) ? "#cc0000" : "black", node->key);
+            x, text_y, (RBTREE_COLOR(node) == RBTREE_RED) ? "#cc0000" : "black", node->key);
 
     text_y += 12;
     fprintf(f, "  <text x=\"%d\" y=\"%d\" text-anchor=\"middle\" font-size=\"10px\" "
@@ -169,7 +169,7 @@ void draw_node_detailed_svg(FILE *f, const node_t *node, const node_t *nil,
     text_y += 12;
     fprintf(f, "  <text x=\"%d\" y=\"%d\" text-anchor=\"middle\" font-size=\"10px\" "
                "fill=\"black\">Parent: %p</text>\n",
-            x, text_y, (void*)node->parent);
+            x, text_y, (void*)RBTREE_PARENT(node));
 
     text_y += 12;
     fprintf(f, "  <text x=\"%d\" y=\"%d\" text-anchor=\"middle\" font-size=\"10px\" "
@@ -270,7 +270,7 @@ void print_node_color(const node_t *node, const node_t *nil) {
         return;
     }
 
-    if (node->color == RBTREE_RED) {
+    if (RBTREE_COLOR(node) == RBTREE_RED) {
         printf(ANSI_RED ANSI_BOLD "%2d" ANSI_RESET, node->key);
     } else {
         printf(ANSI_WHITE ANSI_BOLD "%2d" ANSI_RESET, node->key);
@@ -0,0 +1,175 @@
+// rbtree_generic.h 로 찍어낸 tree 검사 : 64bit key, 문자열 key, 두 필드 key
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RBT_NAME i64
+#define RBT_KEY int64_t
+#define RBT_VALUE int64_t
+#include <rbtree_generic.h>
+
+#define RBT_NAME str
+#define RBT_KEY const char *
+#define RBT_VALUE int
+#define RBT_CMP(a, b) strcmp((a), (b))
+#include <rbtree_generic.h>
+
+typedef struct {
+  int32_t year, id;
+} pair_t;
+
+// RBT_LESS 만 주면 같은지는 양쪽 RBT_LESS 로 판단
+#define RBT_NAME pair
+#define RBT_KEY pair_t
+#define RBT_LESS(a, b) ((a).year < (b).year || ((a).year == (b).year && (a).id < (b).id))
+#include <rbtree_generic.h>
+
+// 정렬 / parent 연결 / red-red 없음 / black height 를 한 번에 확인, black height 를 돌려줌
+static int i64_check(const i64_tree *t, const i64_node *p, const int64_t *lo, const int64_t *hi) {
+  if (p == t->nil) {
+    return 1;
+  }
+  assert(lo == NULL || *lo <= p->key);
+  assert(hi == NULL || p->key <= *hi);
+  assert(p->left == t->nil || p->left->parent == p);
+  assert(p->right == t->nil || p->right->parent == p);
+  if (p->color == RBTREE_RED) {
+    assert(p->left->color == RBTREE_BLACK && p->right->color == RBTREE_BLACK);
+  }
+  const int left = i64_check(t, p->left, lo, &p->key);
+  const int right = i64_check(t, p->right, &p->key, hi);
+  assert(left == right);
+  return left + (p->color == RBTREE_BLACK);
+}
+
+static int cmp_i64(const void *p1, const void *p2) {
+  const int64_t e1 = *(const int64_t *)p1;
+  const int64_t e2 = *(const int64_t *)p2;
+  return (e1 > e2) - (e1 < e2);
+}
+
+// 32bit 로는 담기지 않는 key 로 무작위 insert / erase 를 하며 매번 구조를 확인
+void test_i64_rand(const size_t n, const unsigned int seed) {
+  i64_tree *t = i64_new();
+  int64_t *keys = calloc(n, sizeof(int64_t));
+  srand(seed);
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = ((int64_t)rand() << 32 | rand()) % 1000 - 500 + ((int64_t)1 << 40);
+    i64_node *p = i64_insert(t, keys[i], keys[i] * 2);
+    assert(p->key == keys[i] && p->value == keys[i] * 2);
+  }
+  assert(i64_size(t) == n);
+  assert(t->root->color == RBTREE_BLACK);
+  i64_check(t, t->root, NULL, NULL);
+
+  // 순회 결과가 정렬된 key 와 같아야 함 (중복 포함)
+  qsort(keys, n, sizeof(int64_t), cmp_i64);
+  size_t i = 0;
+  for (i64_node *p = i64_min(t); p != NULL; p = i64_next(t, p)) {
+    assert(p->key == keys[i++]);
+  }
+  assert(i == n);
+  i = n;
+  for (i64_node *p = i64_max(t); p != NULL; p = i64_prev(t, p)) {
+    assert(p->key == keys[--i]);
+  }
+
+  // 절반을 지우고 남은 것은 그대로 찾아져야 함
+  for (i = 0; i < n; i += 2) {
+    i64_node *p = i64_find(t, keys[i]);
+    assert(p != NULL && p->key == keys[i] && p->value == keys[i] * 2);
+    i64_erase(t, p);
+    if (i % 64 == 0) {
+      i64_check(t, t->root, NULL, NULL);
+    }
+  }
+  assert(i64_size(t) == n / 2);
+  i64_check(t, t->root, NULL, NULL);
+  for (i = 1; i < n; i += 2) {
+    assert(i64_find(t, keys[i]) != NULL);
+  }
+  for (i = 1; i < n; i += 2) {
+    i64_erase(t, i64_find(t, keys[i]));
+  }
+  assert(i64_size(t) == 0 && t->root == t->nil && i64_min(t) == NULL);
+  free(keys);
+  i64_delete(t);
+}
+
+// put 은 같은 key 면 value 만 바꾸고, insert 는 중복을 허용
+void test_put_insert(void) {
+  i64_tree *t = i64_new();
+  i64_put(t, 7, 1);
+  i64_put(t, 7, 2);
+  assert(i64_size(t) == 1 && i64_find(t, 7)->value == 2);
+  i64_insert(t, 7, 3);
+  assert(i64_size(t) == 2);
+  i64_node *p = i64_lower_bound(t, 7);
+  assert(p != NULL && p->key == 7 && i64_next(t, p)->key == 7);
+  assert(i64_lower_bound(t, 8) == NULL);
+  i64_delete(t);
+}
+
+void test_string_keys(void) {
+  const char *words[] = {"pear", "apple", "fig", "banana", "kiwi", "cherry", "date", "grape"};
+  const size_t n = sizeof(words) / sizeof(words[0]);
+  str_tree *t = str_new();
+  for (size_t i = 0; i < n; i++) {
+    str_put(t, words[i], (int)i);
+  }
+  // 포인터가 달라도 내용으로 비교해야 함
+  char buf[16];
+  strcpy(buf, "kiwi");
+  str_node *p = str_find(t, buf);
+  assert(p != NULL && p->value == 4);
+  assert(str_find(t, "melon") == NULL);
+  assert(strcmp(str_lower_bound(t, "c")->key, "cherry") == 0);
+
+  const char *prev = NULL;
+  size_t count = 0;
+  for (p = str_min(t); p != NULL; p = str_next(t, p), count++) {
+    assert(prev == NULL || strcmp(prev, p->key) < 0);
+    prev = p->key;
+  }
+  assert(count == n);
+  str_erase(t, str_find(t, "apple"));
+  assert(strcmp(str_min(t)->key, "banana") == 0);
+  str_delete(t);
+}
+
+void test_composite_keys(void) {
+  pair_tree *t = pair_new();
+  for (int32_t year = 2024; year >= 2020; year--) {
+    for (int32_t id = 0; id < 100; id++) {
+      pair_insert(t, (pair_t){year, id * 7 % 100}, NULL);
+    }
+  }
+  assert(pair_size(t) == 500);
+  // year 가 먼저, 같으면 id 순
+  pair_node *p = pair_min(t);
+  assert(p->key.year == 2020 && p->key.id == 0);
+  p = pair_lower_bound(t, (pair_t){2022, 50});
+  assert(p->key.year == 2022 && p->key.id == 50);
+  p = pair_prev(t, pair_lower_bound(t, (pair_t){2023, 0}));
+  assert(p->key.year == 2022 && p->key.id == 99);
+  assert(pair_find(t, (pair_t){2021, 42}) != NULL);
+  assert(pair_find(t, (pair_t){2021, 100}) == NULL);
+  pair_erase(t, pair_find(t, (pair_t){2021, 42}));
+  assert(pair_find(t, (pair_t){2021, 42}) == NULL && pair_size(t) == 499);
+  pair_delete(t);
+}
+
+int main(void) {
+  test_i64_rand(10, 3);
+  printf("1\n");
+  test_i64_rand(20000, 3);
+  printf("2\n");
+  test_put_insert();
+  printf("3\n");
+  test_string_keys();
+  printf("4\n");
+  test_composite_keys();
+  printf("Passed all tests!\n");
+}
@@ -0,0 +1,317 @@
+// 멀티스레드 stress test : ThreadSanitizer (-fsanitize=thread) 로 빌드해서 돌린다 : make test-mt
+// 1) 서로 다른 tree 를 쓰는 thread 들이 메모리를 공유하지 않는지
+// 2) concurrent_rbtree 를 여러 reader / writer 가 같이 쓸 때 lock 규약이 맞는지
+//    (seqlock reader 는 일부러 writer 와 겹쳐 읽으므로 TSan build 는 read lock 경로로 하고,
+//     낙관적 읽기 경로는 make test-mt-optimistic 이 TSan 없이 ASan 으로 돌린다)
+// 3) 한 tree 를 split 한 조각 (저장소 공유) 을 thread 마다 따로 고친 뒤 다시 join 할 수 있는지
+//    set 연산이 thread 로 나눠 결과 tree 를 만들 때도 마찬가지
+// 4) persistent_rbtree 의 snapshot 을 reader 가 읽는 동안 writer 가 원래 tree 를 고치고 node 를 회수해도 되는지
+// 5) 여러 thread 가 같이 trace 를 기록해도 record 가 빠지지 않고 thread 안의 순서가 지켜지는지
+#include <assert.h>
+#include <pthread.h>
+#include <rbtree.h>
+#include <rbtree_concurrent.h>
+#include <rbtree_persistent.h>
+#include <rbtree_trace.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define THREADS 8
+#define OPS 200000
+#define KEY_RANGE 4096
+
+typedef struct {
+  unsigned int seed;
+  size_t live;
+} worker_t;
+
+static int comp(const void *p1, const void *p2) {
+  const key_t e1 = *(const key_t *)p1;
+  const key_t e2 = *(const key_t *)p2;
+  return (e1 > e2) - (e1 < e2);
+}
+
+// thread 마다 자기 tree 에 insert / find / erase 를 섞어서 수행
+static void *worker(void *arg) {
+  worker_t *w = arg;
+  rbtree *t = new_rbtree();
+  key_t *keys = calloc(OPS, sizeof(key_t));
+  size_t live = 0;
+
+  for (int i = 0; i < OPS; i++) {
+    const int op = rand_r(&w->seed) % 4;
+    if (op == 0 && live > 0) {
+      // 임의의 key 하나를 지움 (erase 의 fixup 이 sentinel 을 만지는 경로)
+      const size_t j = rand_r(&w->seed) % live;
+      node_t *p = rbtree_find(t, keys[j]);
+      assert(p != NULL);
+      rbtree_erase(t, p);
+      keys[j] = keys[--live];
+    } else if (op == 1) {
+      const key_t key = rand_r(&w->seed) % KEY_RANGE;
+      node_t *p = rbtree_find(t, key);
+      assert(p == NULL || p->key == key);
+    } else {
+      keys[live++] = rand_r(&w->seed) % KEY_RANGE;
+      rbtree_insert(t, keys[live - 1]);
+    }
+  }
+
+  // 남은 key 가 정렬되어 그대로 있어야 한다
+  key_t *res = calloc(live + 1, sizeof(key_t));
+  assert(rbtree_size(t) == live);
+  assert(rbtree_to_array(t, res, live) == 0);
+  qsort(keys, live, sizeof(key_t), comp);
+  for (size_t i = 0; i < live; i++) {
+    assert(res[i] == keys[i]);
+  }
+
+  w->live = live;
+  free(res);
+  free(keys);
+  delete_rbtree(t);
+  return NULL;
+}
+
+#define SHARED_KEYS 1024
+#define SHARED_OPS 20000
+
+typedef struct {
+  concurrent_rbtree *ct;
+  unsigned int seed;
+} shared_worker_t;
+
+// 짝수 key 는 처음부터 있고 지워지지 않으므로 항상 찾아져야 한다
+static void *shared_reader(void *arg) {
+  shared_worker_t *w = arg;
+  for (int i = 0; i < SHARED_OPS; i++) {
+    const key_t key = (rand_r(&w->seed) % SHARED_KEYS) * 2;
+    assert(concurrent_rbtree_find(w->ct, key));
+    key_t min;
+    assert(concurrent_rbtree_min(w->ct, &min) == 0 && min == 0);
+  }
+  return NULL;
+}
+
+// 홀수 key 를 넣었다가 바로 지움
+static void *shared_writer(void *arg) {
+  shared_worker_t *w = arg;
+  for (int i = 0; i < SHARED_OPS; i++) {
+    const key_t key = (rand_r(&w->seed) % SHARED_KEYS) * 2 + 1;
+    assert(concurrent_rbtree_insert(w->ct, key) == 0);
+    assert(concurrent_rbtree_erase(w->ct, key) == 0);
+  }
+  return NULL;
+}
+
+void test_concurrent_shared(void) {
+  concurrent_rbtree *ct = new_concurrent_rbtree();
+  for (key_t i = 0; i < SHARED_KEYS; i++) {
+    assert(concurrent_rbtree_insert(ct, i * 2) == 0);
+  }
+
+  pthread_t threads[THREADS];
+  shared_worker_t workers[THREADS];
+  for (int i = 0; i < THREADS; i++) {
+    workers[i] = (shared_worker_t){.ct = ct, .seed = 31 + i};
+    // 2 개 중 1 개는 writer
+    pthread_create(&threads[i], NULL, i % 2 ? shared_writer : shared_reader, &workers[i]);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  key_t max;
+  assert(rbtree_size(ct->tree) == SHARED_KEYS);
+  assert(concurrent_rbtree_max(ct, &max) == 0 && max == (SHARED_KEYS - 1) * 2);
+  assert(concurrent_rbtree_erase(ct, 1) == -1);
+  delete_concurrent_rbtree(ct);
+}
+
+#define SHARD_KEYS 4096
+
+typedef struct {
+  rbtree *t;
+  key_t lo;  // 이 조각의 key 범위 [lo, lo + SHARD_KEYS)
+  unsigned int seed;
+} shard_worker_t;
+
+// 자기 조각에 insert / erase : 새 slab 을 같은 저장소에 동시에 붙이게 됨
+static void *shard_worker(void *arg) {
+  shard_worker_t *w = arg;
+  for (int i = 0; i < OPS / 4; i++) {
+    const key_t key = w->lo + rand_r(&w->seed) % SHARD_KEYS;
+    node_t *p = rbtree_find(w->t, key);
+    if (p != NULL && i % 2) {
+      rbtree_erase(w->t, p);
+    } else {
+      rbtree_insert(w->t, key);
+    }
+  }
+  return NULL;
+}
+
+void test_split_shards(void) {
+  rbtree *t = new_rbtree();
+  for (key_t k = 0; k < SHARD_KEYS * THREADS; k++) {
+    rbtree_insert(t, k);
+  }
+  // 조각 i 는 [i * SHARD_KEYS, (i + 1) * SHARD_KEYS)
+  rbtree *shards[THREADS];
+  for (int i = 0; i < THREADS - 1; i++) {
+    rbtree_split(t, (i + 1) * SHARD_KEYS, &shards[i], &t);
+  }
+  shards[THREADS - 1] = t;
+
+  pthread_t threads[THREADS];
+  shard_worker_t workers[THREADS];
+  for (int i = 0; i < THREADS; i++) {
+    workers[i] = (shard_worker_t){.t = shards[i], .lo = i * SHARD_KEYS, .seed = 71 + i};
+    pthread_create(&threads[i], NULL, shard_worker, &workers[i]);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  // 경계 key 를 pivot 으로 다시 합침
+  size_t total = rbtree_size(shards[0]);
+  t = shards[0];
+  for (int i = 1; i < THREADS; i++) {
+    total += rbtree_size(shards[i]) + 1;
+    t = rbtree_join(t, i * SHARD_KEYS, shards[i]);
+    assert(t != NULL);
+  }
+  assert(rbtree_size(t) == total);
+  key_t *res = calloc(total, sizeof(key_t));
+  assert(rbtree_to_array(t, res, total) == 0);
+  for (size_t i = 1; i < total; i++) {
+    assert(res[i - 1] <= res[i]);
+  }
+  free(res);
+  delete_rbtree(t);
+}
+
+// set 연산은 큰 입력을 여러 thread 로 나눠 결과 tree 의 저장소에 같이 node 를 만든다
+void test_set_ops(void) {
+  const key_t n = 100000;
+  rbtree *a = new_rbtree(), *b = new_rbtree();
+  for (key_t k = 0; k < n; k++) {
+    rbtree_insert(a, k * 2);  // 짝수
+    rbtree_insert(b, k * 3);  // 3 의 배수
+  }
+  // 6 의 배수는 양쪽에 있음 : [0, 2n) 에서 n / 3 개 남짓
+  rbtree *both = rbtree_intersection(a, b), *all = rbtree_union(a, b), *diff = rbtree_difference(a, b);
+  const size_t common = (size_t)(2 * n - 1) / 6 + 1;
+  assert(rbtree_size(both) == common);
+  assert(rbtree_size(all) == 2 * (size_t)n - common);
+  assert(rbtree_size(diff) == (size_t)n - common);
+  for (node_t *p = rbtree_min(both); p != NULL; p = rbtree_next(both, p)) {
+    assert(p->key % 6 == 0 && rbtree_find(diff, p->key) == NULL);
+  }
+  delete_rbtree(diff);
+  delete_rbtree(all);
+  delete_rbtree(both);
+  delete_rbtree(b);
+  delete_rbtree(a);
+}
+
+typedef struct {
+  persistent_rbtree *snap;
+  key_t lo, hi;  // snapshot 에는 [lo, hi) 가 하나씩 들어 있음
+} snapshot_reader_t;
+
+static void *snapshot_reader(void *arg) {
+  snapshot_reader_t *r = arg;
+  const size_t n = (size_t)(r->hi - r->lo);
+  key_t *res = calloc(n, sizeof(key_t));
+  for (int round = 0; round < 20; round++) {
+    assert(persistent_rbtree_size(r->snap) == n);
+    assert(persistent_rbtree_to_array(r->snap, res, n) == 0);
+    for (size_t i = 0; i < n; i++) {
+      assert(res[i] == r->lo + (key_t)i);
+    }
+    assert(persistent_rbtree_find(r->snap, r->lo + round) && !persistent_rbtree_find(r->snap, r->hi));
+  }
+  free(res);
+  // 다른 thread 가 놓은 뒤 writer 가 그 node 를 제자리에서 고치거나 해제할 수 있음
+  delete_persistent_rbtree(r->snap);
+  return NULL;
+}
+
+void test_persistent_snapshots(void) {
+  persistent_rbtree *t = new_persistent_rbtree();
+  key_t next = 0;
+  pthread_t threads[THREADS];
+  snapshot_reader_t readers[THREADS];
+  for (int i = 0; i < THREADS; i++) {
+    for (key_t k = 0; k < KEY_RANGE / THREADS; k++) {
+      persistent_rbtree_insert(t, next++);
+    }
+    // 버전마다 reader 하나 : 이후의 insert 와 아래의 erase 는 reader 에게 보이지 않아야 함
+    readers[i] = (snapshot_reader_t){persistent_rbtree_snapshot(t), 0, next};
+    pthread_create(&threads[i], NULL, snapshot_reader, &readers[i]);
+  }
+  for (key_t k = 0; k < next; k += 2) {
+    assert(persistent_rbtree_erase(t, k) == 0);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  assert(persistent_rbtree_size(t) == (size_t)next / 2);
+  delete_persistent_rbtree(t);
+}
+
+#define TRACE_OPS 10000
+
+// thread i 는 key i * TRACE_OPS, i * TRACE_OPS + 1, ... 을 차례로 기록
+static void *trace_worker(void *arg) {
+  const key_t base = (key_t)(intptr_t)arg * TRACE_OPS;
+  for (key_t k = 0; k < TRACE_OPS; k++) {
+    rbtree_trace_record(RBTREE_TRACE_FIND, base + k);
+  }
+  return NULL;
+}
+
+void test_trace_threads(void) {
+  const char *path = "test-rbtree-mt.trace";
+  assert(rbtree_trace_start(path) == 0);
+  pthread_t threads[THREADS];
+  for (intptr_t i = 0; i < THREADS; i++) {
+    pthread_create(&threads[i], NULL, trace_worker, (void *)i);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  assert(rbtree_trace_stop() == 0);
+  size_t count;
+  rbtree_trace_rec_t *recs = rbtree_trace_load(path, &count);
+  assert(recs != NULL && count == (size_t)THREADS * TRACE_OPS);
+  key_t next[THREADS] = {0};
+  for (size_t i = 0; i < count; i++) {
+    const int thread = recs[i].key / TRACE_OPS;
+    assert(recs[i].op == RBTREE_TRACE_FIND && recs[i].key % TRACE_OPS == next[thread]++);
+  }
+  free(recs);
+  unlink(path);
+}
+
+int main(void) {
+  pthread_t threads[THREADS];
+  worker_t workers[THREADS];
+  for (int i = 0; i < THREADS; i++) {
+    workers[i].seed = 17 + i;
+    pthread_create(&threads[i], NULL, worker, &workers[i]);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    printf("thread %d : %zu keys\n", i, workers[i].live);
+  }
+  test_concurrent_shared();
+  test_split_shards();
+  test_set_ops();
+  test_persistent_snapshots();
+  test_trace_threads();
+  printf("Passed all tests!\n");
+  return 0;
+}
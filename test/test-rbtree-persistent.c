@@ -0,0 +1,198 @@
+// rbtree_persistent 검사 : 수정 후에도 snapshot 이 그대로인지, 구조가 맞는지, 버전을 놓으면 node 가 회수되는지
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rbtree_persistent.h>
+
+// 정렬 / red-red 없음 / black height 를 확인, black height 를 돌려줌
+static int check_node(const pnode_t *p, const key_t *lo, const key_t *hi) {
+  if (p == NULL) {
+    return 1;
+  }
+  assert(p->refs >= 1);
+  assert(lo == NULL || *lo <= p->key);
+  assert(hi == NULL || p->key <= *hi);
+  if (p->color == RBTREE_RED) {
+    assert((p->left == NULL || p->left->color == RBTREE_BLACK) &&
+           (p->right == NULL || p->right->color == RBTREE_BLACK));
+  }
+  const int left = check_node(p->left, lo, &p->key);
+  const int right = check_node(p->right, &p->key, hi);
+  assert(left == right);
+  return left + (p->color == RBTREE_BLACK);
+}
+
+static size_t count_nodes(const pnode_t *p) {
+  return p == NULL ? 0 : 1 + count_nodes(p->left) + count_nodes(p->right);
+}
+
+// 다른 버전과 공유하는 node 가 없으면 모든 refs 가 1
+static void check_exclusive(const pnode_t *p) {
+  if (p != NULL) {
+    assert(p->refs == 1);
+    check_exclusive(p->left);
+    check_exclusive(p->right);
+  }
+}
+
+// t 가 정렬된 arr[0, n) 과 같은 내용이고 구조가 맞는지
+static void check_contents(const persistent_rbtree *t, const key_t *arr, const size_t n) {
+  assert(persistent_rbtree_size(t) == n);
+  assert(t->root == NULL || t->root->color == RBTREE_BLACK);
+  check_node(t->root, NULL, NULL);
+  assert(count_nodes(t->root) == n);
+  key_t *res = calloc(n + 1, sizeof(key_t));
+  assert(persistent_rbtree_to_array(t, res, n) == 0);
+  assert(n == 0 || memcmp(res, arr, n * sizeof(key_t)) == 0);
+  free(res);
+  key_t key;
+  if (n > 0) {
+    assert(persistent_rbtree_min(t, &key) == 0 && key == arr[0]);
+    assert(persistent_rbtree_max(t, &key) == 0 && key == arr[n - 1]);
+  } else {
+    assert(persistent_rbtree_min(t, &key) == -1 && persistent_rbtree_max(t, &key) == -1);
+  }
+}
+
+// 정렬된 arr[0, n) 에 key 를 넣음 / 하나 뺌 (n 을 돌려줌)
+static size_t sorted_insert(key_t *arr, size_t n, const key_t key) {
+  size_t i = n;
+  while (i > 0 && arr[i - 1] > key) {
+    arr[i] = arr[i - 1];
+    i--;
+  }
+  arr[i] = key;
+  return n + 1;
+}
+
+static size_t sorted_erase(key_t *arr, size_t n, const key_t key) {
+  for (size_t i = 0; i < n; i++) {
+    if (arr[i] == key) {
+      memmove(arr + i, arr + i + 1, (n - i - 1) * sizeof(key_t));
+      return n - 1;
+    }
+  }
+  return n;
+}
+
+// snapshot 없이 무작위 insert / erase : 모든 node 를 제자리에서 고쳐야 함
+void test_insert_erase(const size_t n, const unsigned int seed) {
+  srand(seed);
+  persistent_rbtree *t = new_persistent_rbtree();
+  key_t *arr = calloc(n + 1, sizeof(key_t));
+  size_t live = 0;
+  const key_t span = (key_t)(n / 2 + 1);
+  for (size_t i = 0; i < n; i++) {
+    const key_t key = rand() % span;  // 중복 포함
+    persistent_rbtree_insert(t, key);
+    live = sorted_insert(arr, live, key);
+  }
+  check_contents(t, arr, live);
+  check_exclusive(t->root);
+  assert(persistent_rbtree_erase(t, span + 1) == -1);
+
+  for (size_t i = 0; live > 0; i++) {
+    const key_t key = rand() % span;
+    const int found = persistent_rbtree_find(t, key);
+    assert(persistent_rbtree_erase(t, key) == (found ? 0 : -1));
+    live = sorted_erase(arr, live, key);
+    if (i % 16 == 0) {
+      check_contents(t, arr, live);
+    }
+  }
+  check_contents(t, arr, 0);
+  free(arr);
+  delete_persistent_rbtree(t);
+}
+
+#define SNAPSHOTS 8
+
+// snapshot 을 뜬 뒤 원래 tree 를 고쳐도 snapshot 은 그대로, 놓는 순서와 관계없이 node 가 회수되어야 함
+void test_snapshots(const size_t n, const unsigned int seed) {
+  srand(seed);
+  persistent_rbtree *t = new_persistent_rbtree();
+  persistent_rbtree *snaps[SNAPSHOTS];
+  key_t *expected[SNAPSHOTS];
+  size_t sizes[SNAPSHOTS];
+  key_t *arr = calloc(n * SNAPSHOTS + 1, sizeof(key_t));
+  size_t live = 0;
+  const key_t span = (key_t)(n * 2);
+
+  for (int s = 0; s < SNAPSHOTS; s++) {
+    for (size_t i = 0; i < n; i++) {
+      const key_t key = rand() % span;
+      if (rand() % 3 == 0) {
+        persistent_rbtree_erase(t, key);
+        live = sorted_erase(arr, live, key);
+      } else {
+        persistent_rbtree_insert(t, key);
+        live = sorted_insert(arr, live, key);
+      }
+    }
+    snaps[s] = persistent_rbtree_snapshot(t);
+    expected[s] = malloc((live + 1) * sizeof(key_t));
+    memcpy(expected[s], arr, live * sizeof(key_t));
+    sizes[s] = live;
+    // 루트를 공유하므로 snapshot 은 node 를 새로 만들지 않음
+    assert(snaps[s]->root == t->root);
+  }
+  check_contents(t, arr, live);
+  for (int s = 0; s < SNAPSHOTS; s++) {
+    check_contents(snaps[s], expected[s], sizes[s]);
+  }
+
+  // snapshot 끼리도 독립 : snapshot 을 고쳐도 다른 버전은 그대로
+  persistent_rbtree_insert(snaps[0], -1);
+  assert(persistent_rbtree_find(snaps[0], -1) && !persistent_rbtree_find(t, -1));
+  assert(persistent_rbtree_erase(snaps[0], -1) == 0);
+  check_contents(snaps[0], expected[0], sizes[0]);
+
+  // 짝수 번째, 원래 tree, 홀수 번째 순으로 놓음
+  for (int s = 0; s < SNAPSHOTS; s += 2) {
+    delete_persistent_rbtree(snaps[s]);
+    free(expected[s]);
+  }
+  delete_persistent_rbtree(t);
+  for (int s = 1; s < SNAPSHOTS; s += 2) {
+    check_contents(snaps[s], expected[s], sizes[s]);
+    delete_persistent_rbtree(snaps[s]);
+    free(expected[s]);
+  }
+  free(arr);
+}
+
+// 마지막 다른 버전을 놓으면 남은 버전의 node 는 다시 제자리에서 고쳐짐
+void test_exclusive_after_release(void) {
+  persistent_rbtree *t = new_persistent_rbtree();
+  for (key_t k = 0; k < 1000; k++) {
+    persistent_rbtree_insert(t, k);
+  }
+  persistent_rbtree *snap = persistent_rbtree_snapshot(t);
+  persistent_rbtree_insert(t, 1000);
+  assert(t->root != snap->root);
+  delete_persistent_rbtree(snap);
+  check_exclusive(t->root);
+
+  // 빈 tree 의 snapshot
+  persistent_rbtree *empty = new_persistent_rbtree();
+  snap = persistent_rbtree_snapshot(empty);
+  persistent_rbtree_insert(empty, 3);
+  assert(persistent_rbtree_size(snap) == 0 && snap->root == NULL);
+  delete_persistent_rbtree(snap);
+  delete_persistent_rbtree(empty);
+  delete_persistent_rbtree(t);
+}
+
+int main(void) {
+  test_insert_erase(10, 3);
+  printf("1\n");
+  test_insert_erase(5000, 3);
+  printf("2\n");
+  test_snapshots(10, 5);
+  test_snapshots(2000, 5);
+  printf("3\n");
+  test_exclusive_after_release();
+  printf("Passed all tests!\n");
+}
@@ -1,16 +1,41 @@
 #include <assert.h>
 #include <rbtree.h>
+#include <rbtree_io.h>
+#include <rbtree_trace.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// tree 구조를 직접 따라가는 검사용 접근자
+// index engine (-DRBTREE_INDEX) 은 link 가 t->nodes 안의 index 이다.
+// B+ tree engine (-DRBTREE_BTREE) 은 ROOT / NIL 을 빈 tree 검사에만 쓰고 구조는 아래 btree_traverse 로 따로 본다.
+#if defined(RBTREE_BTREE)
+#define ROOT(t) ((t)->root)
+#define NIL(t) ((btree_node_t *)NULL)
+#define CHILD(p, i) (((const btree_inner_t *)(p))->child[(i)])
+#elif defined(RBTREE_INDEX)
+#define ROOT(t) RBTREE_NODE(t, (t)->root)
+#define NIL(t) RBTREE_NODE(t, 0)
+#define LEFT(t, p) RBTREE_NODE(t, (p)->left)
+#define RIGHT(t, p) RBTREE_NODE(t, (p)->right)
+#define PARENT(t, p) RBTREE_NODE(t, RBTREE_PARENT_INDEX(p))
+#else
+#define ROOT(t) ((t)->root)
+#define NIL(t) ((t)->nil)
+#define LEFT(t, p) ((p)->left)
+#define RIGHT(t, p) ((p)->right)
+#define PARENT(t, p) RBTREE_PARENT(p)
+#endif
 
 // new_rbtree should return rbtree struct with null root node
 void test_init(void) {
   rbtree *t = new_rbtree();
   assert(t != NULL);
-#ifdef SENTINEL
-  assert(t->nil != NULL);
-  assert(t->root == t->nil);
+#if defined(SENTINEL) && !defined(RBTREE_BTREE)
+  assert(NIL(t) != NULL);
+  assert(ROOT(t) == NIL(t));
 #else
   assert(t->root == NULL);
 #endif
@@ -22,17 +47,24 @@ void test_insert_single(const key_t key) {
   rbtree *t = new_rbtree();
   node_t *p = rbtree_insert(t, key);
   assert(p != NULL);
-  assert(t->root == p);
+#ifdef RBTREE_BTREE
+  // 루트 leaf 의 첫 칸
+  assert(p->key == key);
+  assert(ROOT(t)->leaf && ROOT(t)->n == 1 && p == (node_t *)&ROOT(t)->keys[0]);
+  assert(ROOT(t)->parent == NULL && ROOT(t)->prev == NULL && ROOT(t)->next == NULL);
+#else
+  assert(ROOT(t) == p);
   assert(p->key == key);
-  assert(p->color == RBTREE_BLACK);  // color of root node should be black
+  assert(RBTREE_COLOR(p) == RBTREE_BLACK);  // color of root node should be black
 #ifdef SENTINEL
-  assert(p->left == t->nil);
-  assert(p->right == t->nil);
-  assert(p->parent == t->nil);
+  assert(LEFT(t, p) == NIL(t));
+  assert(RIGHT(t, p) == NIL(t));
+  assert(PARENT(t, p) == NIL(t));
 #else
   assert(p->left == NULL);
   assert(p->right == NULL);
-  assert(p->parent == NULL);
+  assert(RBTREE_PARENT(p) == NULL);
+#endif
 #endif
   delete_rbtree(t);
 }
@@ -58,12 +90,16 @@ void test_erase_root(const key_t key) {
   rbtree *t = new_rbtree();
   node_t *p = rbtree_insert(t, key);
   assert(p != NULL);
-  assert(t->root == p);
+#ifdef RBTREE_BTREE
+  assert(rbtree_min(t) == p);
+#else
+  assert(ROOT(t) == p);
+#endif
   assert(p->key == key);
 
   rbtree_erase(t, p);
-#ifdef SENTINEL
-  assert(t->root == t->nil);
+#if defined(SENTINEL) && !defined(RBTREE_BTREE)
+  assert(ROOT(t) == NIL(t));
 #else
   assert(t->root == NULL);
 #endif
@@ -98,9 +134,9 @@ void test_minmax(key_t *arr, const size_t n) {
   assert(t != NULL);
 
   insert_arr(t, arr, n);
-  assert(t->root != NULL);
+  assert(ROOT(t) != NULL);
 #ifdef SENTINEL
-  assert(t->root != t->nil);
+  assert(ROOT(t) != NIL(t));
 #endif
 
   qsort((void *)arr, n, sizeof(key_t), comp);
@@ -118,6 +154,9 @@ void test_minmax(key_t *arr, const size_t n) {
   assert(p->key == arr[1]);
 
   if (n >= 2) {
+#ifdef RBTREE_BTREE
+    q = rbtree_max(t);  // erase 로 같은 leaf 의 key 가 밀렸으므로 다시 찾음
+#endif
     rbtree_erase(t, q);
     q = rbtree_max(t);
     assert(q != NULL);
@@ -175,12 +214,67 @@ void test_multi_instance() {
   delete_rbtree(t1);
 }
 
+#ifdef RBTREE_BTREE
+// B+ tree 조건
+// 1. node 안의 key 는 정렬되어 있고 child[i] 아래 key 는 separator keys[i - 1] 이상 keys[i] 이하이다.
+// 2. 루트가 아닌 node 는 key (separator) 를 RBTREE_BTREE_KEYS / 2 개 이상 갖는다.
+// 3. 모든 leaf 는 같은 깊이에 있다. (red-black tree 의 black height 조건에 해당)
+// parent 와 leaf 의 prev / next 연결, key 수도 같이 본다.
+
+static const btree_node_t *prev_leaf;  // 왼쪽부터 훑으며 마지막으로 본 leaf
+
+// p 아래 level 수를 돌려주고 key 수를 count 에 더함. lo / hi 가 NULL 이면 그쪽은 제한 없음
+static int btree_traverse(const btree_node_t *p, const btree_node_t *parent, const key_t *lo, const key_t *hi,
+                          size_t *count) {
+  assert(p->parent == parent);
+  assert(p->n <= RBTREE_BTREE_KEYS && p->n >= (parent == NULL ? 1 : RBTREE_BTREE_KEYS / 2));
+  for (uint32_t i = 0; i < p->n; i++) {
+    assert(i == 0 || p->keys[i - 1] <= p->keys[i]);
+    assert((lo == NULL || *lo <= p->keys[i]) && (hi == NULL || p->keys[i] <= *hi));
+  }
+  if (p->leaf) {
+    assert(p->prev == prev_leaf && (prev_leaf == NULL || prev_leaf->next == p));
+    prev_leaf = p;
+    *count += p->n;
+    return 1;
+  }
+  int depth = 0;
+  for (uint32_t i = 0; i <= p->n; i++) {
+    const int d = btree_traverse(CHILD(p, i), p, i > 0 ? &p->keys[i - 1] : lo, i < p->n ? &p->keys[i] : hi, count);
+    assert(i == 0 || d == depth);
+    depth = d;
+  }
+  return depth + 1;
+}
+
+static int check_btree(const rbtree *t) {
+  size_t count = 0;
+  int height = 0;
+  prev_leaf = NULL;
+  if (ROOT(t) != NIL(t)) {
+    height = btree_traverse(ROOT(t), NULL, NULL, NULL, &count);
+    assert(prev_leaf->next == NULL);
+  }
+  assert(count == rbtree_size(t));
+  return height;
+}
+
+void test_search_constraint(const rbtree *t) {
+  assert(t != NULL);
+  check_btree(t);
+}
+
+void test_color_constraint(const rbtree *t) {
+  assert(t != NULL);
+  check_btree(t);
+}
+#else
 // Search tree constraint
 // The values of left subtree should be less than or equal to the current node
 // The values of right subtree should be greater than or equal to the current
 // node
 
-static bool search_traverse(const node_t *p, key_t *min, key_t *max,
+static bool search_traverse(const rbtree *t, const node_t *p, key_t *min, key_t *max,
                             node_t *nil) {
   if (p == nil) {
     return true;
@@ -191,11 +285,11 @@ static bool search_traverse(const node_t *p, key_t *min, key_t *max,
   key_t l_min, l_max, r_min, r_max;
   l_min = l_max = r_min = r_max = p->key;
 
-  const bool lr = search_traverse(p->left, &l_min, &l_max, nil);
+  const bool lr = search_traverse(t, LEFT(t, p), &l_min, &l_max, nil);
   if (!lr || l_max > p->key) {
     return false;
   }
-  const bool rr = search_traverse(p->right, &r_min, &r_max, nil);
+  const bool rr = search_traverse(t, RIGHT(t, p), &r_min, &r_max, nil);
   if (!rr || r_min < p->key) {
     return false;
   }
@@ -207,14 +301,14 @@ static bool search_traverse(const node_t *p, key_t *min, key_t *max,
 
 void test_search_constraint(const rbtree *t) {
   assert(t != NULL);
-  node_t *p = t->root;
+  node_t *p = ROOT(t);
   key_t min, max;
 #ifdef SENTINEL
-  node_t *nil = t->nil;
+  node_t *nil = NIL(t);
 #else
   node_t *nil = NULL;
 #endif
-  assert(search_traverse(p, &min, &max, nil));
+  assert(search_traverse(t, p, &min, &max, nil));
 }
 
 // Color constraint
@@ -232,7 +326,7 @@ static void init_color_traverse(void) {
   max_black_depth = 0;
 }
 
-static bool color_traverse(const node_t *p, const color_t parent_color,
+static bool color_traverse(const rbtree *t, const node_t *p, const color_t parent_color,
                            const int black_depth, node_t *nil) {
   if (p == nil) {
     if (!touch_nil) {
@@ -243,35 +337,37 @@ static bool color_traverse(const node_t *p, const color_t parent_color,
     }
     return true;
   }
-  if (parent_color == RBTREE_RED && p->color == RBTREE_RED) {
+  if (parent_color == RBTREE_RED && RBTREE_COLOR(p) == RBTREE_RED) {
     return false;
   }
-  int next_depth = ((p->color == RBTREE_BLACK) ? 1 : 0) + black_depth;
-  return color_traverse(p->left, p->color, next_depth, nil) &&
-         color_traverse(p->right, p->color, next_depth, nil);
+  int next_depth = ((RBTREE_COLOR(p) == RBTREE_BLACK) ? 1 : 0) + black_depth;
+  return color_traverse(t, LEFT(t, p), RBTREE_COLOR(p), next_depth, nil) &&
+         color_traverse(t, RIGHT(t, p), RBTREE_COLOR(p), next_depth, nil);
 }
 
 void test_color_constraint(const rbtree *t) {
   assert(t != NULL);
 #ifdef SENTINEL
-  node_t *nil = t->nil;
+  node_t *nil = NIL(t);
 #else
   node_t *nil = NULL;
 #endif
-  node_t *p = t->root;
-  assert(p == nil || p->color == RBTREE_BLACK);
+  node_t *p = ROOT(t);
+  assert(p == nil || RBTREE_COLOR(p) == RBTREE_BLACK);
 
   init_color_traverse();
-  assert(color_traverse(p, RBTREE_BLACK, 0, nil));
+  assert(color_traverse(t, p, RBTREE_BLACK, 0, nil));
 }
 
+#endif
+
 // rbtree should keep search tree and color constraints
 void test_rb_constraints(const key_t arr[], const size_t n) {
   rbtree *t = new_rbtree();
   assert(t != NULL);
 
   insert_arr(t, arr, n);
-  assert(t->root != NULL);
+  assert(ROOT(t) != NULL);
 
   test_color_constraint(t);
   test_search_constraint(t);
@@ -367,6 +463,983 @@ void test_find_erase_rand(const size_t n, const unsigned int seed) {
   delete_rbtree(t);
 }
 
+// erase 된 node 는 tree 의 pool 에서 다시 꺼내 써야 한다
+void test_node_reuse(void) {
+#if !defined(RBTREE_NO_POOL) && !defined(RBTREE_BTREE)
+  rbtree *t = new_rbtree();
+  node_t *p = rbtree_insert(t, 1);
+  rbtree_insert(t, 2);
+  rbtree_erase(t, p);
+  node_t *q = rbtree_insert(t, 3);
+  assert(q == p);
+  assert(q->key == 3);
+  test_color_constraint(t);
+  test_search_constraint(t);
+  delete_rbtree(t);
+#endif
+}
+
+// n 이 tree 크기보다 작으면 앞에서부터 n 개만, 크면 채울 수 있는 만큼 채우고 1 을 반환
+void test_to_array_partial(void) {
+  rbtree *t = new_rbtree();
+  const size_t n = 100;
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, (key_t)((i * 37) % n));
+  }
+  key_t res[200];
+  res[10] = -1;
+  assert(rbtree_to_array(t, res, 10) == 0);
+  for (int i = 0; i < 10; i++) {
+    assert(res[i] == i);
+  }
+  assert(res[10] == -1);
+
+  assert(rbtree_to_array(t, res, 200) == 1);
+  for (int i = 0; i < n; i++) {
+    assert(res[i] == i);
+  }
+  delete_rbtree(t);
+}
+
+// rbtree_next / rbtree_prev 와 cursor 로 훑으면 정렬 순서대로 나와야 한다
+void test_iterate(const size_t n, const unsigned int seed) {
+  srand(seed);
+  rbtree *t = new_rbtree();
+  rbtree_cursor c = rbtree_cursor_first(t);
+  assert(rbtree_min(t) == NULL && c.node == NULL);
+  assert(rbtree_cursor_next(&c) == NULL);
+
+  key_t *arr = calloc(n, sizeof(key_t));
+  for (size_t i = 0; i < n; i++) {
+    arr[i] = rand() % (n / 2 + 1);
+    rbtree_insert(t, arr[i]);
+  }
+  qsort((void *)arr, n, sizeof(key_t), comp);
+
+  size_t i = 0;
+  for (node_t *p = rbtree_min(t); p != NULL; p = rbtree_next(t, p)) {
+    assert(p->key == arr[i++]);
+  }
+  assert(i == n);
+  for (node_t *p = rbtree_max(t); p != NULL; p = rbtree_prev(t, p)) {
+    assert(p->key == arr[--i]);
+  }
+  assert(i == 0);
+
+  for (c = rbtree_cursor_first(t); c.node != NULL; rbtree_cursor_next(&c)) {
+    assert(c.node->key == arr[i++]);
+  }
+  assert(i == n);
+  // 끝에서 prev 하면 최대값부터 거꾸로
+  while (rbtree_cursor_prev(&c) != NULL) {
+    assert(c.node->key == arr[--i]);
+  }
+  assert(i == 0);
+
+  c = rbtree_cursor_last(t);
+  assert(c.node == rbtree_max(t));
+
+  free(arr);
+  delete_rbtree(t);
+}
+
+// lower_bound / upper_bound 는 중복 key 의 양 끝을, range 는 [lo, hi) 만 돌려줘야 한다
+void test_bounds_range(void) {
+  const key_t entries[] = {10, 5, 5, 34, 6, 23, 12, 12, 6, 12, 40};
+  const size_t n = sizeof(entries) / sizeof(entries[0]);
+  rbtree *t = new_rbtree();
+  insert_arr(t, entries, n);
+
+  node_t *p = rbtree_lower_bound(t, 12);
+  assert(p != NULL && p->key == 12);
+  assert(rbtree_prev(t, p)->key == 10);
+  p = rbtree_upper_bound(t, 12);
+  assert(p != NULL && p->key == 23);
+  assert(rbtree_prev(t, p)->key == 12);
+  assert(rbtree_lower_bound(t, 11)->key == 12);
+  assert(rbtree_lower_bound(t, 41) == NULL);
+  assert(rbtree_upper_bound(t, 40) == NULL);
+  assert(rbtree_lower_bound(t, -100) == rbtree_min(t));
+
+  key_t out[16];
+  assert(rbtree_range_to_array(t, 6, 23, out, 16) == 6);
+  const key_t expect[] = {6, 6, 10, 12, 12, 12};
+  for (int i = 0; i < 6; i++) {
+    assert(out[i] == expect[i]);
+  }
+  assert(rbtree_range_to_array(t, 6, 23, out, 2) == 2);
+  assert(out[0] == 6 && out[1] == 6);
+  assert(rbtree_range_to_array(t, 13, 23, out, 16) == 0);
+  assert(rbtree_range_to_array(t, 23, 6, out, 16) == 0);
+  assert(rbtree_range_to_array(t, -100, 100, out, 16) == n);
+
+  delete_rbtree(t);
+}
+
+#if defined(RBTREE_ORDER_STAT) && defined(RBTREE_BTREE)
+// 모든 inner node 의 size 가 child 크기의 합이어야 한다 (leaf 는 key 수)
+static size_t size_traverse(const rbtree *t, const btree_node_t *p) {
+  if (p == NIL(t) || p->leaf) {
+    return p == NIL(t) ? 0 : p->n;
+  }
+  size_t size = 0;
+  for (uint32_t i = 0; i <= p->n; i++) {
+    size += size_traverse(t, CHILD(p, i));
+  }
+  assert(p->size == size);
+  return size;
+}
+#elif defined(RBTREE_ORDER_STAT)
+// 모든 node 의 size 가 두 subtree 크기 + 1 이어야 한다
+static size_t size_traverse(const rbtree *t, const node_t *p) {
+  if (p == NIL(t)) {
+    return 0;
+  }
+  const size_t size = size_traverse(t, LEFT(t, p)) + size_traverse(t, RIGHT(t, p)) + 1;
+  assert(p->size == size);
+  return size;
+}
+#endif
+
+// size 는 insert / erase 를 따라가고, select / rank 는 정렬 순서와 일치해야 한다
+void test_order_stat(const size_t n, const unsigned int seed) {
+  srand(seed);
+  rbtree *t = new_rbtree();
+  assert(rbtree_size(t) == 0);
+  key_t *keys = calloc(n, sizeof(key_t));
+  key_t *arr = calloc(n, sizeof(key_t));
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = rand() % (n / 2 + 1);
+    rbtree_insert(t, keys[i]);
+  }
+  // 절반을 지움 (index engine 은 insert 후 node 포인터가 바뀔 수 있어 key 로 다시 찾음)
+  size_t live = n;
+  for (size_t i = 0; i < n / 2; i++) {
+    const size_t j = rand() % live;
+    rbtree_erase(t, rbtree_find(t, keys[j]));
+    keys[j] = keys[--live];
+  }
+  assert(rbtree_size(t) == live);
+  rbtree_to_array(t, arr, live);
+
+#ifdef RBTREE_ORDER_STAT
+  size_traverse(t, ROOT(t));
+  for (size_t i = 0; i < live; i++) {
+    node_t *p = rbtree_select(t, i);
+    assert(p != NULL && p->key == arr[i]);
+    assert(rbtree_rank(t, arr[i]) <= i);
+  }
+  assert(rbtree_select(t, live) == NULL);
+  assert(rbtree_rank(t, -1) == 0);
+  assert(rbtree_rank(t, arr[live - 1] + 1) == live);
+  size_t i = 0;
+  for (node_t *p = rbtree_min(t); p != NULL; p = rbtree_next(t, p), i++) {
+    if (i == 0 || arr[i - 1] != p->key) {
+      assert(rbtree_rank(t, p->key) == i);
+    }
+  }
+#endif
+
+  free(arr);
+  free(keys);
+  delete_rbtree(t);
+
+#ifdef RBTREE_ORDER_STAT
+  key_t sorted[] = {1, 2, 2, 3, 5, 8, 13};
+  t = rbtree_from_sorted_array(sorted, 7);
+  size_traverse(t, ROOT(t));
+  assert(rbtree_size(t) == 7);
+  assert(rbtree_select(t, 3)->key == 3);
+  assert(rbtree_rank(t, 2) == 1 && rbtree_rank(t, 4) == 4);
+  delete_rbtree(t);
+#endif
+}
+
+// 정렬된 배열로 만든 tree 도 search / color 조건을 만족하고 이후 insert / erase 가 가능해야 한다
+void test_from_sorted_array(const size_t n) {
+  key_t *arr = calloc(n + 1, sizeof(key_t));
+  for (size_t i = 0; i < n; i++) {
+    arr[i] = (key_t)(i / 3);  // 중복 포함
+  }
+  rbtree *t = rbtree_from_sorted_array(arr, n);
+  assert(t != NULL);
+  test_color_constraint(t);
+  test_search_constraint(t);
+
+  key_t *res = calloc(n + 1, sizeof(key_t));
+  assert(rbtree_to_array(t, res, n) == 0);
+  for (size_t i = 0; i < n; i++) {
+    assert(res[i] == arr[i]);
+  }
+
+  if (n > 0) {
+    node_t *p = rbtree_find(t, arr[n / 2]);
+    assert(p != NULL && p->key == arr[n / 2]);
+    rbtree_erase(t, p);
+    rbtree_insert(t, -1);
+    test_color_constraint(t);
+    test_search_constraint(t);
+    assert(rbtree_min(t)->key == -1);
+  }
+
+  free(res);
+  free(arr);
+  delete_rbtree(t);
+}
+
+// batch insert 는 (finger insert / 재구성 어느 쪽이든) key 를 하나씩 넣은 것과 같은 tree 내용이어야 한다
+void test_insert_batch(const size_t base, const size_t n, const unsigned int seed) {
+  srand(seed);
+  rbtree *t = new_rbtree();
+  key_t *all = calloc(base + n + 1, sizeof(key_t));
+  key_t *res = calloc(base + n + 1, sizeof(key_t));
+  for (size_t i = 0; i < base; i++) {
+    all[i] = rand() % 1000 - 500;  // 음수와 중복 포함
+    rbtree_insert(t, all[i]);
+  }
+  node_t *kept = base > 0 ? rbtree_find(t, all[0]) : NULL;
+  for (size_t i = base; i < base + n; i++) {
+    all[i] = rand() % 1000 - 500;
+  }
+
+  assert(rbtree_insert_batch(t, all + base, n) == 0);
+  assert(rbtree_size(t) == base + n);
+  test_color_constraint(t);
+  test_search_constraint(t);
+#ifdef RBTREE_ORDER_STAT
+  size_traverse(t, ROOT(t));
+#endif
+#if !defined(RBTREE_INDEX) && !defined(RBTREE_BTREE)
+  // 기존 node 는 재구성되어도 그대로 쓰인다
+  assert(kept == NULL || (kept->key == all[0] && rbtree_find(t, all[0]) != NULL));
+#else
+  (void)kept;
+#endif
+
+  qsort(all, base + n, sizeof(key_t), comp);
+  assert(rbtree_to_array(t, res, base + n) == 0);
+  for (size_t i = 0; i < base + n; i++) {
+    assert(res[i] == all[i]);
+  }
+
+  // 이후 insert / erase 도 정상
+  rbtree_erase(t, rbtree_find(t, all[0]));
+  rbtree_insert(t, 1000);
+  test_color_constraint(t);
+  assert(rbtree_max(t)->key == 1000);
+
+  free(res);
+  free(all);
+  delete_rbtree(t);
+}
+
+// find_batch 는 key 마다 rbtree_find 를 부른 것과 같은 node 를 돌려줘야 한다 (group 보다 적은 / 많은 n)
+void test_find_batch(const size_t n, const unsigned int seed) {
+  srand(seed);
+  rbtree *t = new_rbtree();
+  for (size_t i = 0; i < 1000; i++) {
+    rbtree_insert(t, rand() % 2000);
+  }
+  key_t *keys = calloc(n + 1, sizeof(key_t));
+  node_t **out = calloc(n + 1, sizeof(node_t *));
+  size_t expected = 0;
+  for (size_t i = 0; i < n; i++) {
+    keys[i] = rand() % 2200 - 100;  // 절반쯤은 없는 key
+    expected += rbtree_find(t, keys[i]) != NULL;
+  }
+#if defined(RBTREE_STATS) && !defined(RBTREE_INDEX) && !defined(RBTREE_BTREE)
+  // 한 번에 찾아도 search / 비교 counter 는 key 마다 rbtree_find 를 부른 만큼 늘어남
+  rbtree_stats_t st[3];
+  rbtree_stats(t, &st[0]);
+#endif
+  assert(rbtree_find_batch(t, keys, n, out) == expected);
+#if defined(RBTREE_STATS) && !defined(RBTREE_INDEX) && !defined(RBTREE_BTREE)
+  rbtree_stats(t, &st[1]);
+#endif
+  for (size_t i = 0; i < n; i++) {
+    assert(out[i] == rbtree_find(t, keys[i]));
+  }
+#if defined(RBTREE_STATS) && !defined(RBTREE_INDEX) && !defined(RBTREE_BTREE)
+  rbtree_stats(t, &st[2]);
+  assert(st[1].ops.searches - st[0].ops.searches == n && st[2].ops.searches - st[1].ops.searches == n);
+  assert(st[1].ops.comparisons - st[0].ops.comparisons == st[2].ops.comparisons - st[1].ops.comparisons);
+#endif
+  free(out);
+  free(keys);
+  delete_rbtree(t);
+
+  // 빈 tree
+  t = new_rbtree();
+  key_t key = 1;
+  node_t *p = (node_t *)&key;
+  assert(rbtree_find_batch(t, &key, 1, &p) == 0 && p == NULL);
+  delete_rbtree(t);
+}
+
+// 남은 tree 가 arr[0, n) 과 같은 내용이고 구조 (색, 순서, parent 연결, size) 가 맞는지
+static void check_contents(const rbtree *t, const key_t *arr, const size_t n) {
+  assert(rbtree_size(t) == n);
+  test_color_constraint(t);
+  test_search_constraint(t);
+#ifdef RBTREE_ORDER_STAT
+  size_traverse(t, ROOT(t));
+#endif
+  // next / prev 는 parent 를 따라 올라가므로 끊어진 연결이 있으면 순서가 어긋남
+  size_t i = 0;
+  for (node_t *p = rbtree_min(t); p != NULL; p = rbtree_next(t, p)) {
+    assert(i < n && p->key == arr[i++]);
+  }
+  assert(i == n);
+  for (node_t *p = rbtree_max(t); p != NULL; p = rbtree_prev(t, p)) {
+    assert(p->key == arr[--i]);
+  }
+}
+
+// erase_range 는 [lo, hi) 의 key 만 지우고 나머지는 그대로 유효한 tree 여야 한다
+void test_erase_range(const size_t n, const unsigned int seed) {
+  srand(seed);
+  rbtree *t = new_rbtree();
+  key_t *arr = calloc(n + 1, sizeof(key_t));
+  const key_t span = (key_t)(n / 2 + 1);
+  for (size_t i = 0; i < n; i++) {
+    arr[i] = rand() % span;  // 중복 포함
+    rbtree_insert(t, arr[i]);
+  }
+  qsort(arr, n, sizeof(key_t), comp);
+  size_t live = n;
+
+  // 빈 범위, 뒤집힌 범위, node 가 없는 범위는 아무것도 지우지 않음
+  assert(rbtree_erase_range(t, 3, 3) == 0);
+  assert(rbtree_erase_range(t, 5, 2) == 0);
+  assert(rbtree_erase_range(t, span, span + 100) == 0);
+  check_contents(t, arr, live);
+
+  while (live > 0) {
+    key_t lo = rand() % (span + 2) - 1, hi = lo + rand() % (span / 8 + 2);
+    const size_t r = rand() % 4;
+    if (r == 0) {
+      lo = -1;  // 앞쪽 (TTL sweep)
+    } else if (r == 1) {
+      hi = span + 1;  // 뒤쪽
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < live; i++) {
+      if (arr[i] < lo || arr[i] >= hi) {
+        arr[kept++] = arr[i];
+      }
+    }
+    assert(rbtree_erase_range(t, lo, hi) == live - kept);
+    live = kept;
+    check_contents(t, arr, live);
+  }
+  assert(ROOT(t) == NIL(t));
+
+  // 반납한 node 로 다시 채울 수 있어야 함
+  for (key_t k = 0; k < 100; k++) {
+    rbtree_insert(t, k);
+  }
+  assert(rbtree_erase_range(t, 10, 90) == 80);
+  assert(rbtree_size(t) == 20 && rbtree_find(t, 50) == NULL && rbtree_find(t, 90) != NULL);
+  test_color_constraint(t);
+
+  free(arr);
+  delete_rbtree(t);
+}
+
+// key 가 [lo, hi) 인 arr 원소만 out 에 (개수 반환)
+static size_t filter_range(const key_t *arr, const size_t n, const key_t lo, const key_t hi, key_t *out) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (lo <= arr[i] && arr[i] < hi) {
+      out[count++] = arr[i];
+    }
+  }
+  return count;
+}
+
+// split 은 key 앞뒤로 나누고, join 은 pivot 을 넣어 다시 합친다 (같은 tree 에서 갈라진 것 / 관계없는 것 모두)
+void test_split_join(const size_t n, const unsigned int seed) {
+  srand(seed);
+  // 매 split 마다 pivot 이 하나씩 늘고, part 는 아래 관계없는 tree 검사 (311 개) 에도 씀
+  key_t *arr = calloc(n + 8, sizeof(key_t));
+  key_t *part = calloc(n + 320, sizeof(key_t));
+  const key_t span = (key_t)(n / 2 + 1);
+  rbtree *t = new_rbtree();
+  for (size_t i = 0; i < n; i++) {
+    arr[i] = rand() % span;  // 중복 포함
+    rbtree_insert(t, arr[i]);
+  }
+  qsort(arr, n, sizeof(key_t), comp);
+  size_t live = n;
+
+  const key_t cuts[] = {-5, 0, span / 3, span / 2, span - 1, span + 5};
+  for (size_t c = 0; c < sizeof(cuts) / sizeof(cuts[0]); c++) {
+    const key_t key = cuts[c];
+    node_t *kept = live > 0 ? rbtree_find(t, arr[live / 2]) : NULL;
+    rbtree *left, *right;
+    rbtree_split(t, key, &left, &right);
+    check_contents(left, part, filter_range(arr, live, -100, key, part));
+    check_contents(right, part, filter_range(arr, live, key, span + 100, part));
+#if !defined(RBTREE_INDEX) && !defined(RBTREE_BTREE)
+    // node 는 복사되지 않고 둘 중 한쪽으로 옮겨짐 (parent 를 따라 올라가면 그쪽 루트)
+    if (kept != NULL) {
+      rbtree *side = kept->key < key ? left : right;
+      node_t *top = kept;
+      while (PARENT(side, top) != NIL(side)) {
+        top = PARENT(side, top);
+      }
+      assert(top == ROOT(side));
+    }
+#else
+    (void)kept;
+#endif
+
+    // 순서가 맞지 않으면 아무것도 하지 않음
+    if (rbtree_size(left) > 0 && rbtree_size(right) > 0) {
+      assert(rbtree_join(right, key, left) == NULL);
+      assert(rbtree_join(left, rbtree_max(left)->key - 1, right) == NULL);
+    }
+
+    t = rbtree_join(left, key, right);
+    assert(t != NULL);
+    arr[live++] = key;
+    qsort(arr, live, sizeof(key_t), comp);
+    check_contents(t, arr, live);
+  }
+
+  // 여러 조각으로 나눴다가 앞쪽부터 지워도 남은 조각은 계속 쓸 수 있어야 함 (저장소를 같이 붙잡음)
+  rbtree *pieces[4];
+  rbtree *rest = t;
+  for (int i = 0; i < 3; i++) {
+    rbtree_split(rest, span / 4 * (i + 1), &pieces[i], &rest);
+  }
+  pieces[3] = rest;
+  size_t total = 0;
+  for (int i = 0; i < 4; i++) {
+    total += rbtree_size(pieces[i]);
+  }
+  assert(total == live);
+  delete_rbtree(pieces[0]);
+  delete_rbtree(pieces[1]);
+  rbtree_insert(pieces[3], span * 2);
+  rbtree_erase(pieces[3], rbtree_min(pieces[3]));
+  test_color_constraint(pieces[3]);
+  t = rbtree_join(pieces[2], span / 4 * 3, pieces[3]);
+  assert(t != NULL && rbtree_find(t, span * 2) != NULL);
+  test_color_constraint(t);
+  test_search_constraint(t);
+
+  // 관계없는 tree 끼리 : 작은 쪽 / 큰 쪽 어느 쪽이 왼쪽이어도
+  for (int smallLeft = 0; smallLeft < 2; smallLeft++) {
+    rbtree *a = new_rbtree(), *b = new_rbtree();
+    const key_t sizeA = smallLeft ? 10 : 300, sizeB = smallLeft ? 300 : 10;
+    for (key_t k = 0; k < sizeA; k++) {
+      rbtree_insert(a, k);
+      part[k] = k;
+    }
+    for (key_t k = 0; k < sizeB; k++) {
+      rbtree_insert(b, sizeA + 1 + k);
+      part[sizeA + 1 + k] = sizeA + 1 + k;
+    }
+    part[sizeA] = sizeA;
+    rbtree *joined = rbtree_join(a, sizeA, b);
+    check_contents(joined, part, sizeA + sizeB + 1);
+    rbtree_insert(joined, -1);
+    test_color_constraint(joined);
+    delete_rbtree(joined);
+  }
+
+  // 빈 tree
+  rbtree *e1 = new_rbtree(), *e2 = new_rbtree();
+  rbtree *joined = rbtree_join(e1, 7, e2);
+  assert(rbtree_size(joined) == 1 && rbtree_min(joined)->key == 7);
+  rbtree *left, *right;
+  rbtree_split(joined, 7, &left, &right);
+  assert(rbtree_size(left) == 0 && rbtree_size(right) == 1);
+  delete_rbtree(left);
+  delete_rbtree(right);
+
+  free(part);
+  free(arr);
+  delete_rbtree(t);
+}
+
+// 정렬된 arr 에서 중복을 빼고 개수 반환
+static size_t dedup(key_t *arr, const size_t n) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (count == 0 || arr[count - 1] != arr[i]) {
+      arr[count++] = arr[i];
+    }
+  }
+  return count;
+}
+
+// 정렬된 (중복 없는) a, b 를 합치며 mode 에 맞는 key 만 out 에 : 0 합집합, 1 교집합, 2 차집합 (a - b)
+static size_t merge_set(const key_t *a, const size_t n, const key_t *b, const size_t m, const int mode, key_t *out) {
+  size_t i = 0, j = 0, count = 0;
+  while (i < n || j < m) {
+    if (j == m || (i < n && a[i] < b[j])) {
+      if (mode != 1) {
+        out[count++] = a[i];
+      }
+      i++;
+    } else if (i == n || b[j] < a[i]) {
+      if (mode == 0) {
+        out[count++] = b[j];
+      }
+      j++;
+    } else {
+      if (mode != 2) {
+        out[count++] = a[i];
+      }
+      i++, j++;
+    }
+  }
+  return count;
+}
+
+// key 가 [lo, lo + span) 인 무작위 tree (중복 포함), arr 에는 정렬해서 담음
+static rbtree *build_random(key_t *arr, const size_t n, const key_t lo, const key_t span) {
+  rbtree *t = new_rbtree();
+  for (size_t i = 0; i < n; i++) {
+    arr[i] = lo + rand() % span;
+    rbtree_insert(t, arr[i]);
+  }
+  qsort(arr, n, sizeof(key_t), comp);
+  return t;
+}
+
+// 합집합 / 교집합 / 차집합은 중복 없는 새 tree 를 만들고 입력은 그대로 둔다
+void test_set_ops(const size_t n, const size_t m, const unsigned int seed) {
+  srand(seed);
+  key_t *a = calloc(n + 1, sizeof(key_t)), *b = calloc(m + 1, sizeof(key_t));
+  key_t *expected = calloc(n + m + 1, sizeof(key_t));
+  // 범위가 반쯤 겹치고 양쪽 다 중복이 있도록
+  const key_t span = (key_t)((n + m) / 2 + 1);
+  rbtree *ta = build_random(a, n, 0, span), *tb = build_random(b, m, span / 3, span);
+  const size_t da = dedup(a, n), db = dedup(b, m);
+
+  rbtree *(*const ops[])(const rbtree *, const rbtree *) = {rbtree_union, rbtree_intersection,
+                                                           rbtree_difference};
+  for (int mode = 0; mode < 3; mode++) {
+    rbtree *r = ops[mode](ta, tb);
+    check_contents(r, expected, merge_set(a, da, b, db, mode, expected));
+    delete_rbtree(r);
+    r = ops[mode](tb, ta);
+    check_contents(r, expected, mode == 2 ? merge_set(b, db, a, da, 2, expected)
+                                          : merge_set(a, da, b, db, mode, expected));
+    delete_rbtree(r);
+  }
+  assert(rbtree_size(ta) == n && rbtree_size(tb) == m);
+  test_color_constraint(ta);
+
+  // 같은 tree 끼리
+  rbtree *r = rbtree_union(ta, ta);
+  check_contents(r, a, da);
+  delete_rbtree(r);
+  r = rbtree_difference(ta, ta);
+  assert(rbtree_size(r) == 0 && ROOT(r) == NIL(r));
+  // 결과 tree 도 보통 tree 처럼 쓸 수 있어야 함
+  rbtree_insert(r, 5);
+  assert(rbtree_size(r) == 1 && rbtree_find(r, 5) != NULL);
+  delete_rbtree(r);
+
+  free(expected);
+  free(b);
+  free(a);
+  delete_rbtree(tb);
+  delete_rbtree(ta);
+}
+
+// 저장한 파일을 다시 읽으면 같은 내용의 유효한 tree, 형식이 맞지 않는 파일은 NULL
+void test_save_load(const size_t n, const unsigned int seed) {
+  const char *path = "test-rbtree.img";
+  srand(seed);
+  key_t *arr = calloc(n + 1, sizeof(key_t));
+  rbtree *t = build_random(arr, n, -(key_t)n, (key_t)n);  // 음수와 중복 포함
+  assert(rbtree_save(t, path) == 0);
+  rbtree *loaded = rbtree_load(path);
+  assert(loaded != NULL);
+  check_contents(loaded, arr, n);
+  // 읽은 tree 도 보통 tree 처럼 고칠 수 있어야 함
+  rbtree_insert(loaded, 0);
+  assert(rbtree_size(loaded) == n + 1);
+  delete_rbtree(loaded);
+
+  // 같은 path 에 다시 저장하면 덮어씀
+  rbtree *empty = new_rbtree();
+  assert(rbtree_save(empty, path) == 0);
+  loaded = rbtree_load(path);
+  assert(loaded != NULL && rbtree_size(loaded) == 0 && ROOT(loaded) == NIL(loaded));
+  delete_rbtree(loaded);
+  delete_rbtree(empty);
+
+  if (n >= 2) {
+    // 잘린 파일, 정렬이 깨진 파일, 다른 형식
+    assert(rbtree_save(t, path) == 0);
+    FILE *f = fopen(path, "r+b");
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    const key_t big = arr[n - 1] + 1;
+    fseek(f, size - 2 * (long)sizeof(key_t), SEEK_SET);
+    fwrite(&big, sizeof(key_t), 1, f);
+    fclose(f);
+    assert(rbtree_load(path) == NULL);
+    assert(truncate(path, size - 1) == 0);
+    assert(rbtree_load(path) == NULL);
+    f = fopen(path, "wb");
+    fputs("not a tree image", f);
+    fclose(f);
+    assert(rbtree_load(path) == NULL);
+  }
+  unlink(path);
+  assert(rbtree_load(path) == NULL);
+  assert(rbtree_save(t, "no-such-dir/test-rbtree.img") == -1);
+
+  free(arr);
+  delete_rbtree(t);
+}
+
+typedef struct {
+  key_t *out;
+  size_t count, chunks, stopAt;  // stopAt 번째 chunk 에서 멈춤 (0 이면 끝까지)
+} export_sink_t;
+
+static int collect_chunk(const key_t *keys, size_t n, void *arg) {
+  export_sink_t *sink = arg;
+  for (size_t i = 0; i < n; i++) {
+    sink->out[sink->count++] = keys[i];
+  }
+  return ++sink->chunks == sink->stopAt ? 7 : 0;
+}
+
+// 커서로 몇 번에 나눠 읽거나 export 로 chunk 를 받아도 rbtree_to_array 와 같은 순서
+void test_cursor_read_export(const size_t n, const unsigned int seed) {
+  srand(seed);
+  key_t *arr = calloc(n + 1, sizeof(key_t)), *res = calloc(n + 1, sizeof(key_t));
+  rbtree *t = build_random(arr, n, 0, (key_t)(n / 2 + 1));  // 중복 포함
+  const size_t caps[] = {1, 7, n, n + 5};
+  for (size_t k = 0; k < sizeof(caps) / sizeof(caps[0]); k++) {
+    const size_t cap = caps[k] == 0 ? 1 : caps[k];
+    key_t *buf = calloc(cap, sizeof(key_t));
+    rbtree_cursor c = rbtree_cursor_first(t);
+    size_t total = 0, got;
+    while ((got = rbtree_cursor_read(&c, buf, cap)) > 0) {
+      assert(got <= cap && total + got <= n);
+      for (size_t i = 0; i < got; i++) {
+        res[total++] = buf[i];
+      }
+    }
+    assert(total == n && c.node == NULL && rbtree_cursor_read(&c, buf, cap) == 0);
+    for (size_t i = 0; i < n; i++) {
+      assert(res[i] == arr[i]);
+    }
+
+    export_sink_t sink = {res, 0, 0, 0};
+    assert(rbtree_export(t, buf, cap, collect_chunk, &sink) == 0);
+    assert(sink.count == n && sink.chunks == (n + cap - 1) / cap);
+    for (size_t i = 0; i < n; i++) {
+      assert(res[i] == arr[i]);
+    }
+    // fn 이 0 이 아닌 값을 돌려주면 거기서 멈추고 그 값을 돌려줌
+    if (n > cap) {
+      sink = (export_sink_t){res, 0, 0, 1};
+      assert(rbtree_export(t, buf, cap, collect_chunk, &sink) == 7);
+      assert(sink.chunks == 1 && sink.count == cap);
+    }
+    free(buf);
+  }
+
+  // 중간 위치에서 시작해도 이어서 읽힘
+  if (n > 0) {
+    rbtree_cursor c = {t, rbtree_lower_bound(t, arr[n / 2])};
+    size_t from = n / 2;
+    while (from > 0 && arr[from - 1] == arr[n / 2]) {
+      from--;
+    }
+    assert(rbtree_cursor_read(&c, res, n) == n - from);
+  }
+
+  free(res);
+  free(arr);
+  delete_rbtree(t);
+}
+
+#if defined(RBTREE_BTREE)
+// freeze 뒤에는 leaf 수가 최소 (key 를 가득 채운 만큼) 여야 함
+static void check_frozen(const rbtree *t) {
+  const btree_node_t *p = ROOT(t);
+  while (p != NIL(t) && !p->leaf) {
+    p = CHILD(p, 0);
+  }
+  size_t leaves = 0;
+  for (; p != NULL; p = p->next) {
+    leaves++;
+  }
+  assert(leaves == (rbtree_size(t) + RBTREE_BTREE_KEYS - 1) / RBTREE_BTREE_KEYS);
+}
+#elif !defined(RBTREE_NO_POOL)
+// freeze 뒤에는 모든 node 가 루트부터 연속된 n 칸 안에 있어야 함
+static void check_frozen(const rbtree *t) {
+  const node_t *first = ROOT(t);
+  size_t count = 0;
+  for (node_t *p = rbtree_min(t); p != NULL; p = rbtree_next(t, p), count++) {
+    assert(first <= p && p < first + rbtree_size(t));
+  }
+  assert(count == rbtree_size(t));
+}
+#endif
+
+// freeze 는 내용과 구조를 그대로 두고 node 만 옮긴다. 이후에도 고칠 수 있어야 함
+void test_freeze(const size_t n, const unsigned int seed) {
+  srand(seed);
+  // freeze 뒤에 50 개를 더 넣고 split / join 의 pivot 하나가 늘어남
+  key_t *arr = calloc(n + 51, sizeof(key_t)), *part = calloc(n + 51, sizeof(key_t));
+  const key_t span = (key_t)(n / 2 + 1);
+  rbtree *t = build_random(arr, n, 0, span);  // 중복 포함
+  // 반납된 node 가 있는 상태로
+  size_t live = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (i % 3 == 0) {
+      rbtree_erase(t, rbtree_find(t, arr[i]));
+    } else {
+      arr[live++] = arr[i];
+    }
+  }
+#ifdef RBTREE_NO_POOL
+  assert(rbtree_freeze(t) == -1);
+  check_contents(t, arr, live);
+#else
+  assert(rbtree_freeze(t) == 0);
+  check_contents(t, arr, live);
+  if (live > 0) {
+    check_frozen(t);
+  }
+
+  // 다시 고칠 수 있고, 다시 freeze 할 수 있음
+  for (key_t k = 0; k < 50; k++) {
+    rbtree_insert(t, span + k);
+    arr[live++] = span + k;
+  }
+  rbtree_erase(t, rbtree_find(t, span));
+  memmove(arr + live - 50, arr + live - 49, 49 * sizeof(key_t));
+  live--;
+  check_contents(t, arr, live);
+  assert(rbtree_freeze(t) == 0);
+  check_contents(t, arr, live);
+  check_frozen(t);
+
+  // split 으로 저장소를 같이 쓰는 tree 를 freeze 해도 다른 쪽은 그대로이고 다시 join 됨
+  const key_t cut = span / 2;
+  rbtree *left, *right;
+  rbtree_split(t, cut, &left, &right);
+  assert(rbtree_freeze(left) == 0);
+  check_contents(left, part, filter_range(arr, live, -1, cut, part));
+  check_contents(right, part, filter_range(arr, live, cut, span + 100, part));
+  t = rbtree_join(left, cut, right);
+  assert(t != NULL);
+  arr[live++] = cut;
+  qsort(arr, live, sizeof(key_t), comp);
+  check_contents(t, arr, live);
+#endif
+
+  free(part);
+  free(arr);
+  delete_rbtree(t);
+}
+
+// trace 파일 : 저장한 그대로 읽히고, 잘리거나 모르는 op 가 든 파일은 받지 않아야 함
+void test_trace_file(const size_t n, const unsigned int seed) {
+  const char *path = "test-rbtree.trace";
+  srand(seed);
+  rbtree_trace_rec_t *recs = calloc(n + 1, sizeof(rbtree_trace_rec_t));
+  for (size_t i = 0; i < n; i++) {
+    recs[i].op = rand() % RBTREE_TRACE_OPS;
+    recs[i].key = rand() - RAND_MAX / 2;
+  }
+  assert(sizeof(rbtree_trace_rec_t) == 5);
+  assert(rbtree_trace_save(path, recs, n) == 0);
+  size_t count = n + 1;
+  rbtree_trace_rec_t *loaded = rbtree_trace_load(path, &count);
+  assert(loaded != NULL && count == n);
+  assert(n == 0 || memcmp(loaded, recs, n * sizeof(rbtree_trace_rec_t)) == 0);
+  free(loaded);
+
+  if (n >= 1) {
+    FILE *f = fopen(path, "r+b");
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    // 마지막 record 의 op 를 모르는 값으로
+    fseek(f, size - (long)sizeof(rbtree_trace_rec_t), SEEK_SET);
+    fputc(RBTREE_TRACE_OPS, f);
+    fclose(f);
+    assert(rbtree_trace_load(path, &count) == NULL);
+    assert(rbtree_trace_save(path, recs, n) == 0);
+    assert(truncate(path, size - 1) == 0);
+    assert(rbtree_trace_load(path, &count) == NULL);
+    f = fopen(path, "ab");
+    fputs("xx", f);
+    fclose(f);
+    assert(rbtree_trace_load(path, &count) == NULL);
+  }
+  unlink(path);
+  assert(rbtree_trace_load(path, &count) == NULL);
+  assert(rbtree_trace_save("no-such-dir/test-rbtree.trace", recs, n) == -1);
+  free(recs);
+}
+
+// 기록기 : start 와 stop 사이의 record 만 순서대로 남아야 함
+void test_trace_record(const size_t n, const unsigned int seed) {
+  const char *path = "test-rbtree.trace";
+  srand(seed);
+  rbtree_trace_record(RBTREE_TRACE_INSERT, 1);  // 기록 중이 아니면 버려짐
+  assert(rbtree_trace_stop() == -1);
+  assert(rbtree_trace_start("no-such-dir/test-rbtree.trace") == -1);
+
+  rbtree_trace_rec_t *expected = calloc(n + 1, sizeof(rbtree_trace_rec_t));
+  for (int round = 0; round < 2; round++) {  // 두 번째 기록은 지난 buffer 를 다시 쓰지 않아야 함
+    assert(rbtree_trace_start(path) == 0);
+    assert(rbtree_trace_start(path) == -1);
+    for (size_t i = 0; i < n; i++) {
+      expected[i].op = rand() % RBTREE_TRACE_OPS;
+      expected[i].key = rand();
+      rbtree_trace_record(expected[i].op, expected[i].key);
+    }
+    assert(rbtree_trace_stop() == 0);
+    size_t count;
+    rbtree_trace_rec_t *recs = rbtree_trace_load(path, &count);
+    assert(recs != NULL && count == n);
+    assert(n == 0 || memcmp(recs, expected, n * sizeof(rbtree_trace_rec_t)) == 0);
+    free(recs);
+  }
+  free(expected);
+
+#ifdef RBTREE_TRACE
+  // engine 이 insert / find / erase 를 부를 때마다 남김
+  rbtree *t = new_rbtree();
+  assert(rbtree_trace_start(path) == 0);
+  node_t *p = rbtree_insert(t, 5);
+  rbtree_insert(t, 7);
+  assert(rbtree_find(t, 9) == NULL);
+  rbtree_erase(t, p);
+  // find_batch 는 key 마다 find 하나로 남김
+  const key_t keys[] = {7, 9};
+  node_t *found[2];
+  assert(rbtree_find_batch(t, keys, 2, found) == 1);
+  assert(rbtree_trace_stop() == 0);
+  size_t count;
+  rbtree_trace_rec_t *recs = rbtree_trace_load(path, &count);
+  const rbtree_trace_rec_t ops[] = {{RBTREE_TRACE_INSERT, 5}, {RBTREE_TRACE_INSERT, 7}, {RBTREE_TRACE_FIND, 9},
+                                    {RBTREE_TRACE_ERASE, 5},  {RBTREE_TRACE_FIND, 7},   {RBTREE_TRACE_FIND, 9}};
+  assert(recs != NULL && count == 6 && memcmp(recs, ops, sizeof(ops)) == 0);
+  free(recs);
+  delete_rbtree(t);
+#endif
+  unlink(path);
+}
+
+#ifdef RBTREE_BTREE
+// key 는 모두 같은 깊이의 leaf 에 있으므로 높이는 level 수, 평균 깊이는 그보다 1 작음
+static void check_stats(const rbtree *t) {
+  rbtree_stats_t st;
+  rbtree_stats(t, &st);
+  const int height = check_btree(t);
+  assert(st.nodes == rbtree_size(t));
+  assert(st.height == height && st.black_height == height);
+  assert(st.avg_depth == (height > 0 ? height - 1 : 0));
+  // 루트 아래 node 는 child 를 KEYS / 2 + 1 개 이상, leaf 는 key 를 KEYS / 2 개 이상 가짐
+  size_t least = 1;
+  for (int level = 2; level < height; level++) {
+    least *= RBTREE_BTREE_KEYS / 2 + 1;
+  }
+  assert(height <= 1 || 2 * least * (RBTREE_BTREE_KEYS / 2) <= st.nodes);
+}
+#else
+// 높이를 돌려주고 node 수와 깊이 합을 더함
+static int depth_traverse(const rbtree *t, const node_t *p, const size_t depth, size_t *count, size_t *depth_sum) {
+  if (p == NIL(t)) {
+    return 0;
+  }
+  (*count)++;
+  *depth_sum += depth;
+  const int left = depth_traverse(t, LEFT(t, p), depth + 1, count, depth_sum);
+  const int right = depth_traverse(t, RIGHT(t, p), depth + 1, count, depth_sum);
+  return 1 + (left > right ? left : right);
+}
+
+static void check_stats(const rbtree *t) {
+  rbtree_stats_t st;
+  rbtree_stats(t, &st);
+  size_t count = 0, depth_sum = 0;
+  const int height = depth_traverse(t, ROOT(t), 0, &count, &depth_sum);
+  int black_height = 0;
+  for (const node_t *p = ROOT(t); p != NIL(t); p = LEFT(t, p)) {
+    black_height += RBTREE_COLOR(p) == RBTREE_BLACK;
+  }
+  assert(st.nodes == rbtree_size(t) && st.nodes == count);
+  assert(st.height == height && st.black_height == black_height);
+  assert(count == 0 ? st.avg_depth == 0 : st.avg_depth * count > depth_sum - 0.5 && st.avg_depth * count < depth_sum + 0.5);
+  // red-black tree 의 높이는 2 log2(n + 1) 이하, black height 이상
+  assert(st.height >= st.black_height && (double)(1ull << (st.height / 2)) <= count + 1);
+}
+#endif
+
+// rbtree_stats 의 구조 값, -DRBTREE_STATS 면 연산 counter 의 관계까지
+void test_stats(const size_t n, const unsigned int seed) {
+  srand(seed);
+  rbtree *t = new_rbtree();
+  check_stats(t);
+  rbtree_stats_t st;
+  rbtree_stats(t, &st);
+  assert(st.height == 0 && st.black_height == 0 && st.ops.inserts == 0 && st.ops.node_allocs == 0);
+
+  for (size_t i = 0; i < n; i++) {
+    rbtree_insert(t, i % 2 ? (key_t)i : rand() % (key_t)(n + 1));  // 순서대로와 무작위를 섞음
+  }
+  check_stats(t);
+#if defined(RBTREE_STATS) && !defined(RBTREE_INDEX) && !defined(RBTREE_BTREE)
+  if (n > 0) {
+    rbtree_find(t, ROOT(t)->key);
+  }
+
+  rbtree_stats(t, &st);
+  assert(st.ops.inserts == n && st.ops.node_allocs == n && st.ops.node_frees == 0);
+  assert(st.ops.insert_rotations <= 2 * st.ops.insert_fixups);
+  assert(n < 3 || st.ops.insert_rotations > 0);
+  // 루트의 key 는 한 번 비교로 찾음
+  assert(st.ops.searches == (n > 0) && st.ops.comparisons == (n > 0));
+#ifdef RBTREE_NO_POOL
+  assert(st.ops.slab_allocs == 0);
+#else
+  assert(n == 0 || st.ops.slab_allocs > 0);
+#endif
+#endif
+
+  for (size_t i = 0; i < n; i++) {
+    const key_t key = i % 2 ? (key_t)i : rand() % (key_t)(n + 1);
+    node_t *p = rbtree_find(t, key);
+    if (p != NULL) {
+      rbtree_erase(t, p);
+    }
+    if (i % 64 == 0) {
+      check_stats(t);
+    }
+  }
+  check_stats(t);
+
+#if defined(RBTREE_STATS) && !defined(RBTREE_INDEX) && !defined(RBTREE_BTREE)
+  rbtree_stats(t, &st);
+  assert(st.ops.erases == n - st.nodes && st.ops.node_frees == st.ops.erases);
+  assert(st.ops.searches == n + (n > 0));
+  // loop 한 번은 CASE 2 로 올라가거나 CASE 4 로 끝남. 회전은 CASE 1, 3, 4 에서 한 번씩
+  assert(st.ops.erase_fixups == st.ops.erase_cases[1] + st.ops.erase_cases[3]);
+  assert(st.ops.erase_rotations == st.ops.erase_cases[0] + st.ops.erase_cases[2] + st.ops.erase_cases[3]);
+  assert(st.ops.erase_cases[3] <= st.ops.erases);
+#endif
+  delete_rbtree(t);
+}
+
 int main(void) {
   test_init();
   printf("1\n");
@@ -389,5 +1462,70 @@ int main(void) {
   test_multi_instance();
   printf("10\n");
   test_find_erase_rand(10, 17);
+  printf("11\n");
+  test_find_erase_rand(10000, 17);
+  printf("12\n");
+  test_node_reuse();
+  printf("13\n");
+  for (size_t n = 0; n < 70; n++) {
+    test_from_sorted_array(n);
+  }
+  test_from_sorted_array(1000);
+  printf("14\n");
+  test_to_array_partial();
+  printf("15\n");
+  test_iterate(1000, 7);
+  printf("16\n");
+  test_bounds_range();
+  printf("17\n");
+  test_order_stat(2000, 11);
+  printf("18\n");
+  test_insert_batch(0, 100, 5);     // 빈 tree : 재구성
+  test_insert_batch(1000, 10, 5);   // 작은 배치 : finger insert
+  test_insert_batch(1000, 400, 5);  // 큰 배치 : finger insert
+  test_insert_batch(300, 1000, 5);  // tree 보다 큰 배치 : 재구성
+  test_insert_batch(5000, 1, 5);
+  test_insert_batch(10, 0, 5);
+  printf("19\n");
+  test_find_batch(0, 9);
+  test_find_batch(5, 9);
+  test_find_batch(1001, 9);
+  printf("20\n");
+  test_erase_range(1, 13);
+  test_erase_range(100, 13);
+  test_erase_range(5000, 13);
+  printf("21\n");
+  test_split_join(1, 21);
+  test_split_join(200, 21);
+  test_split_join(3000, 21);
+  printf("22\n");
+  test_set_ops(0, 0, 23);
+  test_set_ops(100, 0, 23);
+  test_set_ops(200, 3000, 23);
+  test_set_ops(40000, 30000, 23);  // 여러 thread 로 나뉘는 크기
+  printf("23\n");
+  test_save_load(0, 29);
+  test_save_load(1, 29);
+  test_save_load(100000, 29);
+  printf("24\n");
+  test_cursor_read_export(0, 31);
+  test_cursor_read_export(1, 31);
+  test_cursor_read_export(3000, 31);
+  printf("25\n");
+  test_freeze(0, 37);
+  test_freeze(2, 37);
+  test_freeze(5000, 37);
+  printf("26\n");
+  test_trace_file(0, 41);
+  test_trace_file(1, 41);
+  test_trace_file(10000, 41);
+  printf("27\n");
+  test_trace_record(0, 43);
+  test_trace_record(100000, 43);
+  printf("28\n");
+  test_stats(0, 47);
+  test_stats(1, 47);
+  test_stats(2, 47);
+  test_stats(10000, 47);
   printf("Passed all tests!\n");
 }